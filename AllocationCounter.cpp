@@ -0,0 +1,122 @@
+/**
+ * @file  AllocationCounter.cpp
+ *
+ * This file replaces the global operator new and delete to count
+ * the heap allocations of the process, if built with COUNT_ALLOCATIONS.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "AllocationCounter.h"
+
+#ifndef COUNT_ALLOCATIONS
+
+uint64_t GetAllocationCount()
+{
+	return 0;
+}
+
+#else
+
+// Number of operator new calls
+static std::atomic<uint64_t> s_allocationCount(0);
+
+uint64_t GetAllocationCount()
+{
+	return s_allocationCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * Allocate the memory and count the allocation
+ *
+ * @param[in] size       Size in bytes
+ * @param[in] alignment  Alignment in bytes
+ *
+ * @return    Pointer to the memory
+ */
+static void* CountedAllocate(std::size_t size, std::size_t alignment)
+{
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (size == 0)
+	{
+		size = 1;
+	}
+	void* memory = NULL;
+	if (alignment <= alignof(std::max_align_t))
+	{
+		memory = std::malloc(size);
+	}
+	else if (posix_memalign(&memory, alignment, size) != 0)
+	{
+		memory = NULL;
+	}
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new(std::size_t size)
+{
+	return CountedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size)
+{
+	return CountedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return CountedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return CountedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+	std::free(memory);
+}
+
+#endif /* COUNT_ALLOCATIONS */
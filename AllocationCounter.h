@@ -0,0 +1,32 @@
+/**
+ * @file  AllocationCounter.h
+ *
+ * This file contains the method to read the number of heap
+ * allocations done by the process. Building with COUNT_ALLOCATIONS
+ * defined makes AllocationCounter.cpp replace the global operator new
+ * to count them. It is meant for the command line tool only, so a host
+ * which embeds the library keeps its own allocator.
+ */
+
+#ifndef ALLOCATIONCOUNTER_H_
+#define ALLOCATIONCOUNTER_H_
+
+#include <cstdint>
+
+#ifdef COUNT_ALLOCATIONS
+// True if the heap allocations are counted
+static const bool kAllocationCountEnabled = true;
+#else
+// True if the heap allocations are counted
+static const bool kAllocationCountEnabled = false;
+#endif
+
+/**
+ * Get the number of heap allocations done by the process so far
+ *
+ * @return   Unsigned Integer  Number of operator new calls. Always 0
+ *                             unless built with COUNT_ALLOCATIONS.
+ */
+uint64_t GetAllocationCount();
+
+#endif /* ALLOCATIONCOUNTER_H_ */
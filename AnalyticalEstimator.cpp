@@ -0,0 +1,92 @@
+/**
+ * @file  AnalyticalEstimator.cpp
+ *
+ * AnalyticalEstimator class methods implementation
+ */
+
+#include <algorithm>
+#include "AnalyticalEstimator.h"
+
+/**
+ * Get the mean of a uniform distribution
+ *
+ * @param[in] distribution   Distribution of the scenario
+ *
+ * @return    Double  Mean time in milliseconds
+ */
+static double GetMean(const ScenarioDistribution& distribution)
+{
+	return (distribution.minimum + distribution.maximum) / 2.0;
+}
+
+AnalyticalEstimator::AnalyticalEstimator(const Scenario& scenario)
+{
+	m_meanThinkTime = 0;
+	for (uint32_t i = 0; i < scenario.GetTruckCount(); ++i)
+	{
+		const ScenarioTruckClass& truckClass = scenario.GetTruckClass(scenario.GetTruck(i).truckClass);
+		m_meanThinkTime += 2 * GetMean(scenario.GetDistribution(truckClass.travelDistribution)) +
+		                   GetMean(scenario.GetDistribution(truckClass.loadingDistribution));
+	}
+	if (scenario.GetTruckCount())
+	{
+		m_meanThinkTime /= scenario.GetTruckCount();
+	}
+	m_meanUnloadingTime = 0;
+	double unloadingSecondMoment = 0;
+	for (uint32_t i = 0; i < scenario.GetStationCount(); ++i)
+	{
+		const ScenarioDistribution& unloading = scenario.GetDistribution(scenario.GetStation(i).unloadingDistribution);
+		const double mean = GetMean(unloading);
+		const double range = (double)unloading.maximum - unloading.minimum;
+		m_meanUnloadingTime += mean;
+		unloadingSecondMoment += mean * mean + range * range / 12;
+	}
+	m_unloadingVariation = 0;
+	if (scenario.GetStationCount())
+	{
+		m_meanUnloadingTime /= scenario.GetStationCount();
+		unloadingSecondMoment /= scenario.GetStationCount();
+	}
+	if (m_meanUnloadingTime > 0)
+	{
+		m_unloadingVariation = unloadingSecondMoment / (m_meanUnloadingTime * m_meanUnloadingTime) - 1;
+	}
+}
+
+AnalyticalEstimate AnalyticalEstimator::Estimate(uint32_t stationCount, uint32_t truckCount) const
+{
+	AnalyticalEstimate estimate = {};
+	if (stationCount == 0 || truckCount == 0)
+	{
+		return estimate;
+	}
+	// Seidmann: c servers of time S behave like one server of time S/c plus a delay of S(c-1)/c.
+	const double queueServiceTime = m_meanUnloadingTime / stationCount;
+	const double delayTime = m_meanThinkTime + m_meanUnloadingTime - queueServiceTime;
+
+	// Exact MVA recursion over the population for the single server queue.
+	double queueLength = 0;
+	double residenceTime = queueServiceTime;
+	double throughput = 0;
+	for (uint32_t n = 1; n <= truckCount; ++n)
+	{
+		residenceTime = queueServiceTime * (1 + queueLength);
+		throughput = n / (delayTime + residenceTime);
+		queueLength = throughput * residenceTime;
+	}
+	estimate.throughput = throughput * 3600000.0;
+	estimate.utilization = throughput * queueServiceTime;
+	// MVA assumes exponential service. Scale the wait by (1 + cs^2) / 2 as Allen-Cunneen does,
+	// since unloading times are far less variable (constant by default).
+	// Near saturation the wait is set by the fleet size instead, which the asymptotic bound gives.
+	const double saturatedWait = truckCount * queueServiceTime - m_meanThinkTime - m_meanUnloadingTime;
+	estimate.meanQueueWait = std::max((residenceTime - queueServiceTime) * (1 + m_unloadingVariation) / 2, saturatedWait);
+	estimate.meanQueueLength = throughput * estimate.meanQueueWait;
+	return estimate;
+}
+
+double AnalyticalEstimator::GetMeanUnloadingTime() const
+{
+	return m_meanUnloadingTime;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file  AnalyticalEstimator.h
+ *
+ * This file contains AnalyticalEstimator class. It predicts the station
+ * utilization and queue wait of a scenario in microseconds with mean
+ * value analysis of a closed queueing network:
+ *  - the trucks are the customers of the network,
+ *  - travel to the site, loading and travel back are an infinite
+ *    server delay (think time),
+ *  - the unloading stations are one multi server queue, approximated
+ *    by Seidmann's method as a single server with 1/c of the service
+ *    time followed by a delay with the rest of it.
+ * The queue wait is corrected for the variability of the unloading time.
+ */
+
+#ifndef ANALYTICALESTIMATOR_H_
+#define ANALYTICALESTIMATOR_H_
+
+#include <cstdint>
+#include "Scenario.h"
+
+/**
+ * Steady-state prediction for one configuration
+ */
+struct AnalyticalEstimate
+{
+	// Unloadings per hour of all the stations
+	double throughput;
+	// Mean fraction of time a station is unloading
+	double utilization;
+	// Mean waiting time in the station queue in milliseconds
+	double meanQueueWait;
+	// Mean number of trucks waiting in the station queues
+	double meanQueueLength;
+};
+
+/**
+ * AnalyticalEstimator class
+ */
+class AnalyticalEstimator
+{
+public:
+	/**
+	 * Constructor. Takes the mean cycle times of the scenario, averaged
+	 * over its trucks and stations.
+	 *
+	 * @param[in] scenario   Scenario to estimate
+	 */
+	AnalyticalEstimator(const Scenario& scenario);
+	/**
+	 * Predict the steady state of the scenario with the given fleet.
+	 * Cost is linear in the number of trucks.
+	 *
+	 * @param[in] stationCount  Number of unloading stations
+	 * @param[in] truckCount    Number of trucks
+	 *
+	 * @return    Steady-state prediction
+	 */
+	AnalyticalEstimate Estimate(uint32_t stationCount, uint32_t truckCount) const;
+	/**
+	 * Get the mean unloading time
+	 *
+	 * @return   Double  Time in milliseconds
+	 */
+	double GetMeanUnloadingTime() const;
+
+private:
+	// Mean time of travel, loading and travel back in milliseconds
+	double m_meanThinkTime;
+	// Mean unloading time in milliseconds
+	double m_meanUnloadingTime;
+	// Squared coefficient of variation of the unloading time
+	double m_unloadingVariation;
+};
+
+#endif /* ANALYTICALESTIMATOR_H_ */
@@ -0,0 +1,79 @@
+/**
+ * @file  Arena.cpp
+ *
+ * Arena class methods implementation
+ */
+
+#include <cstdint>
+#include "Arena.h"
+
+Arena::Arena(size_t capacity)
+{
+	m_head = NULL;
+	m_blockCapacity = capacity;
+	m_usedBytes = 0;
+	AddBlock(capacity);
+}
+
+Arena::~Arena()
+{
+	while (m_head)
+	{
+		Block* next = m_head->next;
+		::operator delete(m_head);
+		m_head = next;
+	}
+}
+
+void Arena::AddBlock(size_t capacity)
+{
+	// The block memory is not touched here, so the pages are placed by the
+	// thread which first constructs an object in them.
+	Block* block = static_cast<Block*>(::operator new(sizeof(Block) + capacity));
+	block->next = m_head;
+	block->capacity = capacity;
+	block->used = 0;
+	m_head = block;
+}
+
+void* Arena::Allocate(size_t size, size_t alignment)
+{
+	uintptr_t base = reinterpret_cast<uintptr_t>(m_head + 1);
+	uintptr_t start = (base + m_head->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if (start + size > base + m_head->capacity)
+	{
+		AddBlock(size + alignment > m_blockCapacity ? size + alignment : m_blockCapacity);
+		base = reinterpret_cast<uintptr_t>(m_head + 1);
+		start = (base + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+	m_usedBytes += (start + size) - (base + m_head->used);
+	m_head->used = (start + size) - base;
+	return reinterpret_cast<void*>(start);
+}
+
+void Arena::Reset()
+{
+	while (m_head->next)
+	{
+		Block* next = m_head->next;
+		::operator delete(m_head);
+		m_head = next;
+	}
+	m_head->used = 0;
+	m_usedBytes = 0;
+}
+
+size_t Arena::GetUsedBytes() const
+{
+	return m_usedBytes;
+}
+
+size_t Arena::GetBlockCount() const
+{
+	size_t count = 0;
+	for (Block* block = m_head; block; block = block->next)
+	{
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file  Arena.h
+ *
+ * This file contains Arena class. Arena is a simulation lifetime
+ * bump allocator. All the objects of a run are carved from one bulk
+ * block and released together when the arena is destroyed.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/**
+ * Arena class
+ * It is not thread safe. Objects are created by one thread during setup.
+ */
+class Arena
+{
+public:
+	/**
+	 * Constructor. Allocates the first block in one bulk allocation.
+	 *
+	 * @param[in] capacity  Size of the first block in bytes. When it is
+	 *                      exhausted, another block of the same size (or
+	 *                      of the requested size if bigger) is chained.
+	 */
+	Arena(size_t capacity);
+	/**
+	 * Destructor. Releases all the blocks. Destructors of the objects
+	 * created in the arena are not called.
+	 */
+	~Arena();
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	/**
+	 * Allocate raw memory from the arena
+	 *
+	 * @param[in] size       Size in bytes
+	 * @param[in] alignment  Alignment in bytes. Must be a power of two.
+	 *
+	 * @return    Pointer to the memory. It is never NULL.
+	 */
+	void* Allocate(size_t size, size_t alignment);
+	/**
+	 * Create an object in the arena
+	 *
+	 * @tparam    T      Type of the object
+	 * @param[in] args   Constructor arguments
+	 *
+	 * @return    Pointer to the new object
+	 */
+	template<typename T, typename... Args> T* New(Args&&... args)
+	{
+		return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+	/**
+	 * Release every block except the first one and make the whole
+	 * first block available again.
+	 */
+	void Reset();
+	/**
+	 * Get the number of bytes handed out since construction or Reset
+	 *
+	 * @return   Unsigned Integer  Used bytes
+	 */
+	size_t GetUsedBytes() const;
+	/**
+	 * Get the number of blocks currently held by the arena
+	 *
+	 * @return   Unsigned Integer  Number of blocks. 1 if the initial
+	 *                             capacity was big enough.
+	 */
+	size_t GetBlockCount() const;
+
+private:
+	/**
+	 * Header placed at the beginning of every block
+	 */
+	struct Block
+	{
+		// Next block of the chain
+		Block* next;
+		// Usable bytes after the header
+		size_t capacity;
+		// Bytes used in this block
+		size_t used;
+	};
+	/**
+	 * Allocate a new block and put it at the head of the chain
+	 *
+	 * @param[in] capacity  Usable bytes of the block
+	 */
+	void AddBlock(size_t capacity);
+
+	// Current block. Older blocks are reached by Block::next.
+	Block* m_head;
+	// Capacity used for chained blocks
+	size_t m_blockCapacity;
+	// Bytes handed out in all the blocks
+	size_t m_usedBytes;
+};
+
+#endif /* ARENA_H_ */
@@ -30,5 +30,17 @@ static const uint32_t kMaxloadingTimeInHour = 5;
 static const uint32_t kSimulationTimeInHour = 72;
 //Factor value to reduce the time to speed up the test
 static const uint32_t kFactorValue = 100;
+//Unloading time in percent added to the waiting time of a station on another NUMA node
+static const uint32_t kNumaRemoteWaitPenaltyPercent = 50;
+//Payload in tonnes of a truck which has no truck class
+static const uint32_t kDefaultTruckPayload = 100;
+//Simulated minutes per throughput batch of the warm-up and early stop detector
+static const uint32_t kSteadyStateBatchMinutes = 30;
+//Steady-state batches needed before the run may stop early
+static const uint32_t kSteadyStateMinimumBatches = 20;
+//Predicted station utilization in percent above which a sweep point is not simulated
+static const uint32_t kSweepSaturatedUtilizationPercent = 97;
+//Predicted queue wait, in percent of the unloading time, which counts as no wait in a sweep
+static const uint32_t kSweepNegligibleWaitPercent = 1;
 
 #endif /* CONSTANTS_H_ */
@@ -0,0 +1,266 @@
+/**
+ * @file  DigitalTwin.cpp
+ *
+ * DigitalTwin class methods implementation
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "DigitalTwin.h"
+#include "SimMetrics.h"
+
+// Normal quantile of a two sided 95% confidence interval
+static const double kConfidenceQuantile = 1.96;
+
+/**
+ * Find a truck state by its name
+ *
+ * @param[in]  name    Name of the state, e.g. "loading_mine"
+ * @param[out] state   Truck state
+ *
+ * @return     bool    True if the name is a state, otherwise False.
+ */
+static bool FindTruckState(const std::string& name, TruckState& state)
+{
+	for (uint32_t i = 0; i < kTruckStateCount; ++i)
+	{
+		if (name == GetTruckStateName((TruckState)i))
+		{
+			state = (TruckState)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+DigitalTwin::DigitalTwin(const Scenario& scenario, uint32_t replications)
+	: m_scenario(scenario),
+	  m_replications(std::max(1u, replications)),
+	  m_trucks(scenario.GetTruckCount(), TruckTelemetry{ TruckState::empty, 0, 0, false }),
+	  m_telemetryTime(0),
+	  m_eventCount(0)
+{
+}
+
+bool DigitalTwin::ParseEvent(const std::string& line, TelemetryEvent& event, std::string& error)
+{
+	std::istringstream fields(line);
+	std::string time;
+	std::string state;
+	fields >> time >> event.truckId >> state;
+	if (!fields || !Scenario::ParseDuration(time, event.time) || !FindTruckState(state, event.state))
+	{
+		error = "expected <time> <truck id> <state> [<station id>]";
+		return false;
+	}
+	event.stationId = 0;
+	if (!(fields >> event.stationId) && !fields.eof())
+	{
+		error = "invalid station id";
+		return false;
+	}
+	if ((event.state == TruckState::unloading || event.state == TruckState::waiting_in_queue) && event.stationId == 0)
+	{
+		error = std::string(GetTruckStateName(event.state)) + " needs a station id";
+		return false;
+	}
+	return true;
+}
+
+bool DigitalTwin::Apply(const TelemetryEvent& event, std::string& error)
+{
+	const uint32_t truckIndex = event.truckId - 1;
+	if (event.truckId == 0 || truckIndex >= m_trucks.size() || m_scenario.GetTruck(truckIndex).truckId != event.truckId)
+	{
+		error = "truck " + std::to_string(event.truckId) + " is not in the scenario";
+		return false;
+	}
+	uint32_t stationIndex = 0;
+	if (event.stationId)
+	{
+		stationIndex = event.stationId - 1;
+		if (stationIndex >= m_scenario.GetStationCount() || m_scenario.GetStation(stationIndex).stationId != event.stationId)
+		{
+			error = "station " + std::to_string(event.stationId) + " is not in the scenario";
+			return false;
+		}
+	}
+	// Late events still update their truck, but the clock of the twin never goes back.
+	m_trucks[truckIndex] = TruckTelemetry{ event.state, event.time, stationIndex, true };
+	m_telemetryTime = std::max(m_telemetryTime, event.time);
+	m_eventCount++;
+	return true;
+}
+
+ForecastResult DigitalTwin::Forecast() const
+{
+	std::vector<TruckObservation> observations(m_trucks.size());
+	for (size_t i = 0; i < m_trucks.size(); ++i)
+	{
+		if (!m_trucks[i].reported)
+		{
+			observations[i] = TruckObservation{ TruckState::loading_mine, kUnknownElapsed, 0 };
+			continue;
+		}
+		observations[i].state = m_trucks[i].state;
+		observations[i].elapsed = m_telemetryTime - std::min(m_telemetryTime, m_trucks[i].enterTime);
+		observations[i].stationIndex = m_trucks[i].stationIndex;
+	}
+
+	std::vector<double> unloadsPerHour(m_replications);
+	std::vector<double> queueWaits(m_replications);
+	std::vector<std::thread> threads;
+	const uint32_t threadCount = std::max(1u, std::min(m_replications, std::thread::hardware_concurrency()));
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([this, &observations, &unloadsPerHour, &queueWaits, threadCount, t]() {
+			for (uint32_t r = t; r < m_replications; r += threadCount)
+			{
+				EventSimulationConfig config;
+				config.scenario = &m_scenario;
+				config.seed = m_scenario.GetSeed() + r;
+				config.commonRandomNumbers = true;
+				EventSimulation simulation(config);
+				simulation.ApplyObservations(observations);
+				simulation.Run();
+				uint64_t unloadCount = 0;
+				for (uint32_t i = 0; i < simulation.GetStationCount(); ++i)
+				{
+					unloadCount += simulation.GetStation(i).unloadCount;
+				}
+				unloadsPerHour[r] = unloadCount * 3600000.0 / m_scenario.GetSimulationTime();
+				queueWaits[r] = simulation.GetQueueWaitPercentile(95) / 60000.0;
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	ForecastResult result;
+	result.telemetryTime = m_telemetryTime;
+	result.eventCount = m_eventCount;
+	for (uint32_t r = 0; r < m_replications; ++r)
+	{
+		result.unloadsPerHour += unloadsPerHour[r] / m_replications;
+		result.queueWaitP95 += queueWaits[r] / m_replications;
+	}
+	if (m_replications > 1)
+	{
+		double sumOfSquares = 0;
+		for (uint32_t r = 0; r < m_replications; ++r)
+		{
+			sumOfSquares += (unloadsPerHour[r] - result.unloadsPerHour) * (unloadsPerHour[r] - result.unloadsPerHour);
+		}
+		result.unloadsHalfWidth = kConfidenceQuantile * std::sqrt(sumOfSquares / (m_replications - 1) / m_replications);
+	}
+	return result;
+}
+
+uint32_t DigitalTwin::Run(std::istream& telemetry, std::ostream& out)
+{
+	/**
+	 * Telemetry line with the time it is read
+	 */
+	struct ReceivedLine
+	{
+		// Content of the line
+		std::string text;
+		// Time the line is read
+		std::chrono::steady_clock::time_point arrival;
+	};
+	std::mutex guard;
+	std::condition_variable signal;
+	std::vector<ReceivedLine> inbox;
+	bool closed = false;
+
+	// The reader blocks on the stream, so a slow pipe never stalls a forecast and vice versa.
+	std::thread reader([&telemetry, &guard, &signal, &inbox, &closed]() {
+		std::string line;
+		while (std::getline(telemetry, line))
+		{
+			std::lock_guard<std::mutex> lock(guard);
+			inbox.push_back(ReceivedLine{ line, std::chrono::steady_clock::now() });
+			signal.notify_one();
+		}
+		std::lock_guard<std::mutex> lock(guard);
+		closed = true;
+		signal.notify_one();
+	});
+
+	std::vector<ReceivedLine> batch;
+	std::vector<double> latencies;
+	uint64_t lineNumber = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(guard);
+			signal.wait(lock, [&inbox, &closed] { return !inbox.empty() || closed; });
+			if (inbox.empty())
+			{
+				break;
+			}
+			batch.clear();
+			batch.swap(inbox);
+		}
+		bool applied = false;
+		for (const ReceivedLine& line : batch)
+		{
+			lineNumber++;
+			const size_t start = line.text.find_first_not_of(" \t\r");
+			if (start == std::string::npos || line.text[start] == '#')
+			{
+				continue;
+			}
+			TelemetryEvent event;
+			std::string error;
+			if (!ParseEvent(line.text, event, error) || !Apply(event, error))
+			{
+				out << "Telemetry line " << lineNumber << " skipped: " << error << "\n";
+				continue;
+			}
+			applied = true;
+		}
+		if (!applied)
+		{
+			continue;
+		}
+
+		ForecastResult result = Forecast();
+		result.latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batch.front().arrival).count();
+		latencies.push_back(result.latency);
+		SimMetrics::GetInstance()->AddForecast((uint64_t)(result.latency * 1000));
+		out << std::fixed << std::setprecision(2)
+		    << "Telemetry hour " << result.telemetryTime / 3600000.0 << ", " << result.eventCount << " events"
+		    << " | next " << m_scenario.GetSimulationTime() / 3600000.0 << " h: " << result.unloadsPerHour
+		    << " +/- " << result.unloadsHalfWidth << " unloads/hour, p95 queue wait " << result.queueWaitP95
+		    << " min | latency " << result.latency << " ms\n";
+		out.unsetf(std::ios::floatfield);
+		out << std::setprecision(6) << std::flush;
+	}
+	reader.join();
+
+	if (!latencies.empty())
+	{
+		std::vector<double> sorted(latencies);
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0;
+		for (double latency : latencies)
+		{
+			total += latency;
+		}
+		const size_t p95Rank = (size_t)std::ceil(0.95 * sorted.size());
+		out << "Forecasts                   : " << latencies.size() << "\n"
+		    << "Forecast latency (ms)       : mean " << total / latencies.size()
+		    << ", p95 " << sorted[p95Rank ? p95Rank - 1 : 0] << ", max " << sorted.back() << "\n";
+	}
+	return latencies.size();
+}
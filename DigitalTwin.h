@@ -0,0 +1,146 @@
+/**
+ * @file  DigitalTwin.h
+ *
+ * This file contains DigitalTwin class. It follows a recorded stream of
+ * truck state changes and, every time new telemetry arrives, forecasts
+ * the next hours with replications of the event driven engine started
+ * from the observed truck states and station queues.
+ *
+ * A telemetry line is
+ *     <time> <truck id> <state> [<station id>]
+ * e.g. "7h 17 waiting_in_queue 2". The time is a duration since the
+ * start of the recording, the state is a name of GetTruckStateName and
+ * the station is given for unloading and waiting_in_queue. Empty lines
+ * and lines starting with '#' are skipped. A truck without telemetry yet
+ * is forecast as loading at a drawn point of its loading time, so the
+ * unreported part of the fleet does not reach the stations at once.
+ */
+
+#ifndef DIGITALTWIN_H_
+#define DIGITALTWIN_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "EventSimulation.h"
+#include "Scenario.h"
+
+/**
+ * Truck state change of the telemetry
+ */
+struct TelemetryEvent
+{
+	// Time of the change in milliseconds
+	uint64_t time;
+	// Truck Id
+	uint32_t truckId;
+	// New state of the truck
+	TruckState state;
+	// Station Id. 0 if the state has no station.
+	uint32_t stationId;
+};
+
+/**
+ * Forecast from the telemetry received so far
+ */
+struct ForecastResult
+{
+	// Time of the latest telemetry event in milliseconds
+	uint64_t telemetryTime = 0;
+	// Number of telemetry events applied
+	uint64_t eventCount = 0;
+	// Mean unloads per hour over the horizon
+	double unloadsPerHour = 0;
+	// 95% confidence half-width of unloadsPerHour
+	double unloadsHalfWidth = 0;
+	// Mean over the replications of the p95 queue wait in minutes
+	double queueWaitP95 = 0;
+	// Time from the arrival of the oldest telemetry line of the refresh
+	// until the forecast is ready, in milliseconds
+	double latency = 0;
+};
+
+/**
+ * DigitalTwin class
+ */
+class DigitalTwin
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] scenario       Scenario of the fleet. Its simulated time is
+	 *                           the forecast horizon. It must outlive the twin.
+	 * @param[in] replications   Forecast replications run in parallel per refresh
+	 */
+	DigitalTwin(const Scenario& scenario, uint32_t replications);
+	/**
+	 * Parse a telemetry line
+	 *
+	 * @param[in]  line    Telemetry line
+	 * @param[out] event   Parsed event
+	 * @param[out] error   Description of the problem if parsing fails
+	 *
+	 * @return     bool    True if the line is an event, otherwise False.
+	 */
+	static bool ParseEvent(const std::string& line, TelemetryEvent& event, std::string& error);
+	/**
+	 * Apply a telemetry event to the observed fleet state
+	 *
+	 * @param[in]  event   Telemetry event
+	 * @param[out] error   Description of the problem if the event does not fit the scenario
+	 *
+	 * @return     bool    True if the event is applied, otherwise False.
+	 */
+	bool Apply(const TelemetryEvent& event, std::string& error);
+	/**
+	 * Forecast the horizon from the observed fleet state. Replication r
+	 * uses the same common random numbers in every refresh, so two
+	 * forecasts differ by the telemetry rather than by sampling noise.
+	 *
+	 * @return    ForecastResult  Forecast without latency
+	 */
+	ForecastResult Forecast() const;
+	/**
+	 * Read telemetry until the end of the stream. A reader thread keeps
+	 * taking lines while a forecast runs; every refresh applies all the
+	 * lines received since the previous one and prints a new forecast.
+	 *
+	 * @param[in]  telemetry   Telemetry stream, e.g. a file or a pipe
+	 * @param[out] out         Forecasts and the latency summary are printed here
+	 *
+	 * @return     uint32_t    Number of forecasts
+	 */
+	uint32_t Run(std::istream& telemetry, std::ostream& out);
+
+private:
+	/**
+	 * Latest telemetry of a truck
+	 */
+	struct TruckTelemetry
+	{
+		// State of the truck
+		TruckState state;
+		// Time the truck entered the state in milliseconds
+		uint64_t enterTime;
+		// Zero based station index
+		uint32_t stationIndex;
+		// True once a telemetry event of the truck is applied
+		bool reported;
+	};
+
+	// Scenario of the fleet
+	const Scenario& m_scenario;
+	// Forecast replications per refresh
+	uint32_t m_replications;
+	// Latest telemetry of every truck, by truck index
+	std::vector<TruckTelemetry> m_trucks;
+	// Time of the latest telemetry event in milliseconds
+	uint64_t m_telemetryTime;
+	// Number of telemetry events applied
+	uint64_t m_eventCount;
+};
+
+#endif /* DIGITALTWIN_H_ */
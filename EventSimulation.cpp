@@ -0,0 +1,1206 @@
+/**
+ * @file  EventSimulation.cpp
+ *
+ * This file contains EventSimulation class methods implementation.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include "EventSimulation.h"
+#include "AllocationCounter.h"
+#include "SimMetrics.h"
+#include "ShardExchange.h"
+
+// Magic value at the start of a checkpoint file
+static const char kCheckpointMagic[8] = { 'M', 'I', 'N', 'E', 'C', 'K', 'P', '1' };
+// Version of the checkpoint layout
+static const uint32_t kCheckpointVersion = 4;
+// Largest size of the random number generator state text. The 312 words of mt19937_64 take under 7 KB.
+static const uint64_t kCheckpointRandomStateLimit = 8192;
+
+/**
+ * Header of a checkpoint file. It is followed by the random number
+ * generator state text, the truck records, the station records and
+ * the pending events in heap order and the queue wait histogram.
+ */
+struct CheckpointHeader
+{
+	// kCheckpointMagic
+	char magic[8];
+	// kCheckpointVersion
+	uint32_t version;
+	// Number of truck records
+	uint32_t truckCount;
+	// Number of station records
+	uint32_t stationCount;
+	// Number of pending events
+	uint32_t pendingCount;
+	// Scenario::GetFingerprint of the scenario of the run
+	uint64_t scenarioFingerprint;
+	// Simulated time in milliseconds
+	uint64_t now;
+	// Next event sequence number
+	uint64_t sequence;
+	// Number of processed events
+	uint64_t processedEvents;
+	// Size of the random number generator state text
+	uint64_t randomStateSize;
+};
+
+// Number of events between two updates of the simulated time and event counters
+static const uint64_t kMetricsPublishInterval = 1024;
+// Number of batches of the perturbation analysis confidence intervals
+static const uint32_t kGradientBatchCount = 20;
+// Largest number of statistics copies kept for the end of the warm-up. It must be even.
+static const uint32_t kSteadyStateCopyLimit = 32;
+
+/**
+ * Get the number of trucks the simulation holds at the start
+ *
+ * @param[in] config   Configuration of the run
+ *
+ * @return    Unsigned Integer  Number of trucks
+ */
+static uint32_t GetHeldTruckCount(const EventSimulationConfig& config)
+{
+	if (!config.shardExchange)
+	{
+		return config.scenario->GetTruckCount();
+	}
+	// Shards start with every Nth truck.
+	const uint32_t shardCount = config.shardExchange->GetShardCount();
+	return (config.scenario->GetTruckCount() + shardCount - 1 - config.shardIndex) / shardCount;
+}
+
+/**
+ * Get the arena size needed for the whole run, so setup is one bulk allocation
+ *
+ * @param[in] config   Configuration of the run
+ *
+ * @return    Unsigned Integer  Size in bytes
+ */
+static size_t GetArenaCapacity(const EventSimulationConfig& config)
+{
+	// Index arrays span the whole fleet, records only the trucks held.
+	return (size_t)GetHeldTruckCount(config) * (sizeof(TruckRecord) + sizeof(SimulationEvent))
+	     + (size_t)config.scenario->GetTruckCount() * 2 * sizeof(void*)
+	     + (size_t)config.scenario->GetStationCount() * sizeof(StationRecord)
+	     + EventSimulation::kQueueWaitBucketCount * sizeof(uint64_t)
+	     + 8 * alignof(std::max_align_t);
+}
+
+/**
+ * SplitMix64 finalizer. Turns a key into 64 well mixed bits.
+ *
+ * @param[in] value   Key
+ *
+ * @return    Unsigned Integer  Mixed bits
+ */
+static uint64_t MixBits(uint64_t value)
+{
+	value += 0x9e3779b97f4a7c15ULL;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+	return value ^ (value >> 31);
+}
+
+/**
+ * Get the derivative of a drawn time with respect to the mean of its
+ * distribution, when the whole distribution scales with its mean
+ *
+ * @param[in] range   Distribution the time is drawn from
+ * @param[in] time    Drawn time in milliseconds
+ *
+ * @return    Double  Derivative
+ */
+static double GetScaleDerivative(const ScenarioDistribution& range, uint64_t time)
+{
+	const double mean = (range.minimum + range.maximum) / 2.0;
+	return mean > 0 ? time / mean : 0;
+}
+
+/**
+ * Order of the pending event heap. Earliest event is on top.
+ */
+static bool IsLater(const SimulationEvent* left, const SimulationEvent* right)
+{
+	if (left->time != right->time)
+	{
+		return left->time > right->time;
+	}
+	return left->sequence > right->sequence;
+}
+
+EventSimulation::EventSimulation(const EventSimulationConfig& config)
+	: m_config(config),
+	  m_scenario(*config.scenario),
+	  m_trucksCount(config.scenario->GetTruckCount()),
+	  m_stationsCount(config.scenario->GetStationCount()),
+	  m_arena(GetArenaCapacity(config)),
+	  m_eventPool(m_arena, GetHeldTruckCount(config)),
+	  m_truckPool(m_arena, GetHeldTruckCount(config)),
+	  m_perturbation(config.scenario->GetSimulationTime(), kGradientBatchCount),
+	  m_random(config.seed)
+{
+	m_now = 0;
+	m_statisticsStart = 0;
+	m_sequence = 0;
+	m_processedEvents = 0;
+	m_publishedEvents = 0;
+	m_steadyStateAllocations = 0;
+	m_handOffCount = 0;
+	m_pendingCount = 0;
+	memset(m_truckStateCounts, 0, sizeof(m_truckStateCounts));
+	m_timeSeries = NULL;
+	m_nextSampleTime = UINT64_MAX;
+	m_sampleQueueDepths = NULL;
+	m_sampleStationCount = 0;
+
+	m_eventPool.Reserve(GetHeldTruckCount(config));
+	m_truckPool.Reserve(GetHeldTruckCount(config));
+	m_trucks = static_cast<TruckRecord**>(m_arena.Allocate(sizeof(TruckRecord*) * m_trucksCount, alignof(TruckRecord*)));
+	m_pendingEvents = static_cast<SimulationEvent**>(m_arena.Allocate(sizeof(SimulationEvent*) * m_trucksCount, alignof(SimulationEvent*)));
+	m_stations = static_cast<StationRecord*>(m_arena.Allocate(sizeof(StationRecord) * m_stationsCount, alignof(StationRecord)));
+	m_queueWaitHistogram = static_cast<uint64_t*>(m_arena.Allocate(sizeof(uint64_t) * kQueueWaitBucketCount, alignof(uint64_t)));
+	memset(m_queueWaitHistogram, 0, sizeof(uint64_t) * kQueueWaitBucketCount);
+
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		const ScenarioStation& scenarioStation = m_scenario.GetStation(i);
+		const ScenarioDistribution& unloading = m_scenario.GetDistribution(scenarioStation.unloadingDistribution);
+		StationRecord& station = m_stations[i];
+		station.stationId = scenarioStation.stationId;
+		station.unloadingDistribution = scenarioStation.unloadingDistribution;
+		station.meanUnloadingTime = (unloading.minimum + unloading.maximum) / 2;
+		station.queueHead = kNoTruck;
+		station.queueTail = kNoTruck;
+		station.queueLength = 0;
+		station.busy = false;
+		station.busyUntil = 0;
+		station.unloadCount = 0;
+		station.unloadedTonnes = 0;
+		station.capacity = scenarioStation.capacity;
+		station.busyTime = 0;
+		station.siteNode = config.roadNetwork ? config.roadNetwork->GetStationDump(i) : 0;
+		station.enRoute = 0;
+	}
+
+	// Trucks keep only their class index, so the hot path reads their times and payload from the small class table.
+	m_truckClassCount = m_scenario.GetTruckClassCount();
+	m_truckClasses = &m_scenario.GetTruckClass(0);
+
+	if (config.perturbationAnalysis)
+	{
+		m_perturbation.Resize(m_trucksCount, m_stationsCount);
+	}
+
+	// Every truck starts empty at the same time and travels to the mine site.
+	for (uint32_t i = 0; i < m_trucksCount; ++i)
+	{
+		if (config.shardExchange && i % config.shardExchange->GetShardCount() != config.shardIndex)
+		{
+			m_trucks[i] = NULL;
+			continue;
+		}
+		const ScenarioTruck& scenarioTruck = m_scenario.GetTruck(i);
+		TruckRecord* truck = m_truckPool.Acquire();
+		truck->truckId = scenarioTruck.truckId;
+		truck->truckClass = scenarioTruck.truckClass;
+		truck->state = TruckState::travel_to_mine_site;
+		truck->stationIndex = 0;
+		truck->nextInQueue = kNoTruck;
+		truck->travelCount = 0;
+		truck->loadCount = 0;
+		truck->unloadCount = 0;
+		truck->totalLoadingTime = 0;
+		truck->totalQueueWaitTime = 0;
+		truck->queueEnterTime = 0;
+		truck->siteNode = config.roadNetwork ? config.roadNetwork->GetTruckPit(i) : 0;
+		m_trucks[i] = truck;
+		m_truckStateCounts[truck->state]++;
+		if (config.publishMetrics)
+		{
+			SimMetrics::GetInstance()->AddTruck(truck->state);
+		}
+		Schedule(DrawTravelTime(i), i, EventType::arrive_mine_site);
+	}
+}
+
+void EventSimulation::Run()
+{
+	RunUntil(m_scenario.GetSimulationTime());
+}
+
+void EventSimulation::RunUntil(uint64_t time)
+{
+	time = std::min(time, m_scenario.GetSimulationTime());
+	const uint64_t allocationsBefore = GetAllocationCount();
+	while (m_pendingCount > 0 && m_pendingEvents[0]->time <= time)
+	{
+		if (m_pendingEvents[0]->time > m_nextSampleTime)
+		{
+			RecordSamples(m_pendingEvents[0]->time);
+		}
+		std::pop_heap(m_pendingEvents, m_pendingEvents + m_pendingCount, IsLater);
+		SimulationEvent* event = m_pendingEvents[--m_pendingCount];
+		// Release first, so the next event of the truck reuses the same slot.
+		const SimulationEvent current = *event;
+		m_eventPool.Release(event);
+		m_now = current.time;
+		HandleEvent(current);
+		m_processedEvents++;
+		if (m_config.publishMetrics && m_processedEvents - m_publishedEvents >= kMetricsPublishInterval)
+		{
+			PublishProgress();
+		}
+	}
+	m_now = std::max(m_now, time);
+	if (time >= m_nextSampleTime)
+	{
+		RecordSamples(time + 1);
+	}
+	if (m_config.publishMetrics)
+	{
+		PublishProgress();
+	}
+	m_steadyStateAllocations += GetAllocationCount() - allocationsBefore;
+}
+
+bool EventSimulation::RunUntilSteadyState(SteadyStateDetector& detector)
+{
+	// Counters at the batch starts the warm-up may end at, so it can be taken out once its length is
+	// known. They are copied every step batches, and the step doubles when the copies reach the
+	// limit, so the memory stays bounded however many batches the run takes.
+	std::vector<uint64_t> statistics;
+	AppendStatistics(statistics);
+	const size_t statisticsSize = statistics.size();
+	uint32_t step = 1;
+	detector.SetWarmupStep(step);
+	const uint64_t firstBatchStart = m_now;
+	uint64_t unloadCount = 0;
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		unloadCount += m_stations[i].unloadCount;
+	}
+	bool converged = false;
+	while (!converged && m_now < m_scenario.GetSimulationTime())
+	{
+		const uint64_t batchStart = m_now;
+		RunUntil(m_now + detector.GetBatchLength());
+		uint64_t batchUnloadCount = 0;
+		for (uint32_t i = 0; i < m_stationsCount; ++i)
+		{
+			batchUnloadCount += m_stations[i].unloadCount;
+		}
+		detector.AddBatch((batchUnloadCount - unloadCount) * 3600000.0 / (m_now - batchStart));
+		unloadCount = batchUnloadCount;
+		if (detector.GetBatchCount() % step == 0)
+		{
+			if (statistics.size() == kSteadyStateCopyLimit * statisticsSize)
+			{
+				// Keep the copies at the multiples of the doubled step
+				for (size_t i = 1; i < kSteadyStateCopyLimit / 2; ++i)
+				{
+					std::copy(statistics.begin() + 2 * i * statisticsSize, statistics.begin() + (2 * i + 1) * statisticsSize,
+					          statistics.begin() + i * statisticsSize);
+				}
+				statistics.resize(kSteadyStateCopyLimit / 2 * statisticsSize);
+				step *= 2;
+				detector.SetWarmupStep(step);
+			}
+			AppendStatistics(statistics);
+		}
+		converged = detector.IsConverged();
+	}
+	const uint32_t warmupBatches = detector.GetWarmupBatches();
+	if (warmupBatches)
+	{
+		SubtractStatistics(&statistics[warmupBatches / step * statisticsSize]);
+		m_statisticsStart = firstBatchStart + warmupBatches * detector.GetBatchLength();
+	}
+	return converged && m_now < m_scenario.GetSimulationTime();
+}
+
+void EventSimulation::AppendStatistics(std::vector<uint64_t>& statistics) const
+{
+	for (uint32_t i = 0; i < m_trucksCount; ++i)
+	{
+		const TruckRecord& truck = *m_trucks[i];
+		statistics.insert(statistics.end(), { truck.travelCount, truck.loadCount, truck.unloadCount,
+		                                      truck.totalLoadingTime, truck.totalQueueWaitTime });
+	}
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		const StationRecord& station = m_stations[i];
+		statistics.insert(statistics.end(), { station.unloadCount, station.unloadedTonnes, station.busyTime });
+	}
+	statistics.insert(statistics.end(), m_queueWaitHistogram, m_queueWaitHistogram + kQueueWaitBucketCount);
+}
+
+void EventSimulation::SubtractStatistics(const uint64_t* statistics)
+{
+	for (uint32_t i = 0; i < m_trucksCount; ++i)
+	{
+		TruckRecord& truck = *m_trucks[i];
+		truck.travelCount -= *statistics++;
+		truck.loadCount -= *statistics++;
+		truck.unloadCount -= *statistics++;
+		truck.totalLoadingTime -= *statistics++;
+		truck.totalQueueWaitTime -= *statistics++;
+	}
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		StationRecord& station = m_stations[i];
+		station.unloadCount -= *statistics++;
+		station.unloadedTonnes -= *statistics++;
+		station.busyTime -= *statistics++;
+	}
+	for (uint32_t i = 0; i < kQueueWaitBucketCount; ++i)
+	{
+		m_queueWaitHistogram[i] -= *statistics++;
+	}
+}
+
+bool EventSimulation::SaveCheckpoint(const std::string& path) const
+{
+	// The standard engine only exposes its state through the stream operators.
+	std::ostringstream randomState;
+	randomState << m_random;
+	const std::string randomText = randomState.str();
+
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+	header.version = kCheckpointVersion;
+	header.truckCount = m_trucksCount;
+	header.stationCount = m_stationsCount;
+	header.pendingCount = m_pendingCount;
+	header.scenarioFingerprint = m_scenario.GetFingerprint();
+	header.now = m_now;
+	header.sequence = m_sequence;
+	header.processedEvents = m_processedEvents;
+	header.randomStateSize = randomText.size();
+
+	// Write to a temporary file and rename, so an interruption never leaves a torn checkpoint.
+	const std::string temporaryPath = path + ".tmp";
+	FILE* file = fopen(temporaryPath.c_str(), "wb");
+	if (!file)
+	{
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+	               fwrite(randomText.data(), 1, randomText.size(), file) == randomText.size();
+	for (uint32_t i = 0; written && i < m_trucksCount; ++i)
+	{
+		written = fwrite(m_trucks[i], sizeof(TruckRecord), 1, file) == 1;
+	}
+	written = written && fwrite(m_stations, sizeof(StationRecord), m_stationsCount, file) == m_stationsCount;
+	for (uint32_t i = 0; written && i < m_pendingCount; ++i)
+	{
+		written = fwrite(m_pendingEvents[i], sizeof(SimulationEvent), 1, file) == 1;
+	}
+	written = written && fwrite(m_queueWaitHistogram, sizeof(uint64_t), kQueueWaitBucketCount, file) == kQueueWaitBucketCount;
+	written = (fclose(file) == 0) && written;
+	if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool EventSimulation::RestoreCheckpoint(const std::string& path, std::string& error)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	CheckpointHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+	    memcmp(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0 ||
+	    header.version != kCheckpointVersion)
+	{
+		fclose(file);
+		error = path + " is not a checkpoint file";
+		return false;
+	}
+	if (header.truckCount != m_trucksCount || header.stationCount != m_stationsCount ||
+	    header.pendingCount > m_trucksCount || header.scenarioFingerprint != m_scenario.GetFingerprint())
+	{
+		fclose(file);
+		error = "checkpoint was taken with a different scenario";
+		return false;
+	}
+	if (header.randomStateSize > kCheckpointRandomStateLimit)
+	{
+		fclose(file);
+		error = "checkpoint file is corrupt";
+		return false;
+	}
+
+	// Everything is read and checked before the engine is touched, so a bad file leaves it as it was.
+	std::string randomText(header.randomStateSize, '\0');
+	std::vector<TruckRecord> trucks(m_trucksCount);
+	std::vector<StationRecord> stations(m_stationsCount);
+	std::vector<SimulationEvent> events(header.pendingCount);
+	std::vector<uint64_t> queueWaitHistogram(kQueueWaitBucketCount);
+	const bool read = fread(&randomText[0], 1, randomText.size(), file) == randomText.size() &&
+	                  fread(trucks.data(), sizeof(TruckRecord), trucks.size(), file) == trucks.size() &&
+	                  fread(stations.data(), sizeof(StationRecord), stations.size(), file) == stations.size() &&
+	                  fread(events.data(), sizeof(SimulationEvent), events.size(), file) == events.size() &&
+	                  fread(queueWaitHistogram.data(), sizeof(uint64_t), kQueueWaitBucketCount, file) == kQueueWaitBucketCount;
+	fclose(file);
+	std::mt19937_64 random;
+	std::istringstream randomState(randomText);
+	randomState >> random;
+	if (!read || randomState.fail())
+	{
+		error = "checkpoint file is truncated";
+		return false;
+	}
+	if (!IsValidCheckpoint(trucks, stations, events))
+	{
+		error = "checkpoint file is corrupt";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < m_trucksCount; ++i)
+	{
+		m_truckStateCounts[m_trucks[i]->state]--;
+		m_truckStateCounts[trucks[i].state]++;
+		if (m_config.publishMetrics)
+		{
+			SimMetrics::GetInstance()->MoveTruck(m_trucks[i]->state, trucks[i].state);
+		}
+		*m_trucks[i] = trucks[i];
+	}
+	memcpy(m_stations, stations.data(), sizeof(StationRecord) * m_stationsCount);
+	// Replace the pending events. The heap array is restored in the same order,
+	// so events are popped exactly as in the run which took the checkpoint.
+	while (m_pendingCount > 0)
+	{
+		m_eventPool.Release(m_pendingEvents[--m_pendingCount]);
+	}
+	for (const SimulationEvent& event : events)
+	{
+		SimulationEvent* pending = m_eventPool.Acquire();
+		*pending = event;
+		m_pendingEvents[m_pendingCount++] = pending;
+	}
+	memcpy(m_queueWaitHistogram, queueWaitHistogram.data(), sizeof(uint64_t) * kQueueWaitBucketCount);
+	m_random = random;
+	m_now = header.now;
+	m_sequence = header.sequence;
+	m_processedEvents = header.processedEvents;
+	m_publishedEvents = header.processedEvents;
+	if (m_config.publishMetrics)
+	{
+		for (uint32_t i = 0; i < m_stationsCount; ++i)
+		{
+			SimMetrics::GetInstance()->SetQueueDepth(i, m_stations[i].queueLength);
+		}
+		SimMetrics::GetInstance()->SetSimulatedTime(m_now);
+	}
+	return true;
+}
+
+bool EventSimulation::IsValidCheckpoint(const std::vector<TruckRecord>& trucks, const std::vector<StationRecord>& stations,
+                                        const std::vector<SimulationEvent>& events) const
+{
+	const uint32_t nodeCount = m_config.roadNetwork ? m_config.roadNetwork->GetNodeCount() : 1;
+	for (const TruckRecord& truck : trucks)
+	{
+		if ((uint32_t)truck.state >= kTruckStateCount || truck.truckClass >= m_truckClassCount ||
+		    truck.stationIndex >= m_stationsCount || truck.siteNode >= nodeCount ||
+		    (truck.nextInQueue != kNoTruck && truck.nextInQueue >= m_trucksCount))
+		{
+			return false;
+		}
+	}
+	for (const StationRecord& station : stations)
+	{
+		if (station.unloadingDistribution >= m_scenario.GetDistributionCount() || station.siteNode >= nodeCount ||
+		    (station.queueHead != kNoTruck && station.queueHead >= m_trucksCount) ||
+		    (station.queueTail != kNoTruck && station.queueTail >= m_trucksCount) ||
+		    ((station.queueHead == kNoTruck) != (station.queueLength == 0)))
+		{
+			return false;
+		}
+	}
+	for (const SimulationEvent& event : events)
+	{
+		if (event.truckIndex >= m_trucksCount || event.type > EventType::unloading_done)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void EventSimulation::AddStations(uint32_t count)
+{
+	// Records are kept contiguous, so the array is moved to a larger block of the arena.
+	StationRecord* stations = static_cast<StationRecord*>(
+		m_arena.Allocate(sizeof(StationRecord) * (m_stationsCount + count), alignof(StationRecord)));
+	memcpy(stations, m_stations, sizeof(StationRecord) * m_stationsCount);
+	uint32_t nextId = 0;
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		nextId = std::max(nextId, m_stations[i].stationId);
+	}
+	for (uint32_t i = m_stationsCount; i < m_stationsCount + count; ++i)
+	{
+		StationRecord& station = stations[i];
+		station = stations[0];
+		station.stationId = ++nextId;
+		station.queueHead = kNoTruck;
+		station.queueTail = kNoTruck;
+		station.queueLength = 0;
+		station.busy = false;
+		station.busyUntil = 0;
+		station.unloadCount = 0;
+		station.unloadedTonnes = 0;
+		station.busyTime = 0;
+		station.siteNode = m_config.roadNetwork ? m_config.roadNetwork->GetStationDump(i) : 0;
+		station.enRoute = 0;
+	}
+	m_stations = stations;
+	m_stationsCount += count;
+	if (m_config.perturbationAnalysis)
+	{
+		m_perturbation.Resize(m_trucksCount, m_stationsCount);
+	}
+}
+
+void EventSimulation::AddTrucks(uint32_t count)
+{
+	// Every truck has at most one pending event, so both arrays grow with the fleet.
+	const uint32_t trucksCount = m_trucksCount + count;
+	TruckRecord** trucks = static_cast<TruckRecord**>(m_arena.Allocate(sizeof(TruckRecord*) * trucksCount, alignof(TruckRecord*)));
+	SimulationEvent** pendingEvents = static_cast<SimulationEvent**>(
+		m_arena.Allocate(sizeof(SimulationEvent*) * trucksCount, alignof(SimulationEvent*)));
+	memcpy(trucks, m_trucks, sizeof(TruckRecord*) * m_trucksCount);
+	memcpy(pendingEvents, m_pendingEvents, sizeof(SimulationEvent*) * m_pendingCount);
+	m_trucks = trucks;
+	m_pendingEvents = pendingEvents;
+	m_eventPool.Reserve(count);
+	m_truckPool.Reserve(count);
+	if (m_config.perturbationAnalysis)
+	{
+		m_perturbation.Resize(trucksCount, m_stationsCount);
+	}
+
+	uint32_t nextId = 0;
+	for (uint32_t i = 0; i < m_trucksCount; ++i)
+	{
+		nextId = std::max(nextId, m_trucks[i]->truckId);
+	}
+	for (uint32_t i = m_trucksCount; i < trucksCount; ++i)
+	{
+		TruckRecord* truck = m_truckPool.Acquire();
+		*truck = *m_trucks[0];
+		truck->truckId = ++nextId;
+		truck->state = TruckState::travel_to_mine_site;
+		truck->stationIndex = 0;
+		truck->nextInQueue = kNoTruck;
+		truck->travelCount = 0;
+		truck->loadCount = 0;
+		truck->unloadCount = 0;
+		truck->totalLoadingTime = 0;
+		truck->totalQueueWaitTime = 0;
+		truck->queueEnterTime = 0;
+		truck->siteNode = m_config.roadNetwork ? m_config.roadNetwork->GetTruckPit(i) : 0;
+		m_trucks[i] = truck;
+		m_truckStateCounts[truck->state]++;
+		if (m_config.publishMetrics)
+		{
+			SimMetrics::GetInstance()->AddTruck(truck->state);
+		}
+		Schedule(m_now + DrawTravelTime(i), i, EventType::arrive_mine_site);
+	}
+	m_trucksCount = trucksCount;
+}
+
+void EventSimulation::ApplyObservations(const std::vector<TruckObservation>& observations)
+{
+	// A valid scenario has stations. Without them no observed station could be kept.
+	if (m_stationsCount == 0)
+	{
+		return;
+	}
+	while (m_pendingCount > 0)
+	{
+		m_eventPool.Release(m_pendingEvents[--m_pendingCount]);
+	}
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		m_stations[i].queueHead = kNoTruck;
+		m_stations[i].queueTail = kNoTruck;
+		m_stations[i].queueLength = 0;
+		m_stations[i].busy = false;
+		m_stations[i].enRoute = 0;
+	}
+
+	std::vector<uint32_t> waiting;
+	for (uint32_t i = 0; i < m_trucksCount; ++i)
+	{
+		// Trucks without an observation start empty, as in a fresh run.
+		const TruckObservation observation = i < observations.size() ? observations[i]
+				: TruckObservation{ TruckState::empty, 0, 0 };
+		TruckRecord& truck = *m_trucks[i];
+		const uint32_t stationIndex = std::min(observation.stationIndex, m_stationsCount - 1);
+		uint64_t duration;
+		switch (observation.state)
+		{
+			case TruckState::loading_mine:
+				SetTruckState(truck, TruckState::loading_mine);
+				duration = DrawTime(m_truckClasses[truck.truckClass].loadingDistribution, truck, RandomStream::loading,
+						truck.loadCount);
+				truck.totalLoadingTime += duration;
+				Schedule(m_now + GetRemainingTime(duration, observation.elapsed), i, EventType::loading_done);
+				break;
+			case TruckState::travel_to_unloading_station:
+			case TruckState::approaching_unloading_station:
+				if (m_config.roadNetwork)
+				{
+					truck.stationIndex = stationIndex;
+					m_stations[stationIndex].enRoute++;
+				}
+				SetTruckState(truck, TruckState::travel_to_unloading_station);
+				duration = DrawTravelTime(i);
+				Schedule(m_now + GetRemainingTime(duration, observation.elapsed), i,
+						EventType::arrive_unloading_station);
+				break;
+			case TruckState::unloading:
+			{
+				StationRecord& station = m_stations[stationIndex];
+				truck.stationIndex = stationIndex;
+				if (station.busy)
+				{
+					// Two trucks reported unloading at one station. The later one is queued.
+					waiting.push_back(i);
+					break;
+				}
+				duration = DrawTime(station.unloadingDistribution, truck, RandomStream::unloading, truck.unloadCount);
+				duration = GetRemainingTime(duration, observation.elapsed);
+				station.busy = true;
+				station.busyUntil = m_now + duration;
+				station.busyTime += duration;
+				SetTruckState(truck, TruckState::unloading);
+				Schedule(station.busyUntil, i, EventType::unloading_done);
+				break;
+			}
+			case TruckState::waiting_in_queue:
+				truck.stationIndex = stationIndex;
+				waiting.push_back(i);
+				break;
+			default:
+				// Empty or on the way back to the mine site
+				SetTruckState(truck, TruckState::travel_to_mine_site);
+				duration = DrawTravelTime(i);
+				Schedule(m_now + GetRemainingTime(duration, observation.elapsed), i,
+						EventType::arrive_mine_site);
+				break;
+		}
+	}
+
+	// Queue the waiting trucks in arrival order. A station found idle starts with its first truck.
+	std::stable_sort(waiting.begin(), waiting.end(), [&observations](uint32_t a, uint32_t b) {
+		return observations[a].elapsed > observations[b].elapsed;
+	});
+	for (uint32_t truckIndex : waiting)
+	{
+		TruckRecord& truck = *m_trucks[truckIndex];
+		StationRecord& station = m_stations[truck.stationIndex];
+		if (!station.busy)
+		{
+			StartUnloading(truck.stationIndex, truckIndex);
+			continue;
+		}
+		SetTruckState(truck, TruckState::waiting_in_queue);
+		truck.queueEnterTime = m_now;
+		truck.nextInQueue = kNoTruck;
+		if (station.queueTail == kNoTruck)
+		{
+			station.queueHead = truckIndex;
+		}
+		else
+		{
+			m_trucks[station.queueTail]->nextInQueue = truckIndex;
+		}
+		station.queueTail = truckIndex;
+		station.queueLength++;
+	}
+}
+
+uint64_t EventSimulation::GetRemainingTime(uint64_t duration, uint64_t elapsed)
+{
+	if (elapsed == kUnknownElapsed)
+	{
+		return std::uniform_int_distribution<uint64_t>(0, duration)(m_random);
+	}
+	return duration > elapsed ? duration - elapsed : 0;
+}
+
+void EventSimulation::Schedule(uint64_t time, uint32_t truckIndex, EventType type)
+{
+	SimulationEvent* event = m_eventPool.Acquire();
+	event->time = time;
+	event->sequence = m_sequence++;
+	event->truckIndex = truckIndex;
+	event->type = type;
+	m_pendingEvents[m_pendingCount++] = event;
+	std::push_heap(m_pendingEvents, m_pendingEvents + m_pendingCount, IsLater);
+}
+
+void EventSimulation::HandleEvent(const SimulationEvent& event)
+{
+	TruckRecord& truck = *m_trucks[event.truckIndex];
+	switch (event.type)
+	{
+		case EventType::arrive_mine_site:
+		{
+			truck.travelCount++;
+			SetTruckState(truck, TruckState::loading_mine);
+			const uint64_t loadingTime = DrawTime(m_truckClasses[truck.truckClass].loadingDistribution, truck,
+			                                      RandomStream::loading, truck.loadCount);
+			truck.totalLoadingTime += loadingTime;
+			Schedule(m_now + loadingTime, event.truckIndex, EventType::loading_done);
+			break;
+		}
+		case EventType::loading_done:
+		{
+			truck.loadCount++;
+			if (m_config.roadNetwork)
+			{
+				// The destination decides the route, so the station is chosen before leaving.
+				truck.stationIndex = SelectRoutedStation(truck);
+				m_stations[truck.stationIndex].enRoute++;
+			}
+			else if (m_config.shardExchange)
+			{
+				// The station may be in another shard, so it is chosen before leaving.
+				truck.stationIndex = SelectStation();
+				m_stations[truck.stationIndex].enRoute++;
+			}
+			SetTruckState(truck, TruckState::travel_to_unloading_station);
+			const uint64_t arrivalTime = m_now + DrawTravelTime(event.truckIndex);
+			if (m_config.shardExchange &&
+			    m_config.shardExchange->GetStationShard(truck.stationIndex) != m_config.shardIndex)
+			{
+				HandOffTruck(event.truckIndex, arrivalTime);
+				break;
+			}
+			Schedule(arrivalTime, event.truckIndex, EventType::arrive_unloading_station);
+			break;
+		}
+		case EventType::arrive_unloading_station:
+		{
+			truck.travelCount++;
+			if (m_config.roadNetwork || m_config.shardExchange)
+			{
+				m_stations[truck.stationIndex].enRoute--;
+			}
+			else
+			{
+				truck.stationIndex = SelectStation();
+			}
+			if (m_config.perturbationAnalysis)
+			{
+				m_perturbation.Arrive(event.truckIndex);
+			}
+			StationRecord& station = m_stations[truck.stationIndex];
+			if (!station.busy)
+			{
+				RecordQueueWait(0);
+				StartUnloading(truck.stationIndex, event.truckIndex);
+				break;
+			}
+			SetTruckState(truck, TruckState::waiting_in_queue);
+			truck.queueEnterTime = m_now;
+			truck.nextInQueue = kNoTruck;
+			if (station.queueTail == kNoTruck)
+			{
+				station.queueHead = event.truckIndex;
+			}
+			else
+			{
+				m_trucks[station.queueTail]->nextInQueue = event.truckIndex;
+			}
+			station.queueTail = event.truckIndex;
+			station.queueLength++;
+			if (m_config.publishMetrics)
+			{
+				SimMetrics::GetInstance()->SetQueueDepth(truck.stationIndex, station.queueLength);
+			}
+			break;
+		}
+		case EventType::unloading_done:
+		{
+			truck.unloadCount++;
+			if (m_config.perturbationAnalysis)
+			{
+				m_perturbation.CompleteUnloading(event.truckIndex, m_now);
+			}
+			SetTruckState(truck, TruckState::travel_to_mine_site);
+			Schedule(m_now + DrawTravelTime(event.truckIndex), event.truckIndex, EventType::arrive_mine_site);
+
+			StationRecord& station = m_stations[truck.stationIndex];
+			station.unloadCount++;
+			station.unloadedTonnes += m_truckClasses[truck.truckClass].payload;
+			station.busy = false;
+			if (station.queueHead != kNoTruck)
+			{
+				const uint32_t nextTruck = station.queueHead;
+				station.queueHead = m_trucks[nextTruck]->nextInQueue;
+				if (station.queueHead == kNoTruck)
+				{
+					station.queueTail = kNoTruck;
+				}
+				station.queueLength--;
+				if (m_config.publishMetrics)
+				{
+					SimMetrics::GetInstance()->SetQueueDepth(truck.stationIndex, station.queueLength);
+				}
+				m_trucks[nextTruck]->totalQueueWaitTime += m_now - m_trucks[nextTruck]->queueEnterTime;
+				RecordQueueWait(m_now - m_trucks[nextTruck]->queueEnterTime);
+				if (m_config.perturbationAnalysis)
+				{
+					m_perturbation.LeaveQueue(nextTruck, truck.stationIndex);
+				}
+				StartUnloading(truck.stationIndex, nextTruck);
+			}
+			break;
+		}
+	}
+}
+
+uint32_t EventSimulation::SelectStation() const
+{
+	// Same rule as WaitingInQueue: remaining time of current truck plus the whole queue.
+	// A full station is taken only if every station is full.
+	uint32_t stationToUnload = 0;
+	uint64_t shortWaitTime = UINT64_MAX;
+	bool hasRoom = false;
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		const StationRecord& station = m_stations[i];
+		// Trucks on the way are counted only in sharded runs, where the station is chosen before leaving.
+		const bool stationHasRoom = station.capacity == 0 ||
+		                            station.queueLength + station.enRoute + station.busy < station.capacity;
+		if (hasRoom && !stationHasRoom)
+		{
+			continue;
+		}
+		uint64_t waitTime = (uint64_t)(station.queueLength + station.enRoute) * station.meanUnloadingTime;
+		// A station of another shard may have been published busy until a time already past.
+		if (station.busy && station.busyUntil > m_now)
+		{
+			waitTime += station.busyUntil - m_now;
+		}
+		if (waitTime < shortWaitTime || (stationHasRoom && !hasRoom))
+		{
+			stationToUnload = i;
+			shortWaitTime = waitTime;
+			hasRoom = stationHasRoom;
+		}
+	}
+	return stationToUnload;
+}
+
+uint32_t EventSimulation::SelectRoutedStation(const TruckRecord& truck) const
+{
+	const RoadNetwork& network = *m_config.roadNetwork;
+	uint32_t stationToUnload = 0;
+	uint64_t shortCycleTime = UINT64_MAX;
+	bool hasRoom = false;
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		const StationRecord& station = m_stations[i];
+		// Trucks already on the way count against the capacity of their station.
+		const bool stationHasRoom = station.capacity == 0 ||
+		                            station.queueLength + station.enRoute + station.busy < station.capacity;
+		if (hasRoom && !stationHasRoom)
+		{
+			continue;
+		}
+		const uint64_t travelTime = network.GetTravelTime(truck.siteNode, station.siteNode);
+		uint64_t backlog = (uint64_t)(station.queueLength + station.enRoute) * station.meanUnloadingTime;
+		if (station.busy)
+		{
+			backlog += station.busyUntil - m_now;
+		}
+		// The truck waits only for the part of the backlog left when it arrives.
+		const uint64_t cycleTime = std::max(travelTime, backlog) + station.meanUnloadingTime +
+		                           network.GetTravelTime(station.siteNode, truck.siteNode);
+		if (cycleTime < shortCycleTime || (stationHasRoom && !hasRoom))
+		{
+			stationToUnload = i;
+			shortCycleTime = cycleTime;
+			hasRoom = stationHasRoom;
+		}
+	}
+	return stationToUnload;
+}
+
+void EventSimulation::StartUnloading(uint32_t stationIndex, uint32_t truckIndex)
+{
+	StationRecord& station = m_stations[stationIndex];
+	const uint64_t unloadingTime = DrawTime(station.unloadingDistribution, *m_trucks[truckIndex], RandomStream::unloading,
+	                                        m_trucks[truckIndex]->unloadCount);
+	if (m_config.perturbationAnalysis)
+	{
+		const double derivative = GetScaleDerivative(m_scenario.GetDistribution(station.unloadingDistribution), unloadingTime);
+		m_perturbation.StartUnloading(truckIndex, stationIndex, derivative, m_now);
+	}
+	station.busy = true;
+	station.busyUntil = m_now + unloadingTime;
+	station.busyTime += unloadingTime;
+	SetTruckState(*m_trucks[truckIndex], TruckState::unloading);
+	Schedule(station.busyUntil, truckIndex, EventType::unloading_done);
+}
+
+void EventSimulation::RecordQueueWait(uint64_t waitTime)
+{
+	const uint64_t bucket = (waitTime + kQueueWaitBucketWidth - 1) / kQueueWaitBucketWidth;
+	m_queueWaitHistogram[std::min<uint64_t>(bucket, kQueueWaitBucketCount - 1)]++;
+}
+
+void EventSimulation::PublishProgress()
+{
+	SimMetrics::GetInstance()->SetSimulatedTime(m_now);
+	SimMetrics::GetInstance()->AddProcessedEvents(m_processedEvents - m_publishedEvents);
+	m_publishedEvents = m_processedEvents;
+}
+
+void EventSimulation::SetTimeSeriesRecorder(TimeSeriesRecorder* recorder)
+{
+	m_timeSeries = recorder;
+	m_nextSampleTime = recorder ? recorder->GetNextSampleTime() : UINT64_MAX;
+	if (recorder)
+	{
+		// Stations added later are not sampled; the recorder has a column for each station it was created with.
+		m_sampleStationCount = std::min(m_stationsCount, recorder->GetStationCount());
+		m_sampleQueueDepths = static_cast<int64_t*>(m_arena.Allocate(sizeof(int64_t) * recorder->GetStationCount(), alignof(int64_t)));
+		memset(m_sampleQueueDepths, 0, sizeof(int64_t) * recorder->GetStationCount());
+	}
+}
+
+void EventSimulation::RecordSamples(uint64_t time)
+{
+	// The state does not change between two events, so every sample due before the next one sees the same state.
+	for (uint32_t i = 0; i < m_sampleStationCount; ++i)
+	{
+		m_sampleQueueDepths[i] = m_stations[i].queueLength;
+	}
+	while (m_nextSampleTime < time)
+	{
+		m_timeSeries->AddSample(m_nextSampleTime, m_sampleQueueDepths, m_truckStateCounts);
+		m_nextSampleTime = m_timeSeries->GetNextSampleTime();
+	}
+}
+
+void EventSimulation::SetTruckState(TruckRecord& truck, TruckState state)
+{
+	m_truckStateCounts[truck.state]--;
+	m_truckStateCounts[state]++;
+	if (m_config.publishMetrics)
+	{
+		SimMetrics::GetInstance()->MoveTruck(truck.state, state);
+	}
+	truck.state = state;
+}
+
+uint64_t EventSimulation::DrawTime(uint32_t distribution, const TruckRecord& truck, RandomStream stream, uint32_t drawIndex)
+{
+	const ScenarioDistribution& range = m_scenario.GetDistribution(distribution);
+	if (range.minimum == range.maximum)
+	{
+		return range.minimum;
+	}
+	if (!m_config.commonRandomNumbers)
+	{
+		return std::uniform_int_distribution<uint64_t>(range.minimum, range.maximum)(m_random);
+	}
+	// The draw depends only on its key, never on how events of other trucks interleave.
+	uint64_t hash = MixBits(m_config.seed ^ ((uint64_t)truck.truckId << 32));
+	hash = MixBits(hash ^ ((uint64_t)stream << 32 | drawIndex));
+	const uint64_t span = range.maximum - range.minimum;
+	uint64_t offset = (uint64_t)(((unsigned __int128)hash * (span + 1)) >> 64);
+	if (m_config.antithetic)
+	{
+		offset = span - offset;
+	}
+	return range.minimum + offset;
+}
+
+uint64_t EventSimulation::DrawTravelTime(uint32_t truckIndex)
+{
+	const TruckRecord& truck = *m_trucks[truckIndex];
+	if (m_config.roadNetwork)
+	{
+		// Trucks start parked at their pit, then shuttle between the pit and the dump of their station.
+		if (truck.travelCount == 0)
+		{
+			return 0;
+		}
+		const uint32_t dump = m_stations[truck.stationIndex].siteNode;
+		return truck.state == TruckState::travel_to_unloading_station ? m_config.roadNetwork->GetTravelTime(truck.siteNode, dump)
+		                                                              : m_config.roadNetwork->GetTravelTime(dump, truck.siteNode);
+	}
+	const uint32_t travelDistribution = m_truckClasses[truck.truckClass].travelDistribution;
+	const uint64_t travelTime = DrawTime(travelDistribution, truck, RandomStream::travel, truck.travelCount);
+	if (m_config.perturbationAnalysis)
+	{
+		const double derivative = GetScaleDerivative(m_scenario.GetDistribution(travelDistribution), travelTime);
+		m_perturbation.AddDelay(truckIndex, GradientParameter::travel_time, derivative);
+	}
+	return travelTime;
+}
+
+uint64_t EventSimulation::GetSimulatedTime() const
+{
+	return m_now;
+}
+
+uint64_t EventSimulation::GetStatisticsStartTime() const
+{
+	return m_statisticsStart;
+}
+
+uint64_t EventSimulation::GetProcessedEventCount() const
+{
+	return m_processedEvents;
+}
+
+uint64_t EventSimulation::GetSteadyStateAllocationCount() const
+{
+	return m_steadyStateAllocations;
+}
+
+uint64_t EventSimulation::GetQueueWaitPercentile(double percentile) const
+{
+	uint64_t count = 0;
+	for (uint32_t i = 0; i < kQueueWaitBucketCount; ++i)
+	{
+		count += m_queueWaitHistogram[i];
+	}
+	const uint64_t rank = (uint64_t)std::ceil(count * percentile / 100);
+	uint64_t cumulative = 0;
+	for (uint32_t i = 0; i < kQueueWaitBucketCount; ++i)
+	{
+		cumulative += m_queueWaitHistogram[i];
+		if (cumulative >= rank && cumulative > 0)
+		{
+			return i * kQueueWaitBucketWidth;
+		}
+	}
+	return 0;
+}
+
+uint32_t EventSimulation::GetTruckCount() const
+{
+	return m_trucksCount;
+}
+
+const TruckRecord& EventSimulation::GetTruck(uint32_t truckIndex) const
+{
+	return *m_trucks[truckIndex];
+}
+
+const ScenarioTruckClass& EventSimulation::GetTruckClass(uint32_t truckIndex) const
+{
+	return m_truckClasses[m_trucks[truckIndex]->truckClass];
+}
+
+uint64_t EventSimulation::GetHandOffCount() const
+{
+	return m_handOffCount;
+}
+
+bool EventSimulation::HoldsTruck(uint32_t truckIndex) const
+{
+	return m_trucks[truckIndex] != NULL;
+}
+
+const uint64_t* EventSimulation::GetQueueWaitHistogram() const
+{
+	return m_queueWaitHistogram;
+}
+
+void EventSimulation::HandOffTruck(uint32_t truckIndex, uint64_t arrivalTime)
+{
+	TruckRecord* truck = m_trucks[truckIndex];
+	const uint32_t shard = m_config.shardExchange->GetStationShard(truck->stationIndex);
+	// An aborted run is discarded, so a truck lost on abort does not matter.
+	m_config.shardExchange->Send(m_config.shardIndex, shard, TruckHandOff{ *truck, arrivalTime, truckIndex });
+	m_truckStateCounts[truck->state]--;
+	m_truckPool.Release(truck);
+	m_trucks[truckIndex] = NULL;
+	m_handOffCount++;
+}
+
+void EventSimulation::ReceiveTrucks(const std::vector<TruckHandOff>& handOffs)
+{
+	for (const TruckHandOff& handOff : handOffs)
+	{
+		TruckRecord* truck = m_truckPool.Acquire();
+		*truck = handOff.truck;
+		m_trucks[handOff.truckIndex] = truck;
+		m_truckStateCounts[truck->state]++;
+		m_stations[truck->stationIndex].enRoute++;
+		Schedule(handOff.arrivalTime, handOff.truckIndex, EventType::arrive_unloading_station);
+	}
+}
+
+void EventSimulation::PublishStationStates(ShardStationState* states) const
+{
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		if (m_config.shardExchange->GetStationShard(i) == m_config.shardIndex)
+		{
+			const StationRecord& station = m_stations[i];
+			states[i] = ShardStationState{ station.busyUntil, station.queueLength, station.enRoute, station.busy, 0 };
+		}
+	}
+}
+
+void EventSimulation::LoadStationStates(const ShardStationState* states)
+{
+	for (uint32_t i = 0; i < m_stationsCount; ++i)
+	{
+		if (m_config.shardExchange->GetStationShard(i) != m_config.shardIndex)
+		{
+			StationRecord& station = m_stations[i];
+			station.busyUntil = states[i].busyUntil;
+			station.queueLength = states[i].queueLength;
+			station.enRoute = states[i].enRoute;
+			station.busy = states[i].busy != 0;
+		}
+	}
+}
+
+uint32_t EventSimulation::GetStationCount() const
+{
+	return m_stationsCount;
+}
+
+const StationRecord& EventSimulation::GetStation(uint32_t stationIndex) const
+{
+	return m_stations[stationIndex];
+}
+
+const PerturbationAnalysis& EventSimulation::GetPerturbationAnalysis() const
+{
+	return m_perturbation;
+}
+
+const Arena& EventSimulation::GetArena() const
+{
+	return m_arena;
+}
@@ -0,0 +1,606 @@
+/**
+ * @file  EventSimulation.h
+ *
+ * This file contains EventSimulation class. It runs the same truck
+ * cycle as the State classes in simulated time on a single thread,
+ * driven by a pending event set instead of sleeping threads.
+ * Events and per-truck records come from ObjectPool instances backed
+ * by one simulation lifetime Arena.
+ */
+
+#ifndef EVENTSIMULATION_H_
+#define EVENTSIMULATION_H_
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "ObjectPool.h"
+#include "MiningTruck.h"
+#include "Scenario.h"
+#include "SteadyStateDetector.h"
+#include "PerturbationAnalysis.h"
+#include "RoadNetwork.h"
+#include "TimeSeriesRecorder.h"
+
+class ShardExchange;
+struct TruckHandOff;
+struct ShardStationState;
+
+/**
+ * Configuration of an event driven run
+ */
+struct EventSimulationConfig
+{
+	// Trucks, stations, timing distributions and simulated time of the run.
+	// It must outlive the simulation.
+	const Scenario* scenario = NULL;
+	// Seed of the random number generator
+	uint64_t seed = 1;
+	// Publish live counters to SimMetrics. Only one run at a time should publish.
+	bool publishMetrics = false;
+	// Draw every time from a counter based stream keyed by seed, truck,
+	// kind of draw and draw number, so draw i of truck k is the same in
+	// every compared scenario which uses the same seed.
+	bool commonRandomNumbers = false;
+	// Mirror every common random number draw inside its range. A run and
+	// its antithetic twin form a negatively correlated pair.
+	bool antithetic = false;
+	// Estimate throughput and queue wait derivatives alongside the run
+	bool perturbationAnalysis = false;
+	// Road network of the pits and dumps. Travel times come from its
+	// matrix and every truck picks its station when it leaves the pit.
+	// NULL keeps the single site with the travel distributions of the scenario.
+	const RoadNetwork* roadNetwork = NULL;
+	// Shared memory of a sharded run. The run holds only the trucks of its
+	// shard, serves only the stations of its shard and hands trucks bound
+	// for other stations off to their shards. NULL runs the whole scenario.
+	ShardExchange* shardExchange = NULL;
+	// Index of the shard of the run
+	uint32_t shardIndex = 0;
+};
+
+/**
+ * Kind of time drawn for a truck. Each kind has its own common random
+ * number stream.
+ */
+enum class RandomStream : uint32_t
+{
+	travel = 1,
+	loading = 2,
+	unloading = 3
+};
+
+/**
+ * Type of the events in the pending event set
+ */
+enum class EventType : uint8_t
+{
+	arrive_mine_site = 0,
+	loading_done = 1,
+	arrive_unloading_station = 2,
+	unloading_done = 3
+};
+
+/**
+ * Event of the pending event set. Each truck has at most one pending event.
+ */
+struct SimulationEvent
+{
+	// Simulated time of the event in milliseconds
+	uint64_t time;
+	// Scheduling order. It breaks ties between events of the same time.
+	uint64_t sequence;
+	// Index of the truck the event belongs to
+	uint32_t truckIndex;
+	// Type of the event
+	EventType type;
+};
+
+/**
+ * Per-truck record of the event driven run
+ */
+struct TruckRecord
+{
+	// Truck Id
+	uint32_t truckId;
+	// Truck current state
+	TruckState state;
+	// Index of the truck class of the scenario
+	uint32_t truckClass;
+	// Station of the current unloading cycle
+	uint32_t stationIndex;
+	// Next truck in the station queue. kNoTruck if it is the last one.
+	uint32_t nextInQueue;
+	// Number of times truck travels between site and unloading station
+	uint32_t travelCount;
+	// Number of times truck is loaded
+	uint32_t loadCount;
+	// Number of times truck unloads the mine
+	uint32_t unloadCount;
+	// Total loading time in milliseconds
+	uint64_t totalLoadingTime;
+	// Total time spent in station queues in milliseconds
+	uint64_t totalQueueWaitTime;
+	// Time the truck entered the current station queue
+	uint64_t queueEnterTime;
+	// Road network node of the pit the truck loads at
+	uint32_t siteNode;
+};
+
+/**
+ * Per-station record of the event driven run.
+ * The queue is an intrusive list through TruckRecord::nextInQueue.
+ */
+struct StationRecord
+{
+	// Station Id
+	uint32_t stationId;
+	// Index of the unloading time distribution of the scenario
+	uint32_t unloadingDistribution;
+	// Mean unloading time in milliseconds. It is used to estimate the waiting time.
+	uint64_t meanUnloadingTime;
+	// First truck in the queue. kNoTruck if queue is empty.
+	uint32_t queueHead;
+	// Last truck in the queue. kNoTruck if queue is empty.
+	uint32_t queueTail;
+	// Number of trucks in the queue
+	uint32_t queueLength;
+	// True if a truck is being unloaded
+	bool busy;
+	// Time the current unloading completes
+	uint64_t busyUntil;
+	// Number of unloadings done by the station
+	uint64_t unloadCount;
+	// Tonnes unloaded by the station
+	uint64_t unloadedTonnes;
+	// Trucks the station holds in its queue and unloading bay. 0 is unbounded.
+	uint32_t capacity;
+	// Total time spent unloading in milliseconds
+	uint64_t busyTime;
+	// Road network node of the dump the station stands at
+	uint32_t siteNode;
+	// Number of trucks travelling to the station
+	uint32_t enRoute;
+};
+
+// TruckObservation::elapsed of a truck seen at an unknown point of its activity
+static const uint64_t kUnknownElapsed = UINT64_MAX;
+
+/**
+ * Observed state of a truck, e.g. from telemetry, to start a run from
+ */
+struct TruckObservation
+{
+	// Truck state
+	TruckState state;
+	// Time the truck has spent in the state, in milliseconds. kUnknownElapsed if it is not known.
+	uint64_t elapsed;
+	// Zero based index of the station the truck unloads or waits at. Ignored in other states.
+	uint32_t stationIndex;
+};
+
+/**
+ * EventSimulation class
+ */
+class EventSimulation
+{
+public:
+	// Index used for "no truck" in the station queues
+	static const uint32_t kNoTruck = UINT32_MAX;
+	// Width of a queue wait histogram bucket in milliseconds
+	static const uint64_t kQueueWaitBucketWidth = 10000;
+	// Number of queue wait histogram buckets. Bucket 0 counts unloadings
+	// without wait, bucket i waits in ((i - 1) * width, i * width] and the
+	// last one every longer wait.
+	static const uint32_t kQueueWaitBucketCount = 8642;
+	/**
+	 * Constructor. Does the whole setup in one bulk arena allocation.
+	 *
+	 * @param[in] config   Configuration of the run
+	 */
+	EventSimulation(const EventSimulationConfig& config);
+	/**
+	 * Run the event loop until the simulated time is reached.
+	 */
+	void Run();
+	/**
+	 * Run the event loop until the given simulated time. Events at
+	 * exactly that time are processed. Consecutive calls give the same
+	 * results as a single Run.
+	 *
+	 * @param[in] time   Simulated time in milliseconds. It is capped at
+	 *                   the simulated time of the scenario.
+	 */
+	void RunUntil(uint64_t time);
+	/**
+	 * Run in batches of the detector and feed it the station throughput
+	 * of every batch in unloadings per hour. Stops as soon as the
+	 * detector accepts the steady-state estimate, or at the simulated
+	 * time of the scenario. The warm-up batches the detector finds are
+	 * then taken out of the truck, station and queue wait statistics.
+	 * The statistics are copied only at the batches the warm-up may
+	 * still end at, at most 32 copies, so long runs restrict the end of
+	 * the warm-up to a coarser step of batches.
+	 *
+	 * @param[in,out] detector  Warm-up and convergence detector. It must not hold batches yet.
+	 *
+	 * @return        bool      True if the run stopped early.
+	 */
+	bool RunUntilSteadyState(SteadyStateDetector& detector);
+	/**
+	 * Write the whole simulation state to a compact binary snapshot:
+	 * every truck and station record (station queues included), the
+	 * pending event set in heap order, the queue wait histogram and the
+	 * random number generator state. The perturbation analysis
+	 * estimates are not part of the snapshot.
+	 *
+	 * @param[in] path   Output file path. It is replaced atomically.
+	 *
+	 * @return    bool   True if the snapshot is written.
+	 */
+	bool SaveCheckpoint(const std::string& path) const;
+	/**
+	 * Replace the simulation state with a snapshot written by
+	 * SaveCheckpoint. The simulation must be built from the same
+	 * scenario. Running on gives identical results to the run which
+	 * took the snapshot. A truncated or corrupt snapshot leaves the
+	 * simulation unchanged.
+	 *
+	 * @param[in]  path    Snapshot file path
+	 * @param[out] error   Description of the problem if restoring fails
+	 *
+	 * @return     bool    True if the state is restored.
+	 */
+	bool RestoreCheckpoint(const std::string& path, std::string& error);
+	/**
+	 * Open new unloading stations at the current simulated time. They
+	 * use the unloading time distribution of the first station.
+	 *
+	 * @param[in] count   Number of stations to add
+	 */
+	void AddStations(uint32_t count);
+	/**
+	 * Put new trucks into service at the current simulated time. They
+	 * use the distributions of the first truck and start empty,
+	 * travelling to the mine site.
+	 *
+	 * @param[in] count   Number of trucks to add
+	 */
+	void AddTrucks(uint32_t count);
+	/**
+	 * Replace the initial state of the run with observed truck states.
+	 * It must be called before the run starts. Every truck finishes its
+	 * current activity after a fresh draw of its duration less the time
+	 * already spent, or at once if that time is exceeded. A truck with
+	 * kUnknownElapsed finishes at a uniformly drawn point of the drawn
+	 * duration. The trucks waiting at a station are queued longest
+	 * waiting first.
+	 *
+	 * @param[in] observations   Observation of every truck, by truck index
+	 */
+	void ApplyObservations(const std::vector<TruckObservation>& observations);
+	/**
+	 * Get the current simulated time
+	 *
+	 * @return   Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t GetSimulatedTime() const;
+	/**
+	 * Get the simulated time the truck, station and queue wait
+	 * statistics start at. It is the end of the warm-up discarded by
+	 * RunUntilSteadyState, otherwise 0.
+	 *
+	 * @return   Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t GetStatisticsStartTime() const;
+	/**
+	 * Get the number of events processed by Run
+	 *
+	 * @return   Unsigned Integer  Number of events
+	 */
+	uint64_t GetProcessedEventCount() const;
+	/**
+	 * Get the number of heap allocations done inside the event loop
+	 *
+	 * @return   Unsigned Integer  Number of allocations. It is 0 when
+	 *                             the pools are sized correctly, and
+	 *                             always 0 unless built with COUNT_ALLOCATIONS.
+	 */
+	uint64_t GetSteadyStateAllocationCount() const;
+	/**
+	 * Get a percentile of the station queue waiting time of all the
+	 * unloadings started so far, at the resolution of the histogram
+	 *
+	 * @param[in] percentile   Percentile in (0, 100]
+	 *
+	 * @return    Unsigned Integer  Upper bound of the waiting time in milliseconds
+	 */
+	uint64_t GetQueueWaitPercentile(double percentile) const;
+	/**
+	 * Get the perturbation analysis of the run. It has estimates only
+	 * if EventSimulationConfig::perturbationAnalysis is set.
+	 *
+	 * @return    Perturbation analysis
+	 */
+	const PerturbationAnalysis& GetPerturbationAnalysis() const;
+	/**
+	 * Sample the station queue depths and the truck state counts into
+	 * a recorder whenever the simulated time passes its next sample time.
+	 * A sample at time t holds the state after every event up to t.
+	 *
+	 * @param[in] recorder   Recorder of the run, or NULL to stop sampling.
+	 *                       It must outlive the runs it samples.
+	 */
+	void SetTimeSeriesRecorder(TimeSeriesRecorder* recorder);
+	/**
+	 * Get the number of trucks
+	 *
+	 * @return   Unsigned Integer  Number of trucks
+	 */
+	uint32_t GetTruckCount() const;
+	/**
+	 * Get the record of a truck
+	 *
+	 * @param[in] truckIndex  Zero based index of the truck
+	 *
+	 * @return    Truck record
+	 */
+	const TruckRecord& GetTruck(uint32_t truckIndex) const;
+	/**
+	 * Get the scenario class record of a truck
+	 *
+	 * @param[in] truckIndex  Zero based index of the truck
+	 *
+	 * @return    Class record with the service times and payload of the truck
+	 */
+	const ScenarioTruckClass& GetTruckClass(uint32_t truckIndex) const;
+	/**
+	 * Check that the run holds a truck. Only a sharded run holds a part of the fleet.
+	 *
+	 * @param[in] truckIndex  Zero based index of the truck
+	 *
+	 * @return    bool        True if the truck record is in this run.
+	 */
+	bool HoldsTruck(uint32_t truckIndex) const;
+	/**
+	 * Get the number of trucks handed off to other shards
+	 *
+	 * @return   Unsigned Integer  Number of hand-offs
+	 */
+	uint64_t GetHandOffCount() const;
+	/**
+	 * Get the queue wait histogram of the unloadings
+	 *
+	 * @return    kQueueWaitBucketCount buckets
+	 */
+	const uint64_t* GetQueueWaitHistogram() const;
+	/**
+	 * Schedule the arrival of trucks handed off by other shards
+	 *
+	 * @param[in] handOffs   Trucks sent to the shard of the run
+	 */
+	void ReceiveTrucks(const std::vector<TruckHandOff>& handOffs);
+	/**
+	 * Write the state of the stations of the shard of the run
+	 *
+	 * @param[out] states   State of every station of the scenario
+	 */
+	void PublishStationStates(ShardStationState* states) const;
+	/**
+	 * Take the state of the stations of the other shards, which the
+	 * trucks of this shard use to pick a station
+	 *
+	 * @param[in] states   State of every station of the scenario
+	 */
+	void LoadStationStates(const ShardStationState* states);
+	/**
+	 * Get the number of stations
+	 *
+	 * @return   Unsigned Integer  Number of stations
+	 */
+	uint32_t GetStationCount() const;
+	/**
+	 * Get the record of a station
+	 *
+	 * @param[in] stationIndex  Zero based index of the station
+	 *
+	 * @return    Station record
+	 */
+	const StationRecord& GetStation(uint32_t stationIndex) const;
+	/**
+	 * Get the arena of the run
+	 *
+	 * @return    Arena which holds all the records
+	 */
+	const Arena& GetArena() const;
+
+private:
+	/**
+	 * Get the time left of an observed activity
+	 *
+	 * @param[in] duration   Drawn duration of the activity in milliseconds
+	 * @param[in] elapsed    Time already spent in it, or kUnknownElapsed
+	 *
+	 * @return    Unsigned Integer  Remaining time in milliseconds
+	 */
+	uint64_t GetRemainingTime(uint64_t duration, uint64_t elapsed);
+	/**
+	 * Append the statistics counters of every truck and station and the
+	 * queue wait histogram to a buffer
+	 *
+	 * @param[in,out] statistics   Buffer the counters are appended to
+	 */
+	void AppendStatistics(std::vector<uint64_t>& statistics) const;
+	/**
+	 * Subtract counters appended by AppendStatistics, so the statistics
+	 * cover only the time since they were copied
+	 *
+	 * @param[in] statistics   First of the copied counters
+	 */
+	void SubtractStatistics(const uint64_t* statistics);
+	/**
+	 * Check that every index of the records read from a checkpoint is in range
+	 *
+	 * @param[in] trucks     Truck records of the checkpoint
+	 * @param[in] stations   Station records of the checkpoint
+	 * @param[in] events     Pending events of the checkpoint
+	 *
+	 * @return    bool       True if the records can be restored.
+	 */
+	bool IsValidCheckpoint(const std::vector<TruckRecord>& trucks, const std::vector<StationRecord>& stations,
+	                       const std::vector<SimulationEvent>& events) const;
+	/**
+	 * Hand a truck travelling to a station of another shard off to that shard
+	 *
+	 * @param[in] truckIndex    Index of the truck
+	 * @param[in] arrivalTime   Time the truck arrives at the station
+	 */
+	void HandOffTruck(uint32_t truckIndex, uint64_t arrivalTime);
+	/**
+	 * Add an event to the pending event set
+	 *
+	 * @param[in] time        Simulated time of the event
+	 * @param[in] truckIndex  Index of the truck
+	 * @param[in] type        Type of the event
+	 */
+	void Schedule(uint64_t time, uint32_t truckIndex, EventType type);
+	/**
+	 * Handle one event and schedule the next event of its truck
+	 *
+	 * @param[in] event   Event to handle
+	 */
+	void HandleEvent(const SimulationEvent& event);
+	/**
+	 * Select the station with the shortest waiting time
+	 *
+	 * @return    Unsigned Integer  Station index
+	 */
+	uint32_t SelectStation() const;
+	/**
+	 * Select the station for a truck leaving its pit on the road network.
+	 * It minimizes the time until the truck is back at the pit: travel to
+	 * the dump, expected wait on arrival, unloading and travel back. The
+	 * expected wait counts the queue, the current truck and the trucks
+	 * already travelling to the station.
+	 *
+	 * @param[in] truck   Truck leaving its pit
+	 *
+	 * @return    Unsigned Integer  Index of the selected station
+	 */
+	uint32_t SelectRoutedStation(const TruckRecord& truck) const;
+	/**
+	 * Start unloading the truck at the station
+	 *
+	 * @param[in] stationIndex  Index of the station
+	 * @param[in] truckIndex    Index of the truck
+	 */
+	void StartUnloading(uint32_t stationIndex, uint32_t truckIndex);
+	/**
+	 * Add a queue waiting time to the histogram
+	 *
+	 * @param[in] waitTime   Waiting time in milliseconds
+	 */
+	void RecordQueueWait(uint64_t waitTime);
+	/**
+	 * Publish the simulated time and the events processed since the
+	 * last call to SimMetrics
+	 */
+	void PublishProgress();
+	/**
+	 * Add the time series samples due before the given time
+	 *
+	 * @param[in] time   Samples up to but not including this time are added
+	 */
+	void RecordSamples(uint64_t time);
+	/**
+	 * Change the state of the truck and publish it to SimMetrics if enabled
+	 *
+	 * @param[in] truck   Truck record
+	 * @param[in] state   New state of the truck
+	 */
+	void SetTruckState(TruckRecord& truck, TruckState state);
+	/**
+	 * Draw a time from a distribution of the scenario
+	 *
+	 * @param[in] distribution  Index of the distribution
+	 * @param[in] truck         Truck the time is drawn for
+	 * @param[in] stream        Kind of the draw
+	 * @param[in] drawIndex     Number of draws of this kind the truck did
+	 *                          before. Used with common random numbers.
+	 *
+	 * @return    Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t DrawTime(uint32_t distribution, const TruckRecord& truck, RandomStream stream, uint32_t drawIndex);
+	/**
+	 * Draw a travel time and pass its derivative to the perturbation
+	 * analysis. On a road network, the time is the shortest path between
+	 * the pit of the truck and the dump of its station, which has no
+	 * derivative with respect to the travel time distribution.
+	 *
+	 * @param[in] truckIndex   Index of the truck
+	 *
+	 * @return    Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t DrawTravelTime(uint32_t truckIndex);
+
+	// Configuration of the run
+	EventSimulationConfig m_config;
+	// Scenario of the run
+	const Scenario& m_scenario;
+	// Number of trucks
+	uint32_t m_trucksCount;
+	// Number of stations
+	uint32_t m_stationsCount;
+	// Simulation lifetime arena. It is declared first, so it outlives the pools.
+	Arena m_arena;
+	// Pool of pending events
+	ObjectPool<SimulationEvent> m_eventPool;
+	// Pool of per-truck records
+	ObjectPool<TruckRecord> m_truckPool;
+	// Truck records by index
+	TruckRecord** m_trucks;
+	// Truck class records of the scenario by index
+	const ScenarioTruckClass* m_truckClasses;
+	// Number of truck class records
+	uint32_t m_truckClassCount;
+	// Station records by index
+	StationRecord* m_stations;
+	// Binary min heap of pending events. Its capacity is the number of trucks.
+	SimulationEvent** m_pendingEvents;
+	// Number of pending events
+	uint32_t m_pendingCount;
+	// Current simulated time in milliseconds
+	uint64_t m_now;
+	// Simulated time the statistics start at in milliseconds
+	uint64_t m_statisticsStart;
+	// Next event sequence number
+	uint64_t m_sequence;
+	// Number of processed events
+	uint64_t m_processedEvents;
+	// Number of processed events already published to SimMetrics
+	uint64_t m_publishedEvents;
+	// Heap allocations done inside the event loop
+	uint64_t m_steadyStateAllocations;
+	// Number of trucks handed off to other shards
+	uint64_t m_handOffCount;
+	// Histogram of the station queue waiting times of the unloadings
+	uint64_t* m_queueWaitHistogram;
+	// Number of trucks in every state
+	int64_t m_truckStateCounts[kTruckStateCount];
+	// Time series recorder. NULL if the run is not sampled.
+	TimeSeriesRecorder* m_timeSeries;
+	// Time of the next time series sample. UINT64_MAX if the run is not sampled.
+	uint64_t m_nextSampleTime;
+	// Queue depth of every station of the sample being added
+	int64_t* m_sampleQueueDepths;
+	// Number of stations sampled into m_sampleQueueDepths
+	uint32_t m_sampleStationCount;
+	// Derivative estimation, updated only if perturbation analysis is enabled
+	PerturbationAnalysis m_perturbation;
+	// Random number generator for all the timing draws
+	std::mt19937_64 m_random;
+};
+
+#endif /* EVENTSIMULATION_H_ */
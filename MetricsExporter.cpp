@@ -0,0 +1,147 @@
+/**
+ * @file  MetricsExporter.cpp
+ *
+ * MetricsExporter class methods implementation
+ */
+
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "MetricsExporter.h"
+#include "SimMetrics.h"
+
+// Poll interval used to observe the stop token, in milliseconds
+static const int kPollIntervalMilliSeconds = 100;
+
+MetricsExporter::MetricsExporter(std::stop_token stopToken)
+{
+	m_socket = -1;
+	m_stopToken = stopToken;
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	if (m_socket >= 0)
+	{
+		close(m_socket);
+	}
+	if (!m_unixPath.empty())
+	{
+		unlink(m_unixPath.c_str());
+	}
+}
+
+bool MetricsExporter::ListenTcp(uint16_t port)
+{
+	m_socket = socket(AF_INET, SOCK_STREAM, 0);
+	if (m_socket < 0)
+	{
+		return false;
+	}
+	int reuse = 1;
+	setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	// Only local clients can scrape.
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(m_socket, (sockaddr*)&address, sizeof(address)) != 0 || listen(m_socket, 16) != 0)
+	{
+		close(m_socket);
+		m_socket = -1;
+		return false;
+	}
+	return true;
+}
+
+bool MetricsExporter::ListenUnix(const std::string& path)
+{
+	sockaddr_un address;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		return false;
+	}
+	// Only a stale socket is replaced. Any other file at the path is left alone.
+	struct stat status;
+	if (lstat(path.c_str(), &status) == 0)
+	{
+		if (!S_ISSOCK(status.st_mode))
+		{
+			return false;
+		}
+		unlink(path.c_str());
+	}
+	m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_socket < 0)
+	{
+		return false;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	if (bind(m_socket, (sockaddr*)&address, sizeof(address)) != 0 || listen(m_socket, 16) != 0)
+	{
+		close(m_socket);
+		m_socket = -1;
+		return false;
+	}
+	m_unixPath = path;
+	return true;
+}
+
+void MetricsExporter::run()
+{
+	while (!m_stopToken.stop_requested())
+	{
+		pollfd listener = { m_socket, POLLIN, 0 };
+		if (poll(&listener, 1, kPollIntervalMilliSeconds) <= 0)
+		{
+			continue;
+		}
+		int client = accept(m_socket, NULL, NULL);
+		if (client >= 0)
+		{
+			Serve(client);
+			close(client);
+		}
+	}
+}
+
+void MetricsExporter::Serve(int client)
+{
+	// Any path is answered with the metrics. Only wait briefly for the request line.
+	pollfd request = { client, POLLIN, 0 };
+	if (poll(&request, 1, kPollIntervalMilliSeconds) > 0)
+	{
+		char buffer[1024];
+		if (read(client, buffer, sizeof(buffer)) < 0)
+		{
+			return;
+		}
+	}
+
+	std::string body;
+	SimMetrics::GetInstance()->WritePrometheus(body);
+	std::string response = "HTTP/1.0 200 OK\r\n"
+	                       "Content-Type: text/plain; version=0.0.4\r\n"
+	                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+	                       "Connection: close\r\n\r\n" + body;
+
+	size_t written = 0;
+	while (written < response.size())
+	{
+		ssize_t count = send(client, response.data() + written, response.size() - written, MSG_NOSIGNAL);
+		if (count <= 0)
+		{
+			return;
+		}
+		written += count;
+	}
+}
@@ -0,0 +1,75 @@
+/**
+ * @file  MetricsExporter.h
+ *
+ * This file contains MetricsExporter class. It serves the SimMetrics
+ * counters in Prometheus text format over HTTP on a local TCP port
+ * or a Unix domain socket, e.g.
+ *   curl http://127.0.0.1:9100/metrics
+ *   curl --unix-socket /tmp/sim.sock http://localhost/metrics
+ */
+
+#ifndef METRICSEXPORTER_H_
+#define METRICSEXPORTER_H_
+
+#include <cstdint>
+#include <string>
+#include <stop_token>
+
+/**
+ * MetricsExporter class
+ */
+class MetricsExporter
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] stopToken  Stop token of the simulation. run returns
+	 *                       once stop is requested.
+	 */
+	MetricsExporter(std::stop_token stopToken);
+	/**
+	 * Destructor. Closes the socket and removes the Unix socket file.
+	 */
+	~MetricsExporter();
+	MetricsExporter(const MetricsExporter&) = delete;
+	MetricsExporter& operator=(const MetricsExporter&) = delete;
+	/**
+	 * Listen on a TCP port of the loopback interface
+	 *
+	 * @param[in] port   TCP port
+	 *
+	 * @return    bool   True if the socket is listening, otherwise False.
+	 */
+	bool ListenTcp(uint16_t port);
+	/**
+	 * Listen on a Unix domain socket
+	 *
+	 * @param[in] path   Path of the socket file. An existing socket is replaced.
+	 *                   Any other existing file makes the call fail.
+	 *
+	 * @return    bool   True if the socket is listening, otherwise False.
+	 */
+	bool ListenUnix(const std::string& path);
+	/**
+	 * Runnable method to start by thread to serve the scrape requests
+	 */
+	void run();
+
+private:
+	/**
+	 * Read the request and write the metrics response
+	 *
+	 * @param[in] client  Connected client socket
+	 */
+	void Serve(int client);
+
+	// Listening socket. -1 if not listening.
+	int m_socket;
+	// Path of the Unix socket file. Empty for TCP.
+	std::string m_unixPath;
+	// Stop token of the simulation
+	std::stop_token m_stopToken;
+};
+
+#endif /* METRICSEXPORTER_H_ */
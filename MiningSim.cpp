@@ -0,0 +1,353 @@
+/**
+ * @file  MiningSim.cpp
+ *
+ * C ABI implementation. No exception leaves a function of the C ABI.
+ */
+
+#include <cstring>
+#include <exception>
+#include <map>
+#include <string>
+#include <vector>
+#include "MiningSim.h"
+#include "Constants.h"
+#include "SimLibrary.h"
+
+// Smallest result a caller may give: the size and status fields
+static const uint32_t kMinResultSize = offsetof(mining_sim_result, simulated_time);
+
+/**
+ * Scenario behind a handle of the C ABI
+ */
+struct mining_sim_scenario
+{
+	Scenario scenario;
+};
+
+// Description of the latest error of the thread
+static thread_local std::string lastError;
+
+/**
+ * Record the description of an error
+ *
+ * @param[in] status   Status of the error
+ * @param[in] error    Description of the error
+ *
+ * @return    Integer  Status
+ */
+static int SetError(int status, const std::string& error)
+{
+	lastError = error;
+	return status;
+}
+
+/**
+ * Check that a result structure may be written
+ *
+ * @param[in] result   Result given by the caller
+ *
+ * @return    bool     True if it is not NULL and holds at least the status.
+ */
+static bool IsValidResult(const mining_sim_result* result)
+{
+	return result && result->size >= kMinResultSize;
+}
+
+/**
+ * Get a result of a batch. The caller's array holds structures of its own
+ * size, which is the size of the first one.
+ *
+ * @param[in] results   Results of the batch
+ * @param[in] index     Index of the run
+ *
+ * @return    Result of the run
+ */
+static mining_sim_result* GetBatchResult(mining_sim_result* results, uint32_t index)
+{
+	return reinterpret_cast<mining_sim_result*>(reinterpret_cast<char*>(results) + (size_t)index * results->size);
+}
+
+/**
+ * Copy the part of the results the caller knows about
+ *
+ * @param[in]  runResult   Results of the run
+ * @param[in]  status      Status of the run
+ * @param[out] result      Result of the caller. Its size is kept.
+ */
+static void StoreResult(const SimRunResult& runResult, int status, mining_sim_result* result)
+{
+	mining_sim_result full;
+	memset(&full, 0, sizeof(full));
+	full.size = result->size;
+	full.status = status;
+	full.simulated_time = runResult.simulatedTime;
+	full.processed_events = runResult.processedEvents;
+	full.load_count = runResult.loadCount;
+	full.unload_count = runResult.unloadCount;
+	full.unloads_per_hour = runResult.unloadsPerHour;
+	full.mean_queue_wait = runResult.meanQueueWait;
+	full.p95_queue_wait = runResult.p95QueueWait;
+	full.station_utilization = runResult.stationUtilization;
+	full.unloaded_tonnes = runResult.unloadedTonnes;
+	full.tonnes_per_hour = runResult.tonnesPerHour;
+	memcpy(result, &full, result->size < sizeof(full) ? result->size : sizeof(full));
+}
+
+/**
+ * Build a scenario from records and give its handle
+ *
+ * @param[in]  simulationTime     Simulated time to run in milliseconds
+ * @param[in]  seed               Default seed of the scenario
+ * @param[in]  distributions      Timing distributions of the caller
+ * @param[in]  distributionCount  Number of distributions
+ * @param[in]  stations           Station records
+ * @param[in]  trucks             Truck records
+ * @param[in]  truckClasses       Truck class records
+ * @param[out] scenario           New scenario handle
+ *
+ * @return     Integer  Status
+ */
+static int CreateScenario(uint64_t simulationTime, uint64_t seed, const mining_sim_distribution* distributions,
+                          uint32_t distributionCount, const std::vector<ScenarioStation>& stations,
+                          const std::vector<ScenarioTruck>& trucks, const std::vector<ScenarioTruckClass>& truckClasses,
+                          mining_sim_scenario** scenario)
+{
+	std::vector<ScenarioDistribution> distributionRecords(distributionCount);
+	for (uint32_t i = 0; i < distributionCount; ++i)
+	{
+		distributionRecords[i] = ScenarioDistribution{ distributions[i].minimum, distributions[i].maximum };
+	}
+	mining_sim_scenario* created = new mining_sim_scenario;
+	std::string error;
+	if (!created->scenario.Create(simulationTime, seed, distributionRecords, stations, trucks, truckClasses, error))
+	{
+		delete created;
+		return SetError(MINING_SIM_INVALID_SCENARIO, error);
+	}
+	*scenario = created;
+	return MINING_SIM_OK;
+}
+
+extern "C" {
+
+uint32_t mining_sim_api_version(void)
+{
+	return MINING_SIM_API_VERSION;
+}
+
+const char* mining_sim_last_error(void)
+{
+	return lastError.c_str();
+}
+
+int mining_sim_scenario_create(uint64_t simulation_time, uint64_t seed,
+                               const mining_sim_distribution* distributions, uint32_t distribution_count,
+                               const uint32_t* station_distributions, uint32_t station_count,
+                               const mining_sim_truck* trucks, uint32_t truck_count,
+                               mining_sim_scenario** scenario)
+{
+	if (!scenario || (distribution_count && !distributions) || (station_count && !station_distributions) ||
+	    (truck_count && !trucks))
+	{
+		return SetError(MINING_SIM_INVALID_ARGUMENT, "NULL array or handle");
+	}
+	*scenario = NULL;
+	try
+	{
+		std::vector<ScenarioStation> stationRecords(station_count);
+		for (uint32_t i = 0; i < station_count; ++i)
+		{
+			stationRecords[i] = ScenarioStation{ i + 1, station_distributions[i], 0, 0 };
+		}
+		// Trucks sharing their distributions get one implicit class of the default payload, as in a text scenario.
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> truckClassIndex;
+		std::vector<ScenarioTruckClass> truckClassRecords;
+		std::vector<ScenarioTruck> truckRecords(truck_count);
+		for (uint32_t i = 0; i < truck_count; ++i)
+		{
+			auto inserted = truckClassIndex.emplace(std::make_pair(trucks[i].travel_distribution, trucks[i].loading_distribution),
+			                                        (uint32_t)truckClassRecords.size());
+			if (inserted.second)
+			{
+				truckClassRecords.push_back(ScenarioTruckClass{ kDefaultTruckPayload, trucks[i].travel_distribution,
+				                                                trucks[i].loading_distribution, 0 });
+			}
+			truckRecords[i] = ScenarioTruck{ i + 1, inserted.first->second };
+		}
+		return CreateScenario(simulation_time, seed, distributions, distribution_count, stationRecords, truckRecords,
+		                      truckClassRecords, scenario);
+	}
+	catch (const std::exception& exception)
+	{
+		return SetError(MINING_SIM_INTERNAL_ERROR, exception.what());
+	}
+	catch (...)
+	{
+		return SetError(MINING_SIM_INTERNAL_ERROR, "unknown exception");
+	}
+}
+
+int mining_sim_scenario_create_fleet(uint64_t simulation_time, uint64_t seed,
+                                     const mining_sim_distribution* distributions, uint32_t distribution_count,
+                                     const mining_sim_station* stations, uint32_t station_count,
+                                     const mining_sim_truck_class* truck_classes, uint32_t truck_class_count,
+                                     const uint32_t* truck_class_indexes, uint32_t truck_count,
+                                     mining_sim_scenario** scenario)
+{
+	if (!scenario || (distribution_count && !distributions) || (station_count && !stations) ||
+	    (truck_class_count && !truck_classes) || (truck_count && !truck_class_indexes))
+	{
+		return SetError(MINING_SIM_INVALID_ARGUMENT, "NULL array or handle");
+	}
+	*scenario = NULL;
+	try
+	{
+		std::vector<ScenarioStation> stationRecords(station_count);
+		for (uint32_t i = 0; i < station_count; ++i)
+		{
+			stationRecords[i] = ScenarioStation{ i + 1, stations[i].unloading_distribution, stations[i].capacity, 0 };
+		}
+		std::vector<ScenarioTruckClass> truckClassRecords(truck_class_count);
+		for (uint32_t i = 0; i < truck_class_count; ++i)
+		{
+			truckClassRecords[i] = ScenarioTruckClass{ truck_classes[i].payload, truck_classes[i].travel_distribution,
+			                                           truck_classes[i].loading_distribution, 0 };
+		}
+		std::vector<ScenarioTruck> truckRecords(truck_count);
+		for (uint32_t i = 0; i < truck_count; ++i)
+		{
+			const uint32_t truckClass = truck_class_indexes[i];
+			if (truckClass >= truck_class_count)
+			{
+				return SetError(MINING_SIM_INVALID_SCENARIO, "truck " + std::to_string(i + 1) + " refers to an unknown truck class");
+			}
+			truckRecords[i] = ScenarioTruck{ i + 1, truckClass };
+		}
+		return CreateScenario(simulation_time, seed, distributions, distribution_count, stationRecords, truckRecords,
+		                      truckClassRecords, scenario);
+	}
+	catch (const std::exception& exception)
+	{
+		return SetError(MINING_SIM_INTERNAL_ERROR, exception.what());
+	}
+	catch (...)
+	{
+		return SetError(MINING_SIM_INTERNAL_ERROR, "unknown exception");
+	}
+}
+
+int mining_sim_scenario_load(const char* path, mining_sim_scenario** scenario)
+{
+	if (!path || !scenario)
+	{
+		return SetError(MINING_SIM_INVALID_ARGUMENT, "NULL path or handle");
+	}
+	*scenario = NULL;
+	try
+	{
+		mining_sim_scenario* loaded = new mining_sim_scenario;
+		std::string error;
+		if (!loaded->scenario.Load(path, error))
+		{
+			delete loaded;
+			return SetError(MINING_SIM_INVALID_SCENARIO, error);
+		}
+		*scenario = loaded;
+		return MINING_SIM_OK;
+	}
+	catch (const std::exception& exception)
+	{
+		return SetError(MINING_SIM_INTERNAL_ERROR, exception.what());
+	}
+	catch (...)
+	{
+		return SetError(MINING_SIM_INTERNAL_ERROR, "unknown exception");
+	}
+}
+
+uint64_t mining_sim_scenario_seed(const mining_sim_scenario* scenario)
+{
+	return scenario ? scenario->scenario.GetSeed() : 0;
+}
+
+void mining_sim_scenario_destroy(mining_sim_scenario* scenario)
+{
+	delete scenario;
+}
+
+int mining_sim_run(const mining_sim_scenario* scenario, uint64_t seed, mining_sim_result* result)
+{
+	if (!scenario || !IsValidResult(result))
+	{
+		return SetError(MINING_SIM_INVALID_ARGUMENT, "NULL scenario or result smaller than its status");
+	}
+	try
+	{
+		StoreResult(RunScenario(scenario->scenario, seed), MINING_SIM_OK, result);
+		return MINING_SIM_OK;
+	}
+	catch (const std::exception& exception)
+	{
+		StoreResult(SimRunResult(), MINING_SIM_INTERNAL_ERROR, result);
+		return SetError(MINING_SIM_INTERNAL_ERROR, exception.what());
+	}
+	catch (...)
+	{
+		StoreResult(SimRunResult(), MINING_SIM_INTERNAL_ERROR, result);
+		return SetError(MINING_SIM_INTERNAL_ERROR, "unknown exception");
+	}
+}
+
+int mining_sim_run_batch(const mining_sim_scenario* const* scenarios, const uint64_t* seeds, uint32_t count,
+                         uint32_t thread_count, mining_sim_result* results)
+{
+	if (count && (!scenarios || !seeds || !results))
+	{
+		return SetError(MINING_SIM_INVALID_ARGUMENT, "NULL array");
+	}
+	if (count && !IsValidResult(results))
+	{
+		return SetError(MINING_SIM_INVALID_ARGUMENT, "result smaller than its status");
+	}
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (!scenarios[i] || GetBatchResult(results, i)->size != results->size)
+		{
+			return SetError(MINING_SIM_INVALID_ARGUMENT,
+			                "run " + std::to_string(i) + " has a NULL scenario or a result of another size");
+		}
+	}
+	try
+	{
+		std::vector<SimRunRequest> requests(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			requests[i] = SimRunRequest{ &scenarios[i]->scenario, seeds[i] };
+		}
+		std::vector<SimRunResult> runResults;
+		RunScenarios(requests, thread_count, runResults);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			StoreResult(runResults[i], MINING_SIM_OK, GetBatchResult(results, i));
+		}
+		return MINING_SIM_OK;
+	}
+	catch (const std::exception& exception)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			StoreResult(SimRunResult(), MINING_SIM_INTERNAL_ERROR, GetBatchResult(results, i));
+		}
+		return SetError(MINING_SIM_INTERNAL_ERROR, exception.what());
+	}
+	catch (...)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			StoreResult(SimRunResult(), MINING_SIM_INTERNAL_ERROR, GetBatchResult(results, i));
+		}
+		return SetError(MINING_SIM_INTERNAL_ERROR, "unknown exception");
+	}
+}
+
+}
@@ -0,0 +1,213 @@
+/**
+ * @file  MiningSim.h
+ *
+ * This file contains the C ABI of the simulation library. It only uses C
+ * types, so any language with a C foreign function interface can call
+ * it, and a newer library keeps the existing functions and structure
+ * layouts:
+ *  - new result fields are appended, and mining_sim_result::size tells
+ *    the library how much of the structure the caller knows about
+ *  - mining_sim_api_version() tells the caller what the library knows.
+ * Functions return MINING_SIM_OK or an error status. The description of
+ * the latest error of the calling thread is given by mining_sim_last_error().
+ */
+
+#ifndef MININGSIM_H_
+#define MININGSIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Version of the C ABI. 2 adds truck classes, station capacities and tonnage results. */
+#define MINING_SIM_API_VERSION 2
+
+/* Status of a call */
+#define MINING_SIM_OK 0
+#define MINING_SIM_INVALID_ARGUMENT 1
+#define MINING_SIM_INVALID_SCENARIO 2
+#define MINING_SIM_INTERNAL_ERROR 3
+
+/* Scenario handle. Created by mining_sim_scenario_create or mining_sim_scenario_load. */
+typedef struct mining_sim_scenario mining_sim_scenario;
+
+/* Uniform timing distribution in milliseconds. Constant when minimum and maximum are equal. */
+typedef struct mining_sim_distribution
+{
+	uint64_t minimum;
+	uint64_t maximum;
+} mining_sim_distribution;
+
+/* Truck of a scenario, given by the indexes of its distributions */
+typedef struct mining_sim_truck
+{
+	uint32_t travel_distribution;
+	uint32_t loading_distribution;
+} mining_sim_truck;
+
+/* Truck class of a mixed fleet, e.g. the 300 t haulers */
+typedef struct mining_sim_truck_class
+{
+	uint32_t payload;
+	uint32_t travel_distribution;
+	uint32_t loading_distribution;
+} mining_sim_truck_class;
+
+/* Station with its own unloading distribution and capacity in trucks. A capacity of 0 is unbounded. */
+typedef struct mining_sim_station
+{
+	uint32_t unloading_distribution;
+	uint32_t capacity;
+} mining_sim_station;
+
+/* Results of one run */
+typedef struct mining_sim_result
+{
+	/* Size of the structure known to the caller. Set it to sizeof(mining_sim_result). */
+	uint32_t size;
+	/* Status of the run */
+	int32_t status;
+	/* Simulated time in milliseconds */
+	uint64_t simulated_time;
+	/* Number of events processed */
+	uint64_t processed_events;
+	/* Number of loads of all trucks */
+	uint64_t load_count;
+	/* Number of unloadings of all stations */
+	uint64_t unload_count;
+	/* Unloadings per simulated hour */
+	double unloads_per_hour;
+	/* Mean station queue wait per unloading in minutes */
+	double mean_queue_wait;
+	/* 95th percentile of the station queue wait in minutes */
+	double p95_queue_wait;
+	/* Mean fraction of the simulated time the stations are unloading */
+	double station_utilization;
+	/* Tonnes unloaded by all stations. Since version 2. */
+	uint64_t unloaded_tonnes;
+	/* Tonnes unloaded per simulated hour. Since version 2. */
+	double tonnes_per_hour;
+} mining_sim_result;
+
+/**
+ * Get the version of the C ABI the library implements
+ *
+ * @return   MINING_SIM_API_VERSION of the library
+ */
+uint32_t mining_sim_api_version(void);
+
+/**
+ * Get the description of the latest error of the calling thread
+ *
+ * @return   Error text. It is valid until the next call on the thread.
+ */
+const char* mining_sim_last_error(void);
+
+/**
+ * Build a scenario. Station and truck ids are their one based positions.
+ *
+ * @param[in]  simulation_time        Simulated time to run in milliseconds
+ * @param[in]  seed                   Default seed of the scenario
+ * @param[in]  distributions          Timing distributions
+ * @param[in]  distribution_count     Number of distributions
+ * @param[in]  station_distributions  Unloading distribution index of each station
+ * @param[in]  station_count          Number of stations
+ * @param[in]  trucks                 Trucks
+ * @param[in]  truck_count            Number of trucks
+ * @param[out] scenario               New scenario handle
+ *
+ * @return     Status
+ */
+int mining_sim_scenario_create(uint64_t simulation_time, uint64_t seed,
+                               const mining_sim_distribution* distributions, uint32_t distribution_count,
+                               const uint32_t* station_distributions, uint32_t station_count,
+                               const mining_sim_truck* trucks, uint32_t truck_count,
+                               mining_sim_scenario** scenario);
+
+/**
+ * Build a scenario of a mixed fleet. Station and truck ids are their one
+ * based positions. Since version 2.
+ *
+ * @param[in]  simulation_time     Simulated time to run in milliseconds
+ * @param[in]  seed                Default seed of the scenario
+ * @param[in]  distributions       Timing distributions
+ * @param[in]  distribution_count  Number of distributions
+ * @param[in]  stations            Stations
+ * @param[in]  station_count       Number of stations
+ * @param[in]  truck_classes       Truck classes
+ * @param[in]  truck_class_count   Number of truck classes
+ * @param[in]  truck_class_indexes Truck class index of each truck
+ * @param[in]  truck_count         Number of trucks
+ * @param[out] scenario            New scenario handle
+ *
+ * @return     Status
+ */
+int mining_sim_scenario_create_fleet(uint64_t simulation_time, uint64_t seed,
+                                     const mining_sim_distribution* distributions, uint32_t distribution_count,
+                                     const mining_sim_station* stations, uint32_t station_count,
+                                     const mining_sim_truck_class* truck_classes, uint32_t truck_class_count,
+                                     const uint32_t* truck_class_indexes, uint32_t truck_count,
+                                     mining_sim_scenario** scenario);
+
+/**
+ * Load a text or binary scenario file
+ *
+ * @param[in]  path       Path of the scenario file
+ * @param[out] scenario   New scenario handle
+ *
+ * @return     Status
+ */
+int mining_sim_scenario_load(const char* path, mining_sim_scenario** scenario);
+
+/**
+ * Get the default seed of a scenario
+ *
+ * @param[in] scenario   Scenario handle
+ *
+ * @return    Seed
+ */
+uint64_t mining_sim_scenario_seed(const mining_sim_scenario* scenario);
+
+/**
+ * Destroy a scenario. NULL is ignored.
+ *
+ * @param[in] scenario   Scenario handle
+ */
+void mining_sim_scenario_destroy(mining_sim_scenario* scenario);
+
+/**
+ * Run a scenario on the calling thread
+ *
+ * @param[in]     scenario   Scenario handle
+ * @param[in]     seed       Seed of the run
+ * @param[in,out] result     Results. Its size must be set by the caller.
+ *
+ * @return        Status
+ */
+int mining_sim_run(const mining_sim_scenario* scenario, uint64_t seed, mining_sim_result* result);
+
+/**
+ * Run a batch of scenarios on a number of threads. A scenario may be
+ * given several times, e.g. with different seeds.
+ *
+ * @param[in]     scenarios      Scenario handle of each run
+ * @param[in]     seeds          Seed of each run
+ * @param[in]     count          Number of runs
+ * @param[in]     thread_count   Most threads to use. 0 uses one per hardware thread.
+ * @param[in,out] results        Results of each run. Their size must be set by the caller
+ *                               and be the same for every run; the array is stepped by it,
+ *                               so a caller built against an older version passes its own array.
+ *
+ * @return        Status
+ */
+int mining_sim_run_batch(const mining_sim_scenario* const* scenarios, const uint64_t* seeds, uint32_t count,
+                         uint32_t thread_count, mining_sim_result* results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MININGSIM_H_ */
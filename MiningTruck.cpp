@@ -4,72 +4,200 @@
  * MiningTruck class methods implementation
  */
 
+#include <chrono>
+#include <random>
 #include "MiningTruck.h"
 #include "Constants.h"
+#include "SimMetrics.h"
 
-MiningTruck::MiningTruck(uint16_t truckId)
+const char* GetTruckStateName(TruckState state)
+{
+	static const char* const kNames[kTruckStateCount] = {
+		"empty",
+		"travel_to_mine_site",
+		"travel_to_unloading_station",
+		"approaching_to_mine_site",
+		"loading_mine",
+		"approaching_unloading_station",
+		"unloading",
+		"waiting_in_queue"
+	};
+	return (uint32_t)state < kTruckStateCount ? kNames[state] : "unknown";
+}
+
+MiningTruck::MiningTruck(uint16_t truckId, std::stop_token stopToken)
 {
 	m_truckId = truckId;
+	m_sequence = 0;
 	m_travelCount = 0;
 	m_unloadCount = 0;
 	m_loadCount = 0;
 	m_totalLoadingTime = 0;
 	m_truckState = TruckState::empty;
+	m_unloadingCompleted = false;
+	m_stopToken = stopToken;
+	m_numaNode = 0;
+	m_priorityClass = 0;
+	m_payload = kDefaultTruckPayload;
+	SimMetrics::GetInstance()->AddTruck(m_truckState);
 }
-TruckState MiningTruck::GetTruckState()
+TruckState MiningTruck::GetTruckState() const
 {
-	return m_truckState;
+	return m_truckState.load(std::memory_order_acquire);
 }
 void MiningTruck::SetTruckState(TruckState newState)
 {
-	m_truckState = newState;
+	SimMetrics::GetInstance()->MoveTruck(m_truckState.load(std::memory_order_relaxed), newState);
+	SimMetrics::GetInstance()->AddProcessedEvents(1);
+	BeginWrite();
+	m_truckState.store(newState, std::memory_order_relaxed);
+	EndWrite();
+}
+void MiningTruck::BeginWrite()
+{
+	// Only the truck thread writes, so the sequence needs no read-modify-write.
+	m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	// The odd sequence becomes visible before any of the field stores.
+	std::atomic_thread_fence(std::memory_order_release);
+}
+void MiningTruck::EndWrite()
+{
+	m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+TruckSnapshot MiningTruck::GetSnapshot() const
+{
+	TruckSnapshot snapshot;
+	snapshot.truckId = m_truckId;
+	uint32_t sequence;
+	do
+	{
+		sequence = m_sequence.load(std::memory_order_acquire);
+		snapshot.state = m_truckState.load(std::memory_order_relaxed);
+		snapshot.travelCount = m_travelCount.load(std::memory_order_relaxed);
+		snapshot.loadCount = m_loadCount.load(std::memory_order_relaxed);
+		snapshot.unloadCount = m_unloadCount.load(std::memory_order_relaxed);
+		snapshot.totalLoadingTime = m_totalLoadingTime.load(std::memory_order_relaxed);
+		// The field loads complete before the sequence is read again.
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((sequence & 1) || sequence != m_sequence.load(std::memory_order_relaxed));
+	return snapshot;
+}
+void MiningTruck::GetFleetSnapshot(const std::vector<MiningTruck*>& trucks, std::vector<TruckSnapshot>& snapshots)
+{
+	snapshots.resize(trucks.size());
+	for (size_t i = 0; i < trucks.size(); ++i)
+	{
+		snapshots[i] = trucks[i]->GetSnapshot();
+	}
+}
+uint16_t MiningTruck::GetTruckId() const
+{
+	return m_truckId;
+}
+void MiningTruck::SetNumaNode(uint32_t node)
+{
+	m_numaNode = node;
+}
+uint32_t MiningTruck::GetNumaNode() const
+{
+	return m_numaNode;
+}
+void MiningTruck::SetPriorityClass(uint32_t priorityClass)
+{
+	m_priorityClass = priorityClass;
+}
+uint32_t MiningTruck::GetPriorityClass() const
+{
+	return m_priorityClass;
+}
+void MiningTruck::SetPayload(uint32_t payload)
+{
+	m_payload = payload;
+}
+uint32_t MiningTruck::GetPayload() const
+{
+	return m_payload;
+}
+std::stop_token MiningTruck::GetStopToken() const
+{
+	return m_stopToken;
 }
 void MiningTruck::IncrementTravelCount()
 {
-	m_travelCount++;
+	BeginWrite();
+	m_travelCount.store(m_travelCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	EndWrite();
 }
 void MiningTruck::IncrementUnloadCount()
 {
-	m_unloadCount++;
+	BeginWrite();
+	m_unloadCount.store(m_unloadCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	EndWrite();
 }
 
 void MiningTruck::UpdateLoadingTime(uint64_t loadingTime)
 {
-	m_totalLoadingTime += loadingTime;
-	m_loadCount++;
+	BeginWrite();
+	m_totalLoadingTime.store(m_totalLoadingTime.load(std::memory_order_relaxed) + loadingTime, std::memory_order_relaxed);
+	m_loadCount.store(m_loadCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	EndWrite();
+}
+
+uint32_t MiningTruck::GetTravelCount() const
+{
+	return m_travelCount.load(std::memory_order_relaxed);
+}
+
+uint32_t MiningTruck::GetLoadCount() const
+{
+	return m_loadCount.load(std::memory_order_relaxed);
 }
 
-void MiningTruck::WaitForUnloadingCompletion()
+uint32_t MiningTruck::GetUnloadCount() const
+{
+	return m_unloadCount.load(std::memory_order_relaxed);
+}
+
+uint64_t MiningTruck::GetTotalLoadingTime() const
+{
+	return m_totalLoadingTime.load(std::memory_order_relaxed);
+}
+
+bool MiningTruck::WaitForUnloadingCompletion()
 {
 	  std::unique_lock<std::mutex> lock(m_guard);
-	  m_signal.wait(lock);
+	  // The flag keeps a notification which arrives before the wait starts.
+	  bool completed = m_signal.wait(lock, m_stopToken, [this] { return m_unloadingCompleted; });
+	  m_unloadingCompleted = false;
+	  return completed;
 }
 
 void MiningTruck::NotifyUnloadingCompletion()
 {
 	  std::unique_lock<std::mutex> lock(m_guard);
+	  m_unloadingCompleted = true;
 	  m_signal.notify_one();
 }
 
-static int MiningTruck::GetTravelTime()
+int MiningTruck::GetTravelTime()
 {
 	return (kTravelTimeInMinute * kSecondsPerMinute * kMilliSecondsPerSecond) / kFactorValue;
 }
 
-static int MiningTruck::GetLoadingTime()
+int MiningTruck::GetLoadingTime()
 {
-	int loadingTime;
 	//Get random value between minimum loading time in milliseconds and maximum loading time in milliseconds.
 	//Then divide by factor value
-	return loadingTime;
+	static thread_local std::mt19937 generator(std::random_device{}());
+	std::uniform_int_distribution<int> loadingTime(
+			kMinloadingTimeInHour * kMinutePerHour * kSecondsPerMinute * kMilliSecondsPerSecond,
+			kMaxloadingTimeInHour * kMinutePerHour * kSecondsPerMinute * kMilliSecondsPerSecond);
+	return loadingTime(generator) / kFactorValue;
 }
 
-static int MiningTruck::GetUnloadingTime()
+int MiningTruck::GetUnloadingTime()
 {
-	int unloadingTime;
-	//Get random value between minimum loading time in milliseconds and maximum loading time in milliseconds.
-	//Then divide by factor value
-	return unloadingTime;
+	return (kUnloadingTimeInMinute * kSecondsPerMinute * kMilliSecondsPerSecond) / kFactorValue;
 }
 
 ostream & operator << (ostream &out, const MiningTruck &truck)
@@ -79,18 +207,12 @@ ostream & operator << (ostream &out, const MiningTruck &truck)
     return out;
 }
 
-void MiningTruck::StopSimulation()
-{
-	  std::unique_lock<std::mutex> lock(m_waitMutex);
-	  m_waitSignal.notify_one();
-}
-
 bool MiningTruck::Wait(int waitTime)
 {
-	  //use condition variable wait_for function to wait until given wait time.
-	  // It return true if it is timeout. False if it is not timed out and awaken by
-	 // stop simulation function.
-	return true;
+	  // Nothing notifies m_waitSignal, so only the timeout or a stop request ends the wait.
+	  std::unique_lock<std::mutex> lock(m_waitMutex);
+	  m_waitSignal.wait_for(lock, m_stopToken, std::chrono::milliseconds(waitTime), [] { return false; });
+	  return !m_stopToken.stop_requested();
 }
 
 
@@ -11,8 +11,11 @@
 
 #include <iostream>
 #include <unistd.h>
+#include <atomic>
 #include <mutex>
+#include <vector>
 #include <condition_variable>
+#include <stop_token>
 
 using namespace std;
 
@@ -31,8 +34,45 @@ typedef enum TruckState {
 	waiting_in_queue = 7
 } TruckState;
 
+// Number of TruckState values
+static const uint32_t kTruckStateCount = 8;
+
+/**
+ * Get the name of the truck state
+ *
+ * @param[in] state  Truck state
+ *
+ * @return    Name of the state, e.g. "loading_mine"
+ */
+const char* GetTruckStateName(TruckState state);
+
+/**
+ * Consistent copy of the state and counters of a truck. All the fields
+ * are read between the same two writes of the truck.
+ */
+struct TruckSnapshot
+{
+	// Truck Id
+	uint16_t truckId;
+	// Truck state
+	TruckState state;
+	// Number of times truck travels between site and unloading station
+	uint32_t travelCount;
+	// Number of times truck is loaded
+	uint32_t loadCount;
+	// Number of times truck unloads the mine
+	uint32_t unloadCount;
+	// Total loading time in milliseconds
+	uint64_t totalLoadingTime;
+};
+
 /**
  * MiningTruck Class
+ *
+ * The state and the counters are written only by the thread which runs
+ * the truck and can be read by any thread. Every write is enclosed in a
+ * sequence lock, so GetSnapshot returns them without tearing and without
+ * blocking the truck.
  */
 class MiningTruck
 {
@@ -40,9 +80,11 @@ public:
    /**
 	* Constructor
 	*
-	* @param[in] truckId Identifier of the truck
+	* @param[in] truckId    Identifier of the truck
+	* @param[in] stopToken  Stop token of the simulation. All the waits
+	*                       of the truck return as soon as stop is requested.
 	*/
-	MiningTruck(uint16_t truckId);
+	MiningTruck(uint16_t truckId, std::stop_token stopToken = std::stop_token());
    /**
 	* Get the current state of the truck
 	*
@@ -50,7 +92,7 @@ public:
 	*                       TruckState enumeration data type is used to
 	*                       represent the current state of the truck
 	*/
-	TruckState GetTruckState();
+	TruckState GetTruckState() const;
    /**
 	* Set the current state of the truck
 	*
@@ -77,11 +119,55 @@ public:
 	* @param[in] loadingTime Loading time in milliseconds
 	*/
 	void UpdateLoadingTime(uint64_t loadingTime);
+	/**
+	 * Get the number of travels between mining site and unloading station
+	 *
+	 * @return   Unsigned Integer  Travel count
+	 */
+	uint32_t GetTravelCount() const;
+	/**
+	 * Get the number of times the truck is loaded
+	 *
+	 * @return   Unsigned Integer  Load count
+	 */
+	uint32_t GetLoadCount() const;
+	/**
+	 * Get the number of times the truck unloads the mine
+	 *
+	 * @return   Unsigned Integer  Unload count
+	 */
+	uint32_t GetUnloadCount() const;
+	/**
+	 * Get the total loading time of the truck
+	 *
+	 * @return   Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t GetTotalLoadingTime() const;
+	/**
+	 * Get a consistent copy of the state and counters of the truck.
+	 * It retries while the truck is writing them, which lasts a few
+	 * nanoseconds.
+	 *
+	 * @return   TruckSnapshot  State and counters of the truck
+	 */
+	TruckSnapshot GetSnapshot() const;
+	/**
+	 * Get a snapshot of every truck of the fleet while they keep running.
+	 * Each snapshot is consistent on its own; trucks are read one after
+	 * another, so the fleet view spans the few microseconds of the loop.
+	 *
+	 * @param[in]  trucks     Trucks of the fleet
+	 * @param[out] snapshots  Snapshot of every truck. Existing content is replaced.
+	 */
+	static void GetFleetSnapshot(const std::vector<MiningTruck*>& trucks, std::vector<TruckSnapshot>& snapshots);
    /**
 	* Wait for unloading to be completed.
 	* It uses conditional variable wait function.
+	*
+	* @return    bool  True if unloading is completed,
+	*                  otherwise False if stop is requested
 	*/
-	void WaitForUnloadingCompletion();
+	bool WaitForUnloadingCompletion();
    /**
 	* Notify the unloading process completion
 	* It uses conditional variable notify function.
@@ -90,16 +176,61 @@ public:
 	*/
 	void NotifyUnloadingCompletion();
 	/**
-	 * Stop the simulation
+	 * Get the identifier of the truck
+	 *
+	 * @return   Unsigned Integer  Truck Id
+	 */
+	uint16_t GetTruckId() const;
+	/**
+	 * Set the NUMA node of the thread which serves the truck
+	 *
+	 * @param[in] node  Node index
+	 */
+	void SetNumaNode(uint32_t node);
+	/**
+	 * Get the NUMA node of the thread which serves the truck
+	 *
+	 * @return   Unsigned Integer  Node index
+	 */
+	uint32_t GetNumaNode() const;
+	/**
+	 * Set the priority class of the truck in the station queues,
+	 * e.g. for trucks due for maintenance or carrying blending ore
+	 *
+	 * @param[in] priorityClass  Priority class. 0 is the highest.
+	 */
+	void SetPriorityClass(uint32_t priorityClass);
+	/**
+	 * Get the priority class of the truck in the station queues
+	 *
+	 * @return   Unsigned Integer  Priority class. 0 is the highest.
 	 */
-	void StopSimulation();
+	uint32_t GetPriorityClass() const;
+	/**
+	 * Set the payload of the truck from its truck class
+	 *
+	 * @param[in] payload  Payload in tonnes
+	 */
+	void SetPayload(uint32_t payload);
+	/**
+	 * Get the payload of the truck
+	 *
+	 * @return   Unsigned Integer  Payload in tonnes
+	 */
+	uint32_t GetPayload() const;
+	/**
+	 * Get the stop token of the simulation, to wait on it outside the truck
+	 *
+	 * @return   stop_token  Stop token of the simulation
+	 */
+	std::stop_token GetStopToken() const;
 	/**
 	 * Wait method. Truck waits for the given period.
 	 *
 	 * @param[in] waitTime Wait time in milliseconds
 	 *
 	 * @return    bool  True if it waits for the given time,
-	 *                  otherwise False if it is interrupted
+	 *                  otherwise False if stop is requested
 	 */
 	bool Wait(int waitTime);
 	/**
@@ -134,24 +265,45 @@ public:
 private:
 	// Truck Id
 	uint16_t m_truckId;
+	/**
+	 * Start a write of the state or counters. The sequence becomes odd.
+	 */
+	void BeginWrite();
+	/**
+	 * End a write of the state or counters. The sequence becomes even again.
+	 */
+	void EndWrite();
+
+	//Sequence lock of the state and counters. It is odd while the truck writes them.
+	std::atomic<uint32_t> m_sequence;
 	//Number of times truck travels between site and unloading station
-	uint8_t m_travelCount;
+	std::atomic<uint32_t> m_travelCount;
 	//Number of times truck unloads the mine.
-	uint8_t m_unloadCount;
+	std::atomic<uint32_t> m_unloadCount;
 	//Number of times truck is loaded
-	uint8_t m_loadCount;
+	std::atomic<uint32_t> m_loadCount;
 	//Total loading times used by truck to load the mine
-	uint32_t m_totalLoadingTime;
+	std::atomic<uint64_t> m_totalLoadingTime;
 	//Truck current state
-	TruckState m_truckState;
+	std::atomic<TruckState> m_truckState;
+	//NUMA node of the thread which serves the truck
+	uint32_t m_numaNode;
+	//Priority class of the truck in the station queues
+	uint32_t m_priorityClass;
+	//Payload of the truck in tonnes
+	uint32_t m_payload;
 	//Mutex object used by conditional variable m_signal
 	mutable std::mutex m_guard;
 	//Conditional variable used for unloading completion status
-	std::condition_variable m_signal;
+	std::condition_variable_any m_signal;
+	//True once the station notifies the unloading completion
+	bool m_unloadingCompleted;
 	//Conditional variable used for waiting time
-	std::condition_variable m_waitSignal;
+	std::condition_variable_any m_waitSignal;
 	//Mutex object used by conditional variable m_waitSignal
 	mutable std::mutex m_waitMutex;
+	//Stop token of the simulation. It wakes up m_signal and m_waitSignal.
+	std::stop_token m_stopToken;
 };
 
 #endif /* MININGTRUCK_H_ */
@@ -0,0 +1,106 @@
+/**
+ * @file  NumaPlacement.cpp
+ *
+ * This file contains NumaPlacement class methods implementation.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <unistd.h>
+#include "NumaPlacement.h"
+
+// Highest node number probed in sysfs
+static const uint32_t kMaxNumaNodes = 64;
+
+NumaPlacement::NumaPlacement()
+{
+	sched_getaffinity(0, sizeof(m_initialCpus), &m_initialCpus);
+
+	for (uint32_t node = 0; node < kMaxNumaNodes; ++node)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+		FILE* file = fopen(path, "r");
+		if (!file)
+		{
+			continue;
+		}
+		char cpuList[1024] = {0};
+		size_t length = fread(cpuList, 1, sizeof(cpuList) - 1, file);
+		fclose(file);
+		cpuList[length] = '\0';
+
+		cpu_set_t cpuSet;
+		// Memory only nodes have an empty cpulist. No thread can be pinned there.
+		if (ParseCpuList(cpuList, cpuSet))
+		{
+			m_nodeCpus.push_back(cpuSet);
+		}
+	}
+
+	if (m_nodeCpus.empty())
+	{
+		m_nodeCpus.push_back(m_initialCpus);
+	}
+}
+
+uint32_t NumaPlacement::GetNodeCount() const
+{
+	return m_nodeCpus.size();
+}
+
+uint32_t NumaPlacement::GetStationNode(uint32_t stationIndex) const
+{
+	return stationIndex % m_nodeCpus.size();
+}
+
+uint32_t NumaPlacement::GetTruckNode(uint32_t truckIndex, uint32_t stationCount) const
+{
+	if (stationCount == 0)
+	{
+		return truckIndex % m_nodeCpus.size();
+	}
+	// Map the truck to the station with the same rank, so a node with
+	// more stations also serves more trucks.
+	return GetStationNode(truckIndex % stationCount);
+}
+
+bool NumaPlacement::PinCurrentThread(uint32_t node) const
+{
+	const cpu_set_t& cpuSet = m_nodeCpus[node % m_nodeCpus.size()];
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+}
+
+void NumaPlacement::UnpinCurrentThread() const
+{
+	pthread_setaffinity_np(pthread_self(), sizeof(m_initialCpus), &m_initialCpus);
+}
+
+bool NumaPlacement::ParseCpuList(const char* cpuList, cpu_set_t& cpuSet)
+{
+	CPU_ZERO(&cpuSet);
+	const char* position = cpuList;
+	while (*position)
+	{
+		char* end = NULL;
+		long first = strtol(position, &end, 10);
+		if (end == position)
+		{
+			break;
+		}
+		long last = first;
+		if (*end == '-')
+		{
+			position = end + 1;
+			last = strtol(position, &end, 10);
+		}
+		for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+		{
+			CPU_SET(cpu, &cpuSet);
+		}
+		position = (*end == ',') ? end + 1 : end;
+	}
+	return CPU_COUNT(&cpuSet) > 0;
+}
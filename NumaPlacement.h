@@ -0,0 +1,86 @@
+/**
+ * @file  NumaPlacement.h
+ *
+ * This file contains NumaPlacement class. It discovers the NUMA
+ * nodes of the host, assigns stations and trucks to nodes and
+ * pins the threads serving them to the CPUs of their node.
+ */
+
+#ifndef NUMAPLACEMENT_H_
+#define NUMAPLACEMENT_H_
+
+#include <cstdint>
+#include <vector>
+#include <sched.h>
+
+/**
+ * NumaPlacement class
+ */
+class NumaPlacement
+{
+public:
+	/**
+	 * Constructor. Reads the NUMA topology from sysfs. If it is not
+	 * available, all the online CPUs are treated as a single node.
+	 */
+	NumaPlacement();
+	/**
+	 * Get the number of NUMA nodes which have CPUs
+	 *
+	 * @return   Unsigned Integer  Number of nodes
+	 */
+	uint32_t GetNodeCount() const;
+	/**
+	 * Get the node which owns the given station.
+	 * Stations are spread round robin over the nodes.
+	 *
+	 * @param[in] stationIndex  Zero based index of the station
+	 *
+	 * @return    Unsigned Integer  Node index
+	 */
+	uint32_t GetStationNode(uint32_t stationIndex) const;
+	/**
+	 * Get the node which serves the given truck. Trucks are spread
+	 * over the nodes in proportion to the number of stations of each
+	 * node, so most of the trucks find a station on their own node.
+	 *
+	 * @param[in] truckIndex    Zero based index of the truck
+	 * @param[in] stationCount  Number of stations in the simulation
+	 *
+	 * @return    Unsigned Integer  Node index
+	 */
+	uint32_t GetTruckNode(uint32_t truckIndex, uint32_t stationCount) const;
+	/**
+	 * Pin the calling thread to the CPUs of the given node.
+	 * Memory first touched by the thread afterwards is allocated
+	 * on that node by the default Linux policy.
+	 *
+	 * @param[in] node   Node index
+	 *
+	 * @return    bool   True if the affinity is set, otherwise False.
+	 */
+	bool PinCurrentThread(uint32_t node) const;
+	/**
+	 * Restore the affinity the calling thread had before the
+	 * first PinCurrentThread call of this object.
+	 */
+	void UnpinCurrentThread() const;
+
+private:
+	/**
+	 * Parse the sysfs cpulist format, e.g. "0-3,8-11"
+	 *
+	 * @param[in]  cpuList   Content of the cpulist file
+	 * @param[out] cpuSet    CPU set with all the listed CPUs
+	 *
+	 * @return     bool      True if at least one CPU is listed.
+	 */
+	static bool ParseCpuList(const char* cpuList, cpu_set_t& cpuSet);
+
+	// CPU set of every node which has CPUs
+	std::vector<cpu_set_t> m_nodeCpus;
+	// Affinity of the constructing thread
+	cpu_set_t m_initialCpus;
+};
+
+#endif /* NUMAPLACEMENT_H_ */
@@ -0,0 +1,159 @@
+/**
+ * @file  ObjectPool.h
+ *
+ * This file contains ObjectPool class. It is a typed free-list
+ * pool whose slots are carved from an Arena, so acquiring and
+ * releasing objects never touches the heap once the pool is warm.
+ */
+
+#ifndef OBJECTPOOL_H_
+#define OBJECTPOOL_H_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "Arena.h"
+
+/**
+ * ObjectPool class
+ * It is not thread safe. It is used by the single threaded event loop.
+ * @tparam T the type of objects stored in the pool
+ */
+template<typename T> class ObjectPool
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] arena     Arena which provides the slots
+	 * @param[in] slabSize  Number of slots carved when the free list is empty
+	 */
+	ObjectPool(Arena& arena, size_t slabSize = 1024);
+	/**
+	 * Make sure the given number of objects can be acquired
+	 * without carving more slots from the arena.
+	 *
+	 * @param[in] count  Number of free slots needed
+	 */
+	void Reserve(size_t count);
+	/**
+	 * Create an object in a free slot
+	 *
+	 * @param[in] args   Constructor arguments
+	 *
+	 * @return    Pointer to the new object
+	 */
+	template<typename... Args> T* Acquire(Args&&... args);
+	/**
+	 * Destroy the object and put its slot back to the free list
+	 *
+	 * @param[in] object  Object returned by Acquire
+	 */
+	void Release(T* object);
+	/**
+	 * Get the number of acquired objects which are not released
+	 *
+	 * @return   Unsigned Integer  Number of live objects
+	 */
+	size_t GetLiveCount() const;
+	/**
+	 * Get the number of free slots
+	 *
+	 * @return   Unsigned Integer  Number of free slots
+	 */
+	size_t GetFreeCount() const;
+
+private:
+	/**
+	 * Slot holds either an object or the link of the free list
+	 */
+	union Slot
+	{
+		// Next free slot
+		Slot* next;
+		// Storage of the object
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+	/**
+	 * Carve the given number of slots from the arena and
+	 * add them to the free list
+	 *
+	 * @param[in] count  Number of slots
+	 */
+	void Grow(size_t count);
+
+	// Arena which owns the slot memory
+	Arena& m_arena;
+	// Head of the free list
+	Slot* m_freeList;
+	// Number of slots carved by Grow when the free list is empty
+	size_t m_slabSize;
+	// Number of live objects
+	size_t m_liveCount;
+	// Number of free slots
+	size_t m_freeCount;
+};
+
+template<typename T> ObjectPool<T>::ObjectPool(Arena& arena, size_t slabSize)
+	: m_arena(arena)
+{
+	m_freeList = NULL;
+	m_slabSize = slabSize;
+	m_liveCount = 0;
+	m_freeCount = 0;
+}
+
+template<typename T> void ObjectPool<T>::Reserve(size_t count)
+{
+	if (count > m_freeCount)
+	{
+		Grow(count - m_freeCount);
+	}
+}
+
+template<typename T> template<typename... Args> T* ObjectPool<T>::Acquire(Args&&... args)
+{
+	if (!m_freeList)
+	{
+		Grow(m_slabSize);
+	}
+	Slot* slot = m_freeList;
+	m_freeList = slot->next;
+	m_freeCount--;
+	m_liveCount++;
+	return new (slot->storage) T(std::forward<Args>(args)...);
+}
+
+template<typename T> void ObjectPool<T>::Release(T* object)
+{
+	object->~T();
+	Slot* slot = reinterpret_cast<Slot*>(object);
+	slot->next = m_freeList;
+	m_freeList = slot;
+	m_freeCount++;
+	m_liveCount--;
+}
+
+template<typename T> size_t ObjectPool<T>::GetLiveCount() const
+{
+	return m_liveCount;
+}
+
+template<typename T> size_t ObjectPool<T>::GetFreeCount() const
+{
+	return m_freeCount;
+}
+
+template<typename T> void ObjectPool<T>::Grow(size_t count)
+{
+	Slot* slots = static_cast<Slot*>(m_arena.Allocate(sizeof(Slot) * count, alignof(Slot)));
+	// Link in reverse, so slots are handed out in address order.
+	for (size_t i = count; i > 0; --i)
+	{
+		slots[i - 1].next = m_freeList;
+		m_freeList = &slots[i - 1];
+	}
+	m_freeCount += count;
+}
+
+#endif /* OBJECTPOOL_H_ */
@@ -0,0 +1,144 @@
+/**
+ * @file  PerturbationAnalysis.cpp
+ *
+ * PerturbationAnalysis class methods implementation
+ */
+
+#include <cmath>
+#include "PerturbationAnalysis.h"
+
+// Normal quantile of a two sided 95% confidence interval
+static const double kConfidenceQuantile = 1.96;
+
+/**
+ * Get the mean and the 95% confidence half-width of batch values
+ *
+ * @param[in]  values      Batch values
+ * @param[out] halfWidth   Confidence half-width
+ *
+ * @return     Double      Mean
+ */
+static double GetMean(const std::vector<double>& values, double& halfWidth)
+{
+	halfWidth = 0;
+	if (values.empty())
+	{
+		return 0;
+	}
+	double sum = 0;
+	for (double value : values)
+	{
+		sum += value;
+	}
+	const double mean = sum / values.size();
+	if (values.size() > 1)
+	{
+		double sumOfSquares = 0;
+		for (double value : values)
+		{
+			sumOfSquares += (value - mean) * (value - mean);
+		}
+		halfWidth = kConfidenceQuantile * std::sqrt(sumOfSquares / (values.size() - 1) / values.size());
+	}
+	return mean;
+}
+
+PerturbationAnalysis::PerturbationAnalysis(uint64_t simulationTime, uint32_t batchCount)
+	: m_batches(batchCount ? batchCount : 1, BatchSums())
+{
+	m_simulationTime = simulationTime;
+	m_truckCount = 0;
+}
+
+void PerturbationAnalysis::Resize(uint32_t truckCount, uint32_t stationCount)
+{
+	m_trucks.resize(truckCount, TruckGradient());
+	m_stationDeparture.resize(stationCount * kGradientParameterCount, 0);
+	m_truckCount = truckCount;
+}
+
+void PerturbationAnalysis::AddDelay(uint32_t truckIndex, GradientParameter parameter, double derivative)
+{
+	m_trucks[truckIndex].clock[(uint32_t)parameter] += derivative;
+}
+
+void PerturbationAnalysis::Arrive(uint32_t truckIndex)
+{
+	TruckGradient& truck = m_trucks[truckIndex];
+	for (uint32_t p = 0; p < kGradientParameterCount; ++p)
+	{
+		truck.arrival[p] = truck.clock[p];
+	}
+}
+
+void PerturbationAnalysis::LeaveQueue(uint32_t truckIndex, uint32_t stationIndex)
+{
+	// The start of a queued truck is the departure of the truck before it, and the
+	// departure is exactly the clock that truck had when it completed unloading.
+	TruckGradient& truck = m_trucks[truckIndex];
+	for (uint32_t p = 0; p < kGradientParameterCount; ++p)
+	{
+		truck.clock[p] = m_stationDeparture[stationIndex * kGradientParameterCount + p];
+	}
+}
+
+void PerturbationAnalysis::StartUnloading(uint32_t truckIndex, uint32_t stationIndex, double derivative, uint64_t now)
+{
+	TruckGradient& truck = m_trucks[truckIndex];
+	BatchSums& batch = GetBatch(now);
+	batch.unloadings++;
+	truck.clock[(uint32_t)GradientParameter::unloading_time] += derivative;
+	for (uint32_t p = 0; p < kGradientParameterCount; ++p)
+	{
+		// Wait = start - arrival. The unloading time just added is not part of it.
+		const double unloading = p == (uint32_t)GradientParameter::unloading_time ? derivative : 0;
+		batch.waitDerivative[p] += truck.clock[p] - unloading - truck.arrival[p];
+		m_stationDeparture[stationIndex * kGradientParameterCount + p] = truck.clock[p];
+	}
+}
+
+void PerturbationAnalysis::CompleteUnloading(uint32_t truckIndex, uint64_t now)
+{
+	TruckGradient& truck = m_trucks[truckIndex];
+	BatchSums& batch = GetBatch(now);
+	batch.cycles++;
+	batch.cycleTime += now - truck.lastCycleEndTime;
+	for (uint32_t p = 0; p < kGradientParameterCount; ++p)
+	{
+		batch.cycleDerivative[p] += truck.clock[p] - truck.lastCycleEnd[p];
+		truck.lastCycleEnd[p] = truck.clock[p];
+	}
+	truck.lastCycleEndTime = now;
+}
+
+GradientEstimate PerturbationAnalysis::GetEstimate(GradientParameter parameter) const
+{
+	// Closed network: throughput X = N / E[C], so dX = -N E[dC] / E[C]^2 per batch.
+	std::vector<double> throughput;
+	std::vector<double> queueWait;
+	for (size_t i = 1; i < m_batches.size(); ++i)
+	{
+		const BatchSums& batch = m_batches[i];
+		if (batch.cycles > 0 && batch.cycleTime > 0)
+		{
+			const double meanCycle = batch.cycleTime / batch.cycles;
+			const double meanDerivative = batch.cycleDerivative[(uint32_t)parameter] / batch.cycles;
+			// Per millisecond of mean time to per hour per minute.
+			throughput.push_back(-(double)m_truckCount * meanDerivative / (meanCycle * meanCycle) * 3600000.0 * 60000.0);
+		}
+		if (batch.unloadings > 0)
+		{
+			queueWait.push_back(batch.waitDerivative[(uint32_t)parameter] / batch.unloadings);
+		}
+	}
+	GradientEstimate estimate;
+	estimate.throughput = GetMean(throughput, estimate.throughputHalfWidth);
+	estimate.queueWait = GetMean(queueWait, estimate.queueWaitHalfWidth);
+	return estimate;
+}
+
+PerturbationAnalysis::BatchSums& PerturbationAnalysis::GetBatch(uint64_t now)
+{
+	const uint64_t batch = m_simulationTime ? now * m_batches.size() / m_simulationTime : 0;
+	return m_batches[batch < m_batches.size() ? batch : m_batches.size() - 1];
+}
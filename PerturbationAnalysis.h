@@ -0,0 +1,170 @@
+/**
+ * @file  PerturbationAnalysis.h
+ *
+ * This file contains PerturbationAnalysis class. It estimates, alongside
+ * one event driven run, the derivatives of station throughput and mean
+ * queue wait with respect to the mean unloading time and the mean travel
+ * time by infinitesimal perturbation analysis (IPA):
+ *  - a time drawn from a distribution scales with its mean, so its
+ *    derivative is time / mean,
+ *  - each truck carries the derivative of its clock, which grows by the
+ *    derivative of every delay it draws,
+ *  - a truck which starts unloading from a queue inherits the derivative
+ *    of the departure of the truck before it, as in a FIFO queue.
+ * Throughput derivatives come from the cycle times of the trucks.
+ * Confidence intervals use batch means over the simulated time, the
+ * first batch is dropped as warm-up.
+ */
+
+#ifndef PERTURBATIONANALYSIS_H_
+#define PERTURBATIONANALYSIS_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Parameters the derivatives are taken with respect to
+ */
+enum class GradientParameter : uint32_t
+{
+	unloading_time = 0,
+	travel_time = 1
+};
+// Number of GradientParameter values
+static const uint32_t kGradientParameterCount = 2;
+
+/**
+ * Derivative estimate with respect to one parameter
+ */
+struct GradientEstimate
+{
+	// d(unloadings per hour) / d(mean time in minutes)
+	double throughput;
+	// 95% confidence half-width of the throughput derivative
+	double throughputHalfWidth;
+	// d(mean queue wait in minutes) / d(mean time in minutes)
+	double queueWait;
+	// 95% confidence half-width of the queue wait derivative
+	double queueWaitHalfWidth;
+};
+
+/**
+ * PerturbationAnalysis class
+ */
+class PerturbationAnalysis
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] simulationTime   Simulated time of the run in milliseconds
+	 * @param[in] batchCount       Number of batches of the confidence intervals
+	 */
+	PerturbationAnalysis(uint64_t simulationTime, uint32_t batchCount);
+	/**
+	 * Set the number of trucks and stations tracked. Existing ones keep their state.
+	 *
+	 * @param[in] truckCount     Number of trucks
+	 * @param[in] stationCount   Number of stations
+	 */
+	void Resize(uint32_t truckCount, uint32_t stationCount);
+	/**
+	 * A truck draws a delay which depends on a parameter
+	 *
+	 * @param[in] truckIndex   Index of the truck
+	 * @param[in] parameter    Parameter of the delay
+	 * @param[in] derivative   Derivative of the delay, i.e. delay / mean delay
+	 */
+	void AddDelay(uint32_t truckIndex, GradientParameter parameter, double derivative);
+	/**
+	 * A truck arrives at the unloading stations
+	 *
+	 * @param[in] truckIndex   Index of the truck
+	 */
+	void Arrive(uint32_t truckIndex);
+	/**
+	 * A truck leaves the queue of a station when the truck before it departs
+	 *
+	 * @param[in] truckIndex     Index of the truck
+	 * @param[in] stationIndex   Index of the station
+	 */
+	void LeaveQueue(uint32_t truckIndex, uint32_t stationIndex);
+	/**
+	 * A truck starts unloading at a station
+	 *
+	 * @param[in] truckIndex     Index of the truck
+	 * @param[in] stationIndex   Index of the station
+	 * @param[in] derivative     Derivative of the unloading time
+	 * @param[in] now            Simulated time in milliseconds
+	 */
+	void StartUnloading(uint32_t truckIndex, uint32_t stationIndex, double derivative, uint64_t now);
+	/**
+	 * A truck completes unloading, which ends one of its cycles
+	 *
+	 * @param[in] truckIndex   Index of the truck
+	 * @param[in] now          Simulated time in milliseconds
+	 */
+	void CompleteUnloading(uint32_t truckIndex, uint64_t now);
+	/**
+	 * Get the derivative estimates with respect to a parameter
+	 *
+	 * @param[in] parameter    Parameter
+	 *
+	 * @return    Derivative estimates
+	 */
+	GradientEstimate GetEstimate(GradientParameter parameter) const;
+
+private:
+	/**
+	 * Per-truck derivative state
+	 */
+	struct TruckGradient
+	{
+		// Derivatives of the truck clock
+		double clock[kGradientParameterCount];
+		// Derivatives of the arrival time at the stations
+		double arrival[kGradientParameterCount];
+		// Derivatives of the end of the last cycle
+		double lastCycleEnd[kGradientParameterCount];
+		// End of the last cycle in milliseconds
+		uint64_t lastCycleEndTime;
+	};
+	/**
+	 * Sums of one batch
+	 */
+	struct BatchSums
+	{
+		// Number of truck cycles completed
+		uint64_t cycles;
+		// Sum of the cycle times in milliseconds
+		double cycleTime;
+		// Sums of the cycle time derivatives
+		double cycleDerivative[kGradientParameterCount];
+		// Number of unloadings started
+		uint64_t unloadings;
+		// Sums of the queue wait derivatives
+		double waitDerivative[kGradientParameterCount];
+	};
+
+	/**
+	 * Get the batch of a simulated time
+	 *
+	 * @param[in] now   Simulated time in milliseconds
+	 *
+	 * @return    Batch sums
+	 */
+	BatchSums& GetBatch(uint64_t now);
+
+	// Simulated time of the run in milliseconds
+	uint64_t m_simulationTime;
+	// Number of trucks, the fleet size of the closed network
+	uint32_t m_truckCount;
+	// Per-truck derivative state
+	std::vector<TruckGradient> m_trucks;
+	// Derivatives of the departure time of the current truck of every station
+	std::vector<double> m_stationDeparture;
+	// Sums of every batch
+	std::vector<BatchSums> m_batches;
+};
+
+#endif /* PERTURBATIONANALYSIS_H_ */
@@ -0,0 +1,158 @@
+/**
+ * @file  PriorityBlockingQueue.cpp
+ *
+ * Priority Blocking Queue class methods implementation
+ */
+
+#include <algorithm>
+#include "PriorityBlockingQueue.h"
+
+class MiningTruck;
+
+using std::chrono::steady_clock;
+
+template <typename T> PriorityBlockingQueue<T>::PriorityBlockingQueue(uint32_t classCount)
+	: m_classes(std::min(std::max(classCount, 1u), kMaxPriorityClasses)),
+	  m_classStats(m_classes.size())
+{
+}
+
+template <typename T> std::unique_lock<std::mutex> PriorityBlockingQueue<T>::lock() const
+{
+#ifdef BLOCKING_QUEUE_STATS
+	std::unique_lock<std::mutex> lock(m_guard, std::try_to_lock);
+	if (!lock.owns_lock())
+	{
+		steady_clock::time_point start = steady_clock::now();
+		lock.lock();
+		m_stats.contendedAcquisitions++;
+		m_stats.lockWaitTime += std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - start).count();
+	}
+	m_stats.acquisitions++;
+	return lock;
+#else
+	return std::unique_lock<std::mutex>(m_guard);
+#endif
+}
+
+template <typename T> void PriorityBlockingQueue<T>::push(T const& data, uint32_t priorityClass)
+{
+	const steady_clock::time_point now = steady_clock::now();
+	{
+		std::unique_lock<std::mutex> guard = lock();
+		m_classes[std::min<size_t>(priorityClass, m_classes.size() - 1)].push_back(Entry{ data, now });
+		m_size++;
+#ifdef BLOCKING_QUEUE_STATS
+		if (m_size > m_stats.highWaterMark)
+		{
+			m_stats.highWaterMark = m_size;
+		}
+#endif
+	}
+	m_signal.notify_one();
+}
+
+template <typename T> bool PriorityBlockingQueue<T>::empty() const
+{
+	std::unique_lock<std::mutex> guard = lock();
+	return m_size == 0;
+}
+
+template <typename T> uint64_t PriorityBlockingQueue<T>::size() const
+{
+	std::unique_lock<std::mutex> guard = lock();
+	return m_size;
+}
+
+template <typename T> uint64_t PriorityBlockingQueue<T>::size(uint32_t priorityClass) const
+{
+	std::unique_lock<std::mutex> guard = lock();
+	uint64_t count = 0;
+	for (size_t i = 0; i < m_classes.size() && i <= priorityClass; ++i)
+	{
+		count += m_classes[i].size();
+	}
+	return count;
+}
+
+template <typename T> T PriorityBlockingQueue<T>::take(steady_clock::time_point now)
+{
+	size_t priorityClass = 0;
+	while (m_classes[priorityClass].empty())
+	{
+		priorityClass++;
+	}
+	std::deque<Entry>& bucket = m_classes[priorityClass];
+	const Entry entry = bucket.front();
+	bucket.pop_front();
+	m_size--;
+	m_classStats[priorityClass].Add(std::chrono::duration_cast<std::chrono::microseconds>(now - entry.pushTime).count());
+	return entry.value;
+}
+
+template <typename T> bool PriorityBlockingQueue<T>::pop(T& value, int milliseconds, std::stop_token stopToken)
+{
+	std::unique_lock<std::mutex> guard = lock();
+	// The predicate is checked once before blocking and once after every wakeup.
+	uint64_t checks = 0;
+	bool ready = m_signal.wait_for(guard, stopToken, std::chrono::milliseconds(milliseconds),
+			[this, &checks] { ++checks; return m_size != 0; });
+#ifdef BLOCKING_QUEUE_STATS
+	if (checks > 1)
+	{
+		m_stats.spuriousWakeups += checks - 2;
+	}
+	if (!ready && !stopToken.stop_requested())
+	{
+		m_stats.timeoutWakeups++;
+	}
+#endif
+	if (!ready)
+	{
+		return false;
+	}
+	value = take(steady_clock::now());
+	return true;
+}
+
+template <typename T> bool PriorityBlockingQueue<T>::popAll(std::vector<T>& values, std::stop_token stopToken)
+{
+	values.clear();
+	std::unique_lock<std::mutex> guard = lock();
+	uint64_t checks = 0;
+	m_signal.wait(guard, stopToken, [this, &checks] { ++checks; return m_size != 0; });
+#ifdef BLOCKING_QUEUE_STATS
+	if (checks > 1)
+	{
+		m_stats.spuriousWakeups += checks - 2;
+	}
+#endif
+	// Every item has to be timed and ordered, so the drain happens under the lock.
+	values.reserve(m_size);
+	const steady_clock::time_point now = steady_clock::now();
+	while (m_size != 0)
+	{
+		values.push_back(take(now));
+	}
+	return !values.empty();
+}
+
+template <typename T> uint32_t PriorityBlockingQueue<T>::classCount() const
+{
+	return m_classes.size();
+}
+
+template <typename T> PriorityClassStats PriorityBlockingQueue<T>::classStats(uint32_t priorityClass) const
+{
+	std::unique_lock<std::mutex> guard = lock();
+	return priorityClass < m_classStats.size() ? m_classStats[priorityClass] : PriorityClassStats();
+}
+
+template <typename T> BlockingQueueStats PriorityBlockingQueue<T>::stats() const
+{
+	std::unique_lock<std::mutex> guard = lock();
+	return m_stats;
+}
+
+// Stations queue trucks by pointer.
+template class PriorityBlockingQueue<MiningTruck*>;
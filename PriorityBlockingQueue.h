@@ -0,0 +1,285 @@
+/**
+ * @file  PriorityBlockingQueue.h
+ *
+ * Class for the Priority Blocking Queue. This class provides
+ * a set of methods to add the item, get the item from
+ * blocking queue, check the size of the queue and its
+ * empty status. Every item is pushed with a priority class and pop
+ * returns the oldest item of the highest class. Classes are kept in
+ * separate FIFO buckets, so push is O(1) and pop is O(number of
+ * classes). With a single class it is a FIFO queue. The time every
+ * item waits is recorded per class.
+ *
+ * Building with BLOCKING_QUEUE_STATS defined compiles lock
+ * contention, wakeup and depth counters into every queue.
+ */
+
+#ifndef PRIORITYBLOCKINGQUEUE_H_
+#define PRIORITYBLOCKINGQUEUE_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <stop_token>
+
+#ifdef BLOCKING_QUEUE_STATS
+// True if queue instrumentation is compiled in
+static const bool kBlockingQueueStatsEnabled = true;
+#else
+// True if queue instrumentation is compiled in
+static const bool kBlockingQueueStatsEnabled = false;
+#endif
+
+/**
+ * Instrumentation counters of one PriorityBlockingQueue.
+ * All the counters stay 0 unless BLOCKING_QUEUE_STATS is defined.
+ */
+struct BlockingQueueStats
+{
+	// Number of times m_guard is acquired
+	uint64_t acquisitions = 0;
+	// Number of acquisitions which found m_guard already locked
+	uint64_t contendedAcquisitions = 0;
+	// Time spent waiting for m_guard in contended acquisitions, in nanoseconds
+	uint64_t lockWaitTime = 0;
+	// Number of pop wakeups which found the queue still empty
+	uint64_t spuriousWakeups = 0;
+	// Number of pop calls which return because the timeout expired
+	uint64_t timeoutWakeups = 0;
+	// Highest number of items seen in the queue
+	uint64_t highWaterMark = 0;
+
+	/**
+	 * Add the counters of another queue. High water mark is the maximum.
+	 *
+	 * @param[in] other  Counters of another queue
+	 */
+	void Merge(const BlockingQueueStats& other)
+	{
+		acquisitions += other.acquisitions;
+		contendedAcquisitions += other.contendedAcquisitions;
+		lockWaitTime += other.lockWaitTime;
+		spuriousWakeups += other.spuriousWakeups;
+		timeoutWakeups += other.timeoutWakeups;
+		if (other.highWaterMark > highWaterMark)
+		{
+			highWaterMark = other.highWaterMark;
+		}
+	}
+};
+
+// Largest number of priority classes of a queue
+static const uint32_t kMaxPriorityClasses = 8;
+// Number of power of two buckets of the per-class wait histogram
+static const uint32_t kPriorityWaitBuckets = 40;
+
+/**
+ * Queue wait statistics of one priority class
+ */
+struct PriorityClassStats
+{
+	// Number of items popped
+	uint64_t count = 0;
+	// Sum of the waits in microseconds
+	uint64_t totalWait = 0;
+	// Longest wait in microseconds
+	uint64_t maxWait = 0;
+	// Bucket i counts waits below 2^i microseconds, which are not in a lower bucket
+	uint64_t histogram[kPriorityWaitBuckets] = {};
+
+	/**
+	 * Add a wait
+	 *
+	 * @param[in] wait   Wait in microseconds
+	 */
+	void Add(uint64_t wait)
+	{
+		uint32_t bucket = 0;
+		while (bucket + 1 < kPriorityWaitBuckets && (wait >> bucket) != 0)
+		{
+			bucket++;
+		}
+		histogram[bucket]++;
+		count++;
+		totalWait += wait;
+		if (wait > maxWait)
+		{
+			maxWait = wait;
+		}
+	}
+	/**
+	 * Add the statistics of the same class of another queue
+	 *
+	 * @param[in] other  Statistics of another queue
+	 */
+	void Merge(const PriorityClassStats& other)
+	{
+		count += other.count;
+		totalWait += other.totalWait;
+		if (other.maxWait > maxWait)
+		{
+			maxWait = other.maxWait;
+		}
+		for (uint32_t i = 0; i < kPriorityWaitBuckets; ++i)
+		{
+			histogram[i] += other.histogram[i];
+		}
+	}
+	/**
+	 * Get an upper bound of a percentile of the waits
+	 *
+	 * @param[in] percentile   Percentile in (0, 100]
+	 *
+	 * @return    Unsigned Integer  Wait in microseconds
+	 */
+	uint64_t GetPercentile(double percentile) const
+	{
+		const double rank = count * percentile / 100;
+		uint64_t cumulative = 0;
+		for (uint32_t i = 0; i < kPriorityWaitBuckets; ++i)
+		{
+			cumulative += histogram[i];
+			if (cumulative > 0 && cumulative >= rank)
+			{
+				return std::min<uint64_t>(((uint64_t)1 << i) - 1, maxWait);
+			}
+		}
+		return maxWait;
+	}
+};
+
+/**
+ * Priority Blocking Queue class
+ * @tparam T the type of data stored in the queue
+ */
+template<typename T> class PriorityBlockingQueue
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param[in] classCount   Number of priority classes, at most
+     *                         kMaxPriorityClasses. Class 0 is the highest.
+     */
+    explicit PriorityBlockingQueue(uint32_t classCount = 1);
+   /**
+	* Add the item in the queue.
+	*
+	* @param[in] data           Data to be added in the queue.
+	* @param[in] priorityClass  Priority class of the data. Classes beyond
+	*                           the last one are put in the last one.
+	*/
+    void push(T const& data, uint32_t priorityClass = 0);
+    /**
+ 	* Check if queue is empty or not
+ 	*
+ 	*  @return bool  True if queue is empty or False.
+ 	*/
+    bool empty() const;
+    /**
+ 	* Get the size of the queue
+ 	*
+ 	* @return Unsigned Integer   Size of the queue.
+ 	*/
+    uint64_t size() const;
+    /**
+ 	* Get the number of items which are popped before a new item of a class
+ 	*
+ 	* @param[in] priorityClass  Priority class
+ 	* @return Unsigned Integer  Number of items of that class or higher.
+ 	*/
+    uint64_t size(uint32_t priorityClass) const;
+    /**
+ 	* Get the oldest item of the highest class from the queue.
+ 	* If queue is empty, this call is blocked until data is added
+ 	* in the queue, given timeout value is expired or stop is requested.
+ 	*
+ 	* @param[out] value         Stores the data retrieved from the queue.
+ 	* @param[in] milliseconds   Timeout value in milliseconds.
+ 	* @param[in] stopToken      Stop token which wakes up the call immediately.
+ 	* @return    bool           True if it copies the data from the queue in the value
+ 	*                           out parameter.False if there is no data in the queue and
+ 	*                           timeout is expired or stop is requested
+ 	*/
+    bool pop(T& value, int milliseconds, std::stop_token stopToken = std::stop_token());
+    /**
+ 	* Get all the items from the queue in one operation, highest class
+ 	* first and in FIFO order within a class. If queue is empty, this
+ 	* call is blocked until data is added or stop is requested. There
+ 	* is no timeout, so an idle consumer does not poll.
+ 	*
+ 	* @param[out] values   Receives the drained items. Existing content is replaced.
+ 	* @param[in] stopToken Stop token which wakes up the call immediately.
+ 	* @return    bool      True if at least one item is drained. False if
+ 	*                      stop is requested.
+ 	*/
+    bool popAll(std::vector<T>& values, std::stop_token stopToken = std::stop_token());
+    /**
+ 	* Get the number of priority classes
+ 	*
+ 	* @return Unsigned Integer  Number of classes
+ 	*/
+    uint32_t classCount() const;
+    /**
+ 	* Get a copy of the wait statistics of a priority class
+ 	*
+ 	* @param[in] priorityClass  Priority class
+ 	* @return PriorityClassStats  Waits of the popped items of the class
+ 	*/
+    PriorityClassStats classStats(uint32_t priorityClass) const;
+    /**
+ 	* Get a copy of the instrumentation counters
+ 	*
+ 	* @return BlockingQueueStats  Counters of the queue. All 0 if
+ 	*                             BLOCKING_QUEUE_STATS is not defined.
+ 	*/
+    BlockingQueueStats stats() const;
+
+private:
+    /**
+     * Item of the queue with the time it was pushed
+     */
+    struct Entry
+    {
+        // Data of the item
+        T value;
+        // Time the item was pushed
+        std::chrono::steady_clock::time_point pushTime;
+    };
+
+    /**
+ 	* Lock m_guard. With BLOCKING_QUEUE_STATS it first tries to lock
+ 	* without blocking and only times the acquisitions which block.
+ 	*
+ 	* @return unique_lock   Lock which owns m_guard
+ 	*/
+    std::unique_lock<std::mutex> lock() const;
+    /**
+ 	* Remove the oldest item of the highest class and record its wait.
+ 	* m_guard must be held and the queue must not be empty.
+ 	*
+ 	* @param[in] now   Current time
+ 	* @return    T     Data of the removed item
+ 	*/
+    T take(std::chrono::steady_clock::time_point now);
+
+    // FIFO bucket of every priority class
+    std::vector<std::deque<Entry>> m_classes;
+    // Number of items in all the buckets
+    uint64_t m_size = 0;
+    // Wait statistics of every priority class
+    std::vector<PriorityClassStats> m_classStats;
+    // Mutex used to lock with conditional variable
+    mutable std::mutex m_guard;
+    // Conditional variable to synchronize the status of the queue.
+    // condition_variable_any is used since it can be woken up by a stop token.
+    std::condition_variable_any m_signal;
+    // Instrumentation counters. They are updated while m_guard is held.
+    mutable BlockingQueueStats m_stats;
+};
+
+#endif /* PRIORITYBLOCKINGQUEUE_H_ */
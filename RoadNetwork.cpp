@@ -0,0 +1,223 @@
+/**
+ * @file  RoadNetwork.cpp
+ *
+ * RoadNetwork class methods implementation
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include "RoadNetwork.h"
+#include "Scenario.h"
+
+RoadNetwork::RoadNetwork()
+{
+}
+
+bool RoadNetwork::Load(const std::string& path, std::string& error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	m_nodeNames.clear();
+	m_pits.clear();
+	m_dumps.clear();
+
+	// Roads are collected as (from, road) pairs, then packed into compressed rows.
+	std::vector<std::pair<uint32_t, Road>> roads;
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		const size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+		std::istringstream words(line);
+		std::string keyword;
+		if (!(words >> keyword))
+		{
+			continue;
+		}
+
+		bool valid = true;
+		if (keyword == "pit" || keyword == "dump" || keyword == "junction")
+		{
+			std::string name;
+			valid = (words >> name) && FindNode(name) == m_nodeNames.size();
+			if (valid)
+			{
+				if (keyword == "pit")
+				{
+					m_pits.push_back(m_nodeNames.size());
+				}
+				else if (keyword == "dump")
+				{
+					m_dumps.push_back(m_nodeNames.size());
+				}
+				m_nodeNames.push_back(name);
+			}
+		}
+		else if (keyword == "road" || keyword == "oneway")
+		{
+			std::string from, to, time;
+			uint64_t duration = 0;
+			valid = (words >> from >> to >> time) && Scenario::ParseDuration(time, duration) && duration < kUnreachable;
+			const uint32_t fromNode = FindNode(from);
+			const uint32_t toNode = FindNode(to);
+			valid = valid && fromNode < m_nodeNames.size() && toNode < m_nodeNames.size();
+			if (valid)
+			{
+				roads.push_back(std::make_pair(fromNode, Road{ toNode, (uint32_t)duration }));
+				if (keyword == "road")
+				{
+					roads.push_back(std::make_pair(toNode, Road{ fromNode, (uint32_t)duration }));
+				}
+			}
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			error = "invalid road network line " + std::to_string(lineNumber) + ": " + line;
+			return false;
+		}
+	}
+	if (m_pits.empty() || m_dumps.empty())
+	{
+		error = "road network needs at least one pit and one dump";
+		return false;
+	}
+
+	m_roadStart.assign(m_nodeNames.size() + 1, 0);
+	for (const std::pair<uint32_t, Road>& road : roads)
+	{
+		m_roadStart[road.first + 1]++;
+	}
+	for (size_t i = 1; i < m_roadStart.size(); ++i)
+	{
+		m_roadStart[i] += m_roadStart[i - 1];
+	}
+	m_roads.resize(roads.size());
+	std::vector<uint32_t> next(m_roadStart.begin(), m_roadStart.end() - 1);
+	for (const std::pair<uint32_t, Road>& road : roads)
+	{
+		m_roads[next[road.first]++] = road.second;
+	}
+
+	ComputeTravelTimes();
+	for (uint32_t pit : m_pits)
+	{
+		for (uint32_t dump : m_dumps)
+		{
+			if (GetTravelTime(pit, dump) == kUnreachable || GetTravelTime(dump, pit) == kUnreachable)
+			{
+				error = "no road between " + m_nodeNames[pit] + " and " + m_nodeNames[dump];
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void RoadNetwork::ComputeTravelTimes()
+{
+	const uint32_t nodeCount = m_nodeNames.size();
+	m_travelTimes.assign((size_t)nodeCount * nodeCount, kUnreachable);
+
+	// Sources are handed out one at a time, so uneven searches balance over the threads.
+	std::atomic<uint32_t> nextSource(0);
+	const uint32_t threadCount = std::max(1u, std::min(nodeCount, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([this, &nextSource, nodeCount]() {
+			for (uint32_t source = nextSource++; source < nodeCount; source = nextSource++)
+			{
+				RunDijkstra(source);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void RoadNetwork::RunDijkstra(uint32_t source)
+{
+	// Each search writes only its own row of the matrix.
+	uint32_t* row = &m_travelTimes[(size_t)source * m_nodeNames.size()];
+	typedef std::pair<uint32_t, uint32_t> Entry;
+	std::vector<Entry> heap;
+	row[source] = 0;
+	heap.push_back(Entry(0, source));
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+		const Entry entry = heap.back();
+		heap.pop_back();
+		if (entry.first > row[entry.second])
+		{
+			continue;
+		}
+		for (uint32_t i = m_roadStart[entry.second]; i < m_roadStart[entry.second + 1]; ++i)
+		{
+			const Road& road = m_roads[i];
+			const uint64_t time = (uint64_t)entry.first + road.time;
+			if (time < row[road.to])
+			{
+				row[road.to] = time;
+				heap.push_back(Entry(time, road.to));
+				std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+			}
+		}
+	}
+}
+
+uint32_t RoadNetwork::GetNodeCount() const
+{
+	return m_nodeNames.size();
+}
+
+uint32_t RoadNetwork::GetPitCount() const
+{
+	return m_pits.size();
+}
+
+uint32_t RoadNetwork::GetDumpCount() const
+{
+	return m_dumps.size();
+}
+
+uint32_t RoadNetwork::GetTruckPit(uint32_t truckIndex) const
+{
+	return m_pits[truckIndex % m_pits.size()];
+}
+
+uint32_t RoadNetwork::GetStationDump(uint32_t stationIndex) const
+{
+	return m_dumps[stationIndex % m_dumps.size()];
+}
+
+const std::string& RoadNetwork::GetNodeName(uint32_t node) const
+{
+	return m_nodeNames[node];
+}
+
+uint32_t RoadNetwork::FindNode(const std::string& name) const
+{
+	return std::find(m_nodeNames.begin(), m_nodeNames.end(), name) - m_nodeNames.begin();
+}
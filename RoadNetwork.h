@@ -0,0 +1,150 @@
+/**
+ * @file  RoadNetwork.h
+ *
+ * This file contains RoadNetwork class. It holds a graph of pits,
+ * dumps and junctions connected by roads with travel times, and an
+ * all-pairs travel time matrix computed from it. The network is read
+ * from a text file, e.g.
+ *        pit north
+ *        pit south
+ *        dump crusher
+ *        junction gate
+ *        road north gate 12m
+ *        road south gate 20m
+ *        road gate crusher 8m
+ *        oneway crusher north 15m
+ * "road" is travelled both ways, "oneway" only from the first node.
+ * Trucks are spread round robin over the pits and stations over the dumps.
+ */
+
+#ifndef ROADNETWORK_H_
+#define ROADNETWORK_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * RoadNetwork class
+ */
+class RoadNetwork
+{
+public:
+	// Travel time of node pairs without a path
+	static constexpr uint32_t kUnreachable = UINT32_MAX;
+	/**
+	 * Constructor. Creates an empty network.
+	 */
+	RoadNetwork();
+	/**
+	 * Read the network from a text file and compute its travel time
+	 * matrix. Every dump must be reachable from every pit and back.
+	 *
+	 * @param[in]  path     File path
+	 * @param[out] error    Description of the problem if loading fails
+	 *
+	 * @return     bool     True if the network is loaded.
+	 */
+	bool Load(const std::string& path, std::string& error);
+	/**
+	 * Compute the shortest travel time between every pair of nodes.
+	 * One Dijkstra search runs per source node, spread over threads.
+	 */
+	void ComputeTravelTimes();
+	/**
+	 * Get the number of nodes
+	 *
+	 * @return   Unsigned Integer  Number of nodes
+	 */
+	uint32_t GetNodeCount() const;
+	/**
+	 * Get the number of pits
+	 *
+	 * @return   Unsigned Integer  Number of pits
+	 */
+	uint32_t GetPitCount() const;
+	/**
+	 * Get the number of dumps
+	 *
+	 * @return   Unsigned Integer  Number of dumps
+	 */
+	uint32_t GetDumpCount() const;
+	/**
+	 * Get the pit a truck loads at
+	 *
+	 * @param[in] truckIndex   Zero based index of the truck
+	 *
+	 * @return    Unsigned Integer  Node index of the pit
+	 */
+	uint32_t GetTruckPit(uint32_t truckIndex) const;
+	/**
+	 * Get the dump a station stands at
+	 *
+	 * @param[in] stationIndex   Zero based index of the station
+	 *
+	 * @return    Unsigned Integer  Node index of the dump
+	 */
+	uint32_t GetStationDump(uint32_t stationIndex) const;
+	/**
+	 * Get the shortest travel time between two nodes
+	 *
+	 * @param[in] from   Node index of the start
+	 * @param[in] to     Node index of the destination
+	 *
+	 * @return    Unsigned Integer  Time in milliseconds, kUnreachable without a path
+	 */
+	uint32_t GetTravelTime(uint32_t from, uint32_t to) const
+	{
+		return m_travelTimes[(size_t)from * m_nodeNames.size() + to];
+	}
+	/**
+	 * Get the name of a node
+	 *
+	 * @param[in] node   Node index
+	 *
+	 * @return    Node name
+	 */
+	const std::string& GetNodeName(uint32_t node) const;
+
+private:
+	/**
+	 * Road leaving a node
+	 */
+	struct Road
+	{
+		// Node index of the other end
+		uint32_t to;
+		// Travel time in milliseconds
+		uint32_t time;
+	};
+
+	/**
+	 * Get the index of a node by name
+	 *
+	 * @param[in] name   Node name
+	 *
+	 * @return    Unsigned Integer  Node index, or the node count if there is no such node
+	 */
+	uint32_t FindNode(const std::string& name) const;
+	/**
+	 * Compute the travel times from one node to all the others
+	 *
+	 * @param[in] source   Node index of the start
+	 */
+	void RunDijkstra(uint32_t source);
+
+	// Node names by index
+	std::vector<std::string> m_nodeNames;
+	// Node indexes of the pits
+	std::vector<uint32_t> m_pits;
+	// Node indexes of the dumps
+	std::vector<uint32_t> m_dumps;
+	// Roads leaving every node, as compressed rows: roads of node n are
+	// m_roads[m_roadStart[n]] up to m_roads[m_roadStart[n + 1]]
+	std::vector<uint32_t> m_roadStart;
+	std::vector<Road> m_roads;
+	// Row-major matrix of the shortest travel times in milliseconds
+	std::vector<uint32_t> m_travelTimes;
+};
+
+#endif /* ROADNETWORK_H_ */
@@ -0,0 +1,611 @@
+/**
+ * @file  Scenario.cpp
+ *
+ * Scenario class methods implementation
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Scenario.h"
+#include "Constants.h"
+
+// Milliseconds per minute
+static const uint64_t kMilliSecondsPerMinute = (uint64_t)kSecondsPerMinute * kMilliSecondsPerSecond;
+// Milliseconds per hour
+static const uint64_t kMilliSecondsPerHour = kMinutePerHour * kMilliSecondsPerMinute;
+
+/**
+ * Station record of a version 1 binary scenario
+ */
+struct ScenarioStationV1
+{
+	// Station Id
+	uint32_t stationId;
+	// Index of the unloading time distribution
+	uint32_t unloadingDistribution;
+};
+
+/**
+ * Truck record of a version 1 binary scenario
+ */
+struct ScenarioTruckV1
+{
+	// Truck Id
+	uint32_t truckId;
+	// Index of the travel time distribution
+	uint32_t travelDistribution;
+	// Index of the loading time distribution
+	uint32_t loadingDistribution;
+	// Reserved, must be 0
+	uint32_t reserved;
+};
+
+/**
+ * Round the offset up to the alignment of the record arrays
+ *
+ * @param[in] offset  Offset in bytes
+ *
+ * @return    Unsigned Integer  Offset aligned to 8 bytes
+ */
+static size_t AlignOffset(size_t offset)
+{
+	return (offset + 7) & ~(size_t)7;
+}
+
+bool Scenario::ParseDuration(const std::string& text, uint64_t& duration)
+{
+	char* end = NULL;
+	double value = strtod(text.c_str(), &end);
+	if (end == text.c_str() || value < 0)
+	{
+		return false;
+	}
+	const std::string unit = end;
+	double scale;
+	if (unit == "ms")
+	{
+		scale = 1;
+	}
+	else if (unit == "s")
+	{
+		scale = kMilliSecondsPerSecond;
+	}
+	else if (unit == "m" || unit.empty())
+	{
+		scale = kMilliSecondsPerMinute;
+	}
+	else if (unit == "h")
+	{
+		scale = kMilliSecondsPerHour;
+	}
+	else
+	{
+		return false;
+	}
+	duration = (uint64_t)(value * scale + 0.5);
+	return true;
+}
+
+Scenario::Scenario()
+{
+	m_mapping = NULL;
+	m_mappingSize = 0;
+	Clear();
+}
+
+Scenario::~Scenario()
+{
+	Clear();
+}
+
+void Scenario::Clear()
+{
+	if (m_mapping)
+	{
+		munmap(m_mapping, m_mappingSize);
+		m_mapping = NULL;
+		m_mappingSize = 0;
+	}
+	memset(&m_header, 0, sizeof(m_header));
+	memcpy(m_header.magic, kScenarioMagic, sizeof(kScenarioMagic));
+	m_header.version = kScenarioVersion;
+	m_header.simulationTime = (uint64_t)kSimulationTimeInHour * kMilliSecondsPerHour;
+	m_header.factor = kFactorValue;
+	m_header.seed = 1;
+	m_ownedDistributions.clear();
+	m_ownedStations.clear();
+	m_ownedTrucks.clear();
+	m_ownedTruckClasses.clear();
+	UseOwnedRecords();
+}
+
+void Scenario::UseOwnedRecords()
+{
+	m_header.distributionCount = m_ownedDistributions.size();
+	m_header.stationCount = m_ownedStations.size();
+	m_header.truckCount = m_ownedTrucks.size();
+	m_header.truckClassCount = m_ownedTruckClasses.size();
+	m_distributions = m_ownedDistributions.data();
+	m_stations = m_ownedStations.data();
+	m_trucks = m_ownedTrucks.data();
+	m_truckClasses = m_ownedTruckClasses.data();
+}
+
+bool Scenario::CreateDefault(uint32_t trucksCount, uint32_t stationsCount, std::string& error)
+{
+	Clear();
+	const uint64_t travelTime = kTravelTimeInMinute * kMilliSecondsPerMinute;
+	const uint64_t unloadingTime = kUnloadingTimeInMinute * kMilliSecondsPerMinute;
+	m_ownedDistributions.push_back(ScenarioDistribution{ travelTime, travelTime });
+	m_ownedDistributions.push_back(ScenarioDistribution{ kMinloadingTimeInHour * kMilliSecondsPerHour,
+	                                                     kMaxloadingTimeInHour * kMilliSecondsPerHour });
+	m_ownedDistributions.push_back(ScenarioDistribution{ unloadingTime, unloadingTime });
+	m_ownedStations.reserve(stationsCount);
+	for (uint32_t i = 0; i < stationsCount; ++i)
+	{
+		m_ownedStations.push_back(ScenarioStation{ i + 1, 2, 0, 0 });
+	}
+	m_ownedTruckClasses.push_back(ScenarioTruckClass{ kDefaultTruckPayload, 0, 1, 0 });
+	m_ownedTrucks.reserve(trucksCount);
+	for (uint32_t i = 0; i < trucksCount; ++i)
+	{
+		m_ownedTrucks.push_back(ScenarioTruck{ i + 1, 0 });
+	}
+	UseOwnedRecords();
+	return Validate(error);
+}
+
+bool Scenario::Create(uint64_t simulationTime, uint64_t seed, const std::vector<ScenarioDistribution>& distributions,
+                      const std::vector<ScenarioStation>& stations, const std::vector<ScenarioTruck>& trucks,
+                      const std::vector<ScenarioTruckClass>& truckClasses, std::string& error)
+{
+	Clear();
+	if (simulationTime == 0)
+	{
+		error = "simulation time must be positive";
+		return false;
+	}
+	m_header.simulationTime = simulationTime;
+	m_header.seed = seed;
+	m_ownedDistributions = distributions;
+	m_ownedStations = stations;
+	m_ownedTrucks = trucks;
+	m_ownedTruckClasses = truckClasses;
+	UseOwnedRecords();
+	return Validate(error);
+}
+
+bool Scenario::Load(const std::string& path, std::string& error)
+{
+	Clear();
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		error = "cannot read " + path;
+		return false;
+	}
+
+	char magic[sizeof(kScenarioMagic)] = {0};
+	bool binary = (size_t)status.st_size >= sizeof(ScenarioHeader) &&
+	              pread(file, magic, sizeof(magic), 0) == (ssize_t)sizeof(magic) &&
+	              memcmp(magic, kScenarioMagic, sizeof(magic)) == 0;
+	if (binary)
+	{
+		// Read only private mapping: records are used in place and pages load on demand.
+		m_mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (m_mapping == MAP_FAILED)
+		{
+			m_mapping = NULL;
+			error = "cannot map " + path;
+			return false;
+		}
+		m_mappingSize = status.st_size;
+		return UseMappedBinary(error) && Validate(error);
+	}
+
+	std::string text(status.st_size, '\0');
+	ssize_t count = pread(file, &text[0], text.size(), 0);
+	close(file);
+	if (count != (ssize_t)text.size())
+	{
+		error = "cannot read " + path;
+		return false;
+	}
+	return ParseText(text, error) && Validate(error);
+}
+
+bool Scenario::UseMappedBinary(std::string& error)
+{
+	const char* base = static_cast<const char*>(m_mapping);
+	memcpy(&m_header, base, sizeof(m_header));
+	if (m_header.version != 1 && m_header.version != kScenarioVersion)
+	{
+		error = "unsupported scenario version " + std::to_string(m_header.version);
+		return false;
+	}
+	const bool version1 = m_header.version == 1;
+	if (version1 && m_header.truckClassCount != 0)
+	{
+		error = "reserved header field is not 0";
+		return false;
+	}
+
+	const size_t stationSize = version1 ? sizeof(ScenarioStationV1) : sizeof(ScenarioStation);
+	const size_t truckSize = version1 ? sizeof(ScenarioTruckV1) : sizeof(ScenarioTruck);
+	const size_t distributionOffset = AlignOffset(sizeof(ScenarioHeader));
+	const size_t stationOffset = AlignOffset(distributionOffset + (size_t)m_header.distributionCount * sizeof(ScenarioDistribution));
+	const size_t truckOffset = AlignOffset(stationOffset + (size_t)m_header.stationCount * stationSize);
+	const size_t truckClassOffset = AlignOffset(truckOffset + (size_t)m_header.truckCount * truckSize);
+	const size_t endOffset = truckClassOffset + (size_t)m_header.truckClassCount * sizeof(ScenarioTruckClass);
+	if (endOffset > m_mappingSize)
+	{
+		error = "scenario file is truncated";
+		return false;
+	}
+	m_distributions = reinterpret_cast<const ScenarioDistribution*>(base + distributionOffset);
+	m_trucks = reinterpret_cast<const ScenarioTruck*>(base + truckOffset);
+	m_truckClasses = reinterpret_cast<const ScenarioTruckClass*>(base + truckClassOffset);
+	if (version1)
+	{
+		// Stations and trucks are copied to the current record layout.
+		const ScenarioStationV1* stations = reinterpret_cast<const ScenarioStationV1*>(base + stationOffset);
+		m_ownedStations.reserve(m_header.stationCount);
+		for (uint32_t i = 0; i < m_header.stationCount; ++i)
+		{
+			m_ownedStations.push_back(ScenarioStation{ stations[i].stationId, stations[i].unloadingDistribution, 0, 0 });
+		}
+		// Trucks sharing their distributions get one implicit class of the default payload.
+		const ScenarioTruckV1* trucks = reinterpret_cast<const ScenarioTruckV1*>(base + truckOffset);
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> truckClassIndex;
+		m_ownedTrucks.reserve(m_header.truckCount);
+		for (uint32_t i = 0; i < m_header.truckCount; ++i)
+		{
+			if (trucks[i].reserved != 0)
+			{
+				error = "reserved truck field is not 0";
+				return false;
+			}
+			auto inserted = truckClassIndex.emplace(std::make_pair(trucks[i].travelDistribution, trucks[i].loadingDistribution),
+			                                        (uint32_t)m_ownedTruckClasses.size());
+			if (inserted.second)
+			{
+				m_ownedTruckClasses.push_back(ScenarioTruckClass{ kDefaultTruckPayload, trucks[i].travelDistribution,
+				                                                  trucks[i].loadingDistribution, 0 });
+			}
+			m_ownedTrucks.push_back(ScenarioTruck{ trucks[i].truckId, inserted.first->second });
+		}
+		m_stations = m_ownedStations.data();
+		m_trucks = m_ownedTrucks.data();
+		m_truckClasses = m_ownedTruckClasses.data();
+		m_header.truckClassCount = m_ownedTruckClasses.size();
+		m_header.version = kScenarioVersion;
+	}
+	else
+	{
+		m_stations = reinterpret_cast<const ScenarioStation*>(base + stationOffset);
+	}
+	return true;
+}
+
+bool Scenario::ParseText(const std::string& text, std::string& error)
+{
+	std::map<std::string, uint32_t> distributionIndex;
+	std::map<std::string, uint32_t> truckClassIndex;
+	std::istringstream lines(text);
+	std::string line;
+	uint32_t lineNumber = 0;
+
+	while (std::getline(lines, line))
+	{
+		lineNumber++;
+		const size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+		std::istringstream words(line);
+		std::string keyword;
+		if (!(words >> keyword))
+		{
+			continue;
+		}
+
+		bool valid = true;
+		if (keyword == "simulation_hours")
+		{
+			double hours = 0;
+			valid = (words >> hours) && hours > 0;
+			m_header.simulationTime = (uint64_t)(hours * kMilliSecondsPerHour);
+		}
+		else if (keyword == "factor")
+		{
+			valid = (words >> m_header.factor) && m_header.factor > 0;
+		}
+		else if (keyword == "seed")
+		{
+			valid = (bool)(words >> m_header.seed);
+		}
+		else if (keyword == "distribution")
+		{
+			std::string name, kind, minimum, maximum;
+			ScenarioDistribution distribution;
+			valid = (words >> name >> kind >> minimum) && ParseDuration(minimum, distribution.minimum);
+			if (valid && kind == "constant")
+			{
+				distribution.maximum = distribution.minimum;
+			}
+			else if (valid && kind == "uniform")
+			{
+				valid = (words >> maximum) && ParseDuration(maximum, distribution.maximum) &&
+				        distribution.maximum >= distribution.minimum;
+			}
+			else
+			{
+				valid = false;
+			}
+			if (valid)
+			{
+				distributionIndex[name] = m_ownedDistributions.size();
+				m_ownedDistributions.push_back(distribution);
+			}
+		}
+		else if (keyword == "truck_class")
+		{
+			std::string name, travel, loading;
+			ScenarioTruckClass truckClass = {};
+			valid = (words >> name >> truckClass.payload >> travel >> loading) && truckClass.payload > 0 &&
+			        distributionIndex.count(travel) && distributionIndex.count(loading) && !truckClassIndex.count(name);
+			if (valid)
+			{
+				truckClass.travelDistribution = distributionIndex[travel];
+				truckClass.loadingDistribution = distributionIndex[loading];
+				truckClassIndex[name] = m_ownedTruckClasses.size();
+				m_ownedTruckClasses.push_back(truckClass);
+			}
+		}
+		else if (keyword == "stations")
+		{
+			uint32_t count = 0;
+			uint32_t capacity = 0;
+			std::string unloading;
+			valid = (words >> count >> unloading) && distributionIndex.count(unloading);
+			if (valid && !(words >> capacity))
+			{
+				valid = words.eof();
+				capacity = 0;
+			}
+			for (uint32_t i = 0; valid && i < count; ++i)
+			{
+				m_ownedStations.push_back(ScenarioStation{ (uint32_t)m_ownedStations.size() + 1, distributionIndex[unloading],
+				                                           capacity, 0 });
+			}
+		}
+		else if (keyword == "trucks")
+		{
+			uint32_t count = 0;
+			std::string first, loading;
+			valid = (bool)(words >> count >> first);
+			if (valid && (words >> loading))
+			{
+				// Trucks given by their distributions share an implicit class of the default payload.
+				valid = distributionIndex.count(first) && distributionIndex.count(loading);
+				const std::string implicitName = "\n" + first + "\n" + loading;
+				if (valid && !truckClassIndex.count(implicitName))
+				{
+					truckClassIndex[implicitName] = m_ownedTruckClasses.size();
+					m_ownedTruckClasses.push_back(ScenarioTruckClass{ kDefaultTruckPayload, distributionIndex[first],
+					                                                  distributionIndex[loading], 0 });
+				}
+				first = implicitName;
+			}
+			else
+			{
+				valid = valid && truckClassIndex.count(first);
+			}
+			for (uint32_t i = 0; valid && i < count; ++i)
+			{
+				m_ownedTrucks.push_back(ScenarioTruck{ (uint32_t)m_ownedTrucks.size() + 1, truckClassIndex[first] });
+			}
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			error = "invalid scenario line " + std::to_string(lineNumber) + ": " + line;
+			return false;
+		}
+	}
+	UseOwnedRecords();
+	return true;
+}
+
+bool Scenario::Validate(std::string& error) const
+{
+	if (m_header.stationCount == 0 || m_header.truckCount == 0)
+	{
+		error = "scenario needs at least one station and one truck";
+		return false;
+	}
+	if (m_header.factor == 0)
+	{
+		error = "scenario factor must be positive";
+		return false;
+	}
+	for (uint32_t i = 0; i < m_header.distributionCount; ++i)
+	{
+		if (m_distributions[i].maximum < m_distributions[i].minimum)
+		{
+			error = "distribution " + std::to_string(i) + " has maximum below minimum";
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < m_header.stationCount; ++i)
+	{
+		if (m_stations[i].unloadingDistribution >= m_header.distributionCount)
+		{
+			error = "station " + std::to_string(i + 1) + " refers to an unknown distribution";
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < m_header.truckClassCount; ++i)
+	{
+		if (m_truckClasses[i].payload == 0 ||
+		    m_truckClasses[i].travelDistribution >= m_header.distributionCount ||
+		    m_truckClasses[i].loadingDistribution >= m_header.distributionCount)
+		{
+			error = "truck class " + std::to_string(i) + " has no payload or refers to an unknown distribution";
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < m_header.truckCount; ++i)
+	{
+		if (m_trucks[i].truckClass >= m_header.truckClassCount)
+		{
+			error = "truck " + std::to_string(i + 1) + " refers to an unknown truck class";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Scenario::WriteBinary(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		return false;
+	}
+	static const char kPadding[8] = {0};
+	const size_t distributionBytes = (size_t)m_header.distributionCount * sizeof(ScenarioDistribution);
+	const size_t stationBytes = (size_t)m_header.stationCount * sizeof(ScenarioStation);
+	const size_t truckBytes = (size_t)m_header.truckCount * sizeof(ScenarioTruck);
+	const size_t truckClassBytes = (size_t)m_header.truckClassCount * sizeof(ScenarioTruckClass);
+	size_t offset = sizeof(ScenarioHeader);
+
+	bool written = fwrite(&m_header, sizeof(m_header), 1, file) == 1;
+	written = written && fwrite(kPadding, 1, AlignOffset(offset) - offset, file) == AlignOffset(offset) - offset;
+	offset = AlignOffset(offset) + distributionBytes;
+	written = written && fwrite(m_distributions, 1, distributionBytes, file) == distributionBytes;
+	written = written && fwrite(kPadding, 1, AlignOffset(offset) - offset, file) == AlignOffset(offset) - offset;
+	offset = AlignOffset(offset) + stationBytes;
+	written = written && fwrite(m_stations, 1, stationBytes, file) == stationBytes;
+	written = written && fwrite(kPadding, 1, AlignOffset(offset) - offset, file) == AlignOffset(offset) - offset;
+	offset = AlignOffset(offset) + truckBytes;
+	written = written && fwrite(m_trucks, 1, truckBytes, file) == truckBytes;
+	written = written && fwrite(kPadding, 1, AlignOffset(offset) - offset, file) == AlignOffset(offset) - offset;
+	written = written && fwrite(m_truckClasses, 1, truckClassBytes, file) == truckClassBytes;
+	return fclose(file) == 0 && written;
+}
+
+/**
+ * Add bytes to a 64-bit FNV-1a hash
+ *
+ * @param[in] hash    Current hash value
+ * @param[in] data    Bytes to add
+ * @param[in] size    Number of bytes
+ *
+ * @return    Unsigned Integer  New hash value
+ */
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+uint64_t Scenario::GetFingerprint() const
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = HashBytes(hash, &m_header, sizeof(m_header));
+	hash = HashBytes(hash, m_distributions, (size_t)m_header.distributionCount * sizeof(ScenarioDistribution));
+	hash = HashBytes(hash, m_stations, (size_t)m_header.stationCount * sizeof(ScenarioStation));
+	hash = HashBytes(hash, m_trucks, (size_t)m_header.truckCount * sizeof(ScenarioTruck));
+	hash = HashBytes(hash, m_truckClasses, (size_t)m_header.truckClassCount * sizeof(ScenarioTruckClass));
+	return hash;
+}
+
+uint64_t Scenario::GetSimulationTime() const
+{
+	return m_header.simulationTime;
+}
+
+void Scenario::SetSimulationTime(uint64_t simulationTime)
+{
+	m_header.simulationTime = simulationTime;
+}
+
+uint32_t Scenario::GetFactor() const
+{
+	return m_header.factor;
+}
+
+uint64_t Scenario::GetSeed() const
+{
+	return m_header.seed;
+}
+
+uint32_t Scenario::GetDistributionCount() const
+{
+	return m_header.distributionCount;
+}
+
+const ScenarioDistribution& Scenario::GetDistribution(uint32_t index) const
+{
+	return m_distributions[index];
+}
+
+uint32_t Scenario::GetStationCount() const
+{
+	return m_header.stationCount;
+}
+
+const ScenarioStation& Scenario::GetStation(uint32_t index) const
+{
+	return m_stations[index];
+}
+
+uint32_t Scenario::GetTruckCount() const
+{
+	return m_header.truckCount;
+}
+
+const ScenarioTruck& Scenario::GetTruck(uint32_t index) const
+{
+	return m_trucks[index];
+}
+
+uint32_t Scenario::GetTruckClassCount() const
+{
+	return m_header.truckClassCount;
+}
+
+const ScenarioTruckClass& Scenario::GetTruckClass(uint32_t index) const
+{
+	return m_truckClasses[index];
+}
+
+uint32_t Scenario::GetTruckPayload(uint32_t index) const
+{
+	return m_truckClasses[m_trucks[index].truckClass].payload;
+}
@@ -0,0 +1,350 @@
+/**
+ * @file  Scenario.h
+ *
+ * This file contains Scenario class and its record structures.
+ *
+ * A scenario defines the timing distributions, the stations and the
+ * trucks of a run. It is read from either
+ *  - a text file for small cases, e.g.
+ *        simulation_hours 72
+ *        factor 100
+ *        seed 7
+ *        distribution travel constant 30m
+ *        distribution load uniform 1h 5h
+ *        distribution unload constant 5m
+ *        distribution load300 uniform 2h 6h
+ *        truck_class hauler300 300 travel load300
+ *        stations 3 unload 4
+ *        trucks 100 travel load
+ *        trucks 20 hauler300
+ *    A station line may end with its capacity in trucks. Trucks given by
+ *    their distributions are in an implicit class of kDefaultTruckPayload.
+ *  - or a binary file, which is memory mapped and used in place, so
+ *    a fleet of a million trucks is loaded without parsing or copying.
+ *    Layout: ScenarioHeader, then the distribution, station, truck and
+ *    truck class record arrays, each starting at an 8 byte aligned offset.
+ *    Version 1 files have smaller station records and trucks given by
+ *    their distributions instead of a class. Both are copied on load,
+ *    and trucks sharing distributions get an implicit class as in text.
+ *
+ * Every truck is in a class, which gives its distributions and payload.
+ */
+
+#ifndef SCENARIO_H_
+#define SCENARIO_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Magic value at the start of a binary scenario file
+static const char kScenarioMagic[8] = { 'M', 'I', 'N', 'E', 'S', 'C', 'N', '1' };
+// Version of the binary scenario layout
+static const uint32_t kScenarioVersion = 2;
+
+/**
+ * Header of a binary scenario file
+ */
+struct ScenarioHeader
+{
+	// kScenarioMagic
+	char magic[8];
+	// kScenarioVersion
+	uint32_t version;
+	// Number of ScenarioDistribution records
+	uint32_t distributionCount;
+	// Number of ScenarioStation records
+	uint32_t stationCount;
+	// Number of ScenarioTruck records
+	uint32_t truckCount;
+	// Simulated time to run in milliseconds
+	uint64_t simulationTime;
+	// Speed up factor of the threaded simulation
+	uint32_t factor;
+	// Number of ScenarioTruckClass records. 0 in version 1 files.
+	uint32_t truckClassCount;
+	// Seed of the random number generator
+	uint64_t seed;
+};
+
+/**
+ * Uniform timing distribution in milliseconds. It is constant
+ * when minimum and maximum are equal.
+ */
+struct ScenarioDistribution
+{
+	// Minimum time in milliseconds
+	uint64_t minimum;
+	// Maximum time in milliseconds
+	uint64_t maximum;
+};
+
+/**
+ * Station record of a scenario
+ */
+struct ScenarioStation
+{
+	// Station Id
+	uint32_t stationId;
+	// Index of the unloading time distribution
+	uint32_t unloadingDistribution;
+	// Trucks the station holds in its queue and unloading bay. 0 is unbounded.
+	uint32_t capacity;
+	// Reserved, must be 0
+	uint32_t reserved;
+};
+
+/**
+ * Truck record of a scenario
+ */
+struct ScenarioTruck
+{
+	// Truck Id
+	uint32_t truckId;
+	// Index of the truck class
+	uint32_t truckClass;
+};
+
+/**
+ * Truck class record of a scenario, e.g. the 300 t haulers of a mixed
+ * fleet. Trucks of a class use its distributions.
+ */
+struct ScenarioTruckClass
+{
+	// Payload in tonnes
+	uint32_t payload;
+	// Index of the travel time distribution
+	uint32_t travelDistribution;
+	// Index of the loading time distribution
+	uint32_t loadingDistribution;
+	// Reserved, must be 0
+	uint32_t reserved;
+};
+
+/**
+ * Scenario class
+ */
+class Scenario
+{
+public:
+	/**
+	 * Parse a duration like "500ms", "30s", "5m" or "2h"
+	 *
+	 * @param[in]  text       Duration text. A number without unit is in minutes.
+	 * @param[out] duration   Duration in milliseconds
+	 *
+	 * @return     bool       True if the text is a valid duration.
+	 */
+	static bool ParseDuration(const std::string& text, uint64_t& duration);
+	/**
+	 * Constructor. Creates an empty scenario.
+	 */
+	Scenario();
+	/**
+	 * Destructor. Unmaps the binary file if it is mapped.
+	 */
+	~Scenario();
+	Scenario(const Scenario&) = delete;
+	Scenario& operator=(const Scenario&) = delete;
+	/**
+	 * Build the scenario of Constants.h: one travel, loading and
+	 * unloading distribution shared by every truck and station.
+	 *
+	 * @param[in]  trucksCount     Number of trucks
+	 * @param[in]  stationsCount   Number of unloading stations
+	 * @param[out] error           Description of the problem if the counts are invalid
+	 *
+	 * @return     bool    True if the scenario is built and valid.
+	 */
+	bool CreateDefault(uint32_t trucksCount, uint32_t stationsCount, std::string& error);
+	/**
+	 * Build a scenario from records, e.g. one made by a caller of the library
+	 *
+	 * @param[in]  simulationTime   Simulated time to run in milliseconds
+	 * @param[in]  seed             Seed of the random number generator
+	 * @param[in]  distributions    Timing distributions
+	 * @param[in]  stations         Station records
+	 * @param[in]  trucks           Truck records
+	 * @param[in]  truckClasses     Truck class records
+	 * @param[out] error            Description of the problem if the records are invalid
+	 *
+	 * @return     bool    True if the scenario is built and valid.
+	 */
+	bool Create(uint64_t simulationTime, uint64_t seed, const std::vector<ScenarioDistribution>& distributions,
+	            const std::vector<ScenarioStation>& stations, const std::vector<ScenarioTruck>& trucks,
+	            const std::vector<ScenarioTruckClass>& truckClasses, std::string& error);
+	/**
+	 * Load a scenario file. Binary files are recognized by kScenarioMagic
+	 * and mapped in place; any other file is parsed as text.
+	 *
+	 * @param[in]  path    Path of the scenario file
+	 * @param[out] error   Description of the problem if loading fails
+	 *
+	 * @return     bool    True if the scenario is loaded and valid.
+	 */
+	bool Load(const std::string& path, std::string& error);
+	/**
+	 * Write the scenario in the binary format
+	 *
+	 * @param[in] path   Output file path
+	 *
+	 * @return    bool   True if the file is written.
+	 */
+	bool WriteBinary(const std::string& path) const;
+	/**
+	 * Get a 64-bit FNV-1a hash of the whole scenario. It is used to
+	 * check that a checkpoint belongs to this scenario.
+	 *
+	 * @return   Unsigned Integer  Fingerprint
+	 */
+	uint64_t GetFingerprint() const;
+	/**
+	 * Get the simulated time to run
+	 *
+	 * @return   Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t GetSimulationTime() const;
+	/**
+	 * Set the simulated time to run, e.g. the horizon of a forecast
+	 *
+	 * @param[in] simulationTime   Time in milliseconds
+	 */
+	void SetSimulationTime(uint64_t simulationTime);
+	/**
+	 * Get the speed up factor of the threaded simulation
+	 *
+	 * @return   Unsigned Integer  Factor value
+	 */
+	uint32_t GetFactor() const;
+	/**
+	 * Get the seed of the random number generator
+	 *
+	 * @return   Unsigned Integer  Seed
+	 */
+	uint64_t GetSeed() const;
+	/**
+	 * Get the number of distributions
+	 *
+	 * @return   Unsigned Integer  Number of distributions
+	 */
+	uint32_t GetDistributionCount() const;
+	/**
+	 * Get a distribution
+	 *
+	 * @param[in] index   Zero based index
+	 *
+	 * @return    Distribution record
+	 */
+	const ScenarioDistribution& GetDistribution(uint32_t index) const;
+	/**
+	 * Get the number of stations
+	 *
+	 * @return   Unsigned Integer  Number of stations
+	 */
+	uint32_t GetStationCount() const;
+	/**
+	 * Get a station
+	 *
+	 * @param[in] index   Zero based index
+	 *
+	 * @return    Station record
+	 */
+	const ScenarioStation& GetStation(uint32_t index) const;
+	/**
+	 * Get the number of trucks
+	 *
+	 * @return   Unsigned Integer  Number of trucks
+	 */
+	uint32_t GetTruckCount() const;
+	/**
+	 * Get a truck
+	 *
+	 * @param[in] index   Zero based index
+	 *
+	 * @return    Truck record
+	 */
+	const ScenarioTruck& GetTruck(uint32_t index) const;
+	/**
+	 * Get the number of truck classes
+	 *
+	 * @return   Unsigned Integer  Number of truck classes
+	 */
+	uint32_t GetTruckClassCount() const;
+	/**
+	 * Get a truck class
+	 *
+	 * @param[in] index   Zero based index
+	 *
+	 * @return    Truck class record
+	 */
+	const ScenarioTruckClass& GetTruckClass(uint32_t index) const;
+	/**
+	 * Get the payload of a truck
+	 *
+	 * @param[in] index   Zero based index of the truck
+	 *
+	 * @return    Unsigned Integer  Payload in tonnes
+	 */
+	uint32_t GetTruckPayload(uint32_t index) const;
+
+private:
+	/**
+	 * Parse the text format into the owned record arrays
+	 *
+	 * @param[in]  text    Content of the file
+	 * @param[out] error   Description of the problem if parsing fails
+	 *
+	 * @return     bool    True if the text is parsed.
+	 */
+	bool ParseText(const std::string& text, std::string& error);
+	/**
+	 * Use the mapped binary file in place
+	 *
+	 * @param[out] error   Description of the problem if the file is malformed
+	 *
+	 * @return     bool    True if the layout is valid.
+	 */
+	bool UseMappedBinary(std::string& error);
+	/**
+	 * Check that counts are positive and every distribution and truck class index is valid
+	 *
+	 * @param[out] error   Description of the problem
+	 *
+	 * @return     bool    True if the scenario is valid.
+	 */
+	bool Validate(std::string& error) const;
+	/**
+	 * Point the record arrays to the owned vectors
+	 */
+	void UseOwnedRecords();
+	/**
+	 * Unmap the binary file and clear the owned records
+	 */
+	void Clear();
+
+	// Header values of the scenario
+	ScenarioHeader m_header;
+	// Distribution records. They point into the mapping or m_ownedDistributions.
+	const ScenarioDistribution* m_distributions;
+	// Station records. They point into the mapping or m_ownedStations.
+	const ScenarioStation* m_stations;
+	// Truck records. They point into the mapping or m_ownedTrucks.
+	const ScenarioTruck* m_trucks;
+	// Truck class records. They point into the mapping or m_ownedTruckClasses.
+	const ScenarioTruckClass* m_truckClasses;
+	// Distribution records of a text or default scenario
+	std::vector<ScenarioDistribution> m_ownedDistributions;
+	// Station records of a text, default or version 1 binary scenario
+	std::vector<ScenarioStation> m_ownedStations;
+	// Truck records of a text, default or version 1 binary scenario
+	std::vector<ScenarioTruck> m_ownedTrucks;
+	// Truck class records of a text, default or version 1 binary scenario
+	std::vector<ScenarioTruckClass> m_ownedTruckClasses;
+	// Mapped binary file. NULL if not mapped.
+	void* m_mapping;
+	// Size of the mapped binary file
+	size_t m_mappingSize;
+};
+
+#endif /* SCENARIO_H_ */
@@ -0,0 +1,111 @@
+/**
+ * @file  ScenarioComparison.cpp
+ *
+ * ScenarioComparison class methods implementation
+ */
+
+#include <vector>
+#include "ScenarioComparison.h"
+#include "EventSimulation.h"
+
+/**
+ * Build the estimate from the observed differences
+ *
+ * @param[in] differences   Independent observations of the difference
+ *
+ * @return    Estimate of the difference
+ */
+static ComparisonEstimate Estimate(const std::vector<double>& differences)
+{
+	ComparisonEstimate estimate;
+	estimate.observations = differences.size();
+	estimate.meanDifference = 0;
+	estimate.estimatorVariance = 0;
+	if (differences.empty())
+	{
+		return estimate;
+	}
+	for (double difference : differences)
+	{
+		estimate.meanDifference += difference;
+	}
+	estimate.meanDifference /= differences.size();
+	if (differences.size() > 1)
+	{
+		double sumOfSquares = 0;
+		for (double difference : differences)
+		{
+			sumOfSquares += (difference - estimate.meanDifference) * (difference - estimate.meanDifference);
+		}
+		estimate.estimatorVariance = sumOfSquares / (differences.size() - 1) / differences.size();
+	}
+	return estimate;
+}
+
+ScenarioComparison::ScenarioComparison(const Scenario& scenario, const BranchVariant& variant, uint32_t replications)
+	: m_scenario(scenario),
+	  m_variant(variant)
+{
+	m_replications = replications;
+}
+
+ComparisonEstimate ScenarioComparison::RunIndependent() const
+{
+	// Seeds of the variant runs never overlap with the seeds of the base runs.
+	std::vector<double> differences;
+	for (uint32_t i = 0; i < m_replications; ++i)
+	{
+		const uint64_t seed = m_scenario.GetSeed() + i;
+		differences.push_back(RunSystem(seed + m_replications, true, true, false) - RunSystem(seed, false, true, false));
+	}
+	return Estimate(differences);
+}
+
+ComparisonEstimate ScenarioComparison::RunCommonRandomNumbers() const
+{
+	std::vector<double> differences;
+	for (uint32_t i = 0; i < m_replications; ++i)
+	{
+		const uint64_t seed = m_scenario.GetSeed() + i;
+		differences.push_back(RunSystem(seed, true, true, false) - RunSystem(seed, false, true, false));
+	}
+	return Estimate(differences);
+}
+
+ComparisonEstimate ScenarioComparison::RunAntitheticPairs() const
+{
+	std::vector<double> differences;
+	for (uint32_t i = 0; i + 1 < m_replications; i += 2)
+	{
+		const uint64_t seed = m_scenario.GetSeed() + i;
+		const double difference = RunSystem(seed, true, true, false) - RunSystem(seed, false, true, false);
+		const double antitheticDifference = RunSystem(seed, true, true, true) - RunSystem(seed, false, true, true);
+		differences.push_back((difference + antitheticDifference) / 2);
+	}
+	return Estimate(differences);
+}
+
+double ScenarioComparison::RunSystem(uint64_t seed, bool withVariant, bool commonRandomNumbers, bool antithetic) const
+{
+	EventSimulationConfig config;
+	config.scenario = &m_scenario;
+	config.seed = seed;
+	config.commonRandomNumbers = commonRandomNumbers;
+	config.antithetic = antithetic;
+	EventSimulation simulation(config);
+	if (withVariant)
+	{
+		simulation.AddStations(m_variant.addedStations);
+		simulation.AddTrucks(m_variant.addedTrucks);
+	}
+	simulation.Run();
+
+	uint64_t unloadCount = 0;
+	uint64_t totalQueueWaitTime = 0;
+	for (uint32_t i = 0; i < simulation.GetTruckCount(); ++i)
+	{
+		unloadCount += simulation.GetTruck(i).unloadCount;
+		totalQueueWaitTime += simulation.GetTruck(i).totalQueueWaitTime;
+	}
+	return unloadCount ? totalQueueWaitTime / 60000.0 / unloadCount : 0;
+}
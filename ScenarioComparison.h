@@ -0,0 +1,88 @@
+/**
+ * @file  ScenarioComparison.h
+ *
+ * This file contains ScenarioComparison class. It estimates how much a
+ * what-if variant changes the mean queue waiting time of a scenario
+ * over a number of replications, with independent streams, common
+ * random numbers and antithetic common random number pairs, and
+ * reports the variance reduction of each method.
+ */
+
+#ifndef SCENARIOCOMPARISON_H_
+#define SCENARIOCOMPARISON_H_
+
+#include <cstdint>
+#include "Scenario.h"
+#include "WhatIfBranching.h"
+
+/**
+ * Estimate of the difference between the variant and the scenario
+ */
+struct ComparisonEstimate
+{
+	// Number of independent observations of the difference
+	uint32_t observations;
+	// Mean difference of the mean queue waiting time in minutes
+	double meanDifference;
+	// Variance of the mean difference estimator
+	double estimatorVariance;
+};
+
+/**
+ * ScenarioComparison class
+ */
+class ScenarioComparison
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] scenario      Scenario to compare with. It must outlive the object.
+	 * @param[in] variant       Change applied at the start of the run
+	 * @param[in] replications  Number of runs of each system per method
+	 */
+	ScenarioComparison(const Scenario& scenario, const BranchVariant& variant, uint32_t replications);
+	/**
+	 * Compare with independent random streams for both systems
+	 *
+	 * @return    Estimate of the difference
+	 */
+	ComparisonEstimate RunIndependent() const;
+	/**
+	 * Compare with common random numbers: both systems of a
+	 * replication use the same seed, so draw i of truck k is the same.
+	 *
+	 * @return    Estimate of the difference
+	 */
+	ComparisonEstimate RunCommonRandomNumbers() const;
+	/**
+	 * Compare with common random numbers and antithetic pairs. Each
+	 * observation averages a replication and its antithetic twin, so
+	 * it uses as many runs as two observations of the other methods.
+	 *
+	 * @return    Estimate of the difference
+	 */
+	ComparisonEstimate RunAntitheticPairs() const;
+
+private:
+	/**
+	 * Run one system and get its mean queue waiting time
+	 *
+	 * @param[in] seed                 Seed of the run
+	 * @param[in] withVariant          Apply the variant
+	 * @param[in] commonRandomNumbers  Use common random number streams
+	 * @param[in] antithetic           Mirror the common random numbers
+	 *
+	 * @return    Double  Mean queue waiting time per unloading in minutes
+	 */
+	double RunSystem(uint64_t seed, bool withVariant, bool commonRandomNumbers, bool antithetic) const;
+
+	// Scenario to compare with
+	const Scenario& m_scenario;
+	// Change applied at the start of the run
+	BranchVariant m_variant;
+	// Number of runs of each system per method
+	uint32_t m_replications;
+};
+
+#endif /* SCENARIOCOMPARISON_H_ */
@@ -0,0 +1,197 @@
+/**
+ * @file  ShardExchange.cpp
+ *
+ * ShardExchange class methods implementation
+ */
+
+#include <algorithm>
+#include <new>
+#include <sched.h>
+#include <sys/mman.h>
+#include "ShardExchange.h"
+
+/**
+ * Round a size up to a cache line
+ *
+ * @param[in] size    Size in bytes
+ *
+ * @return    Unsigned Integer  Size aligned to 64 bytes
+ */
+static size_t AlignToCacheLine(size_t size)
+{
+	return (size + 63) & ~(size_t)63;
+}
+
+ShardExchange::ShardExchange(uint32_t shardCount, uint32_t stationCount, uint32_t ringCapacity)
+{
+	m_shardCount = shardCount;
+	m_stationCount = stationCount;
+	m_ringCapacity = ringCapacity;
+	const size_t ringCount = (size_t)shardCount * shardCount;
+	const size_t controlBytes = AlignToCacheLine(sizeof(ControlBlock));
+	const size_t ringBytes = AlignToCacheLine(ringCount * sizeof(RingPositions));
+	const size_t slotBytes = AlignToCacheLine(ringCount * ringCapacity * sizeof(TruckHandOff));
+	const size_t stationBytes = AlignToCacheLine((size_t)stationCount * sizeof(ShardStationState));
+	const size_t summaryBytes = AlignToCacheLine((size_t)shardCount * sizeof(ShardSummary));
+	const size_t histogramBytes = (size_t)shardCount * EventSimulation::kQueueWaitBucketCount * sizeof(uint64_t);
+	m_mappingSize = controlBytes + ringBytes + slotBytes + stationBytes + summaryBytes + histogramBytes;
+
+	// Anonymous memory is zero filled, so every ring starts empty and every station idle.
+	m_mapping = mmap(NULL, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (m_mapping == MAP_FAILED)
+	{
+		m_mapping = NULL;
+		return;
+	}
+	char* base = static_cast<char*>(m_mapping);
+	m_control = new (base) ControlBlock();
+	base += controlBytes;
+	m_rings = reinterpret_cast<RingPositions*>(base);
+	for (size_t i = 0; i < ringCount; ++i)
+	{
+		new (&m_rings[i]) RingPositions();
+	}
+	base += ringBytes;
+	m_slots = reinterpret_cast<TruckHandOff*>(base);
+	base += slotBytes;
+	m_stationStates = reinterpret_cast<ShardStationState*>(base);
+	base += stationBytes;
+	m_summaries = reinterpret_cast<ShardSummary*>(base);
+	for (uint32_t i = 0; i < shardCount; ++i)
+	{
+		m_summaries[i].status = -1;
+	}
+	base += summaryBytes;
+	m_histograms = reinterpret_cast<uint64_t*>(base);
+}
+
+ShardExchange::~ShardExchange()
+{
+	if (m_mapping)
+	{
+		munmap(m_mapping, m_mappingSize);
+	}
+}
+
+bool ShardExchange::IsMapped() const
+{
+	return m_mapping != NULL;
+}
+
+uint32_t ShardExchange::GetShardCount() const
+{
+	return m_shardCount;
+}
+
+uint32_t ShardExchange::GetStationShard(uint32_t stationIndex) const
+{
+	return (uint32_t)((uint64_t)stationIndex * m_shardCount / m_stationCount);
+}
+
+bool ShardExchange::Send(uint32_t from, uint32_t to, const TruckHandOff& handOff)
+{
+	RingPositions& ring = m_rings[(size_t)from * m_shardCount + to];
+	const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+	while (tail - ring.head.load(std::memory_order_acquire) >= m_ringCapacity)
+	{
+		if (m_control->aborted.load(std::memory_order_relaxed))
+		{
+			return false;
+		}
+		Drain(from);
+		sched_yield();
+	}
+	m_slots[((size_t)from * m_shardCount + to) * m_ringCapacity + tail % m_ringCapacity] = handOff;
+	ring.tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+void ShardExchange::Drain(uint32_t shard)
+{
+	for (uint32_t from = 0; from < m_shardCount; ++from)
+	{
+		RingPositions& ring = m_rings[(size_t)from * m_shardCount + shard];
+		uint64_t head = ring.head.load(std::memory_order_relaxed);
+		const uint64_t tail = ring.tail.load(std::memory_order_acquire);
+		if (head == tail)
+		{
+			continue;
+		}
+		const TruckHandOff* slots = &m_slots[((size_t)from * m_shardCount + shard) * m_ringCapacity];
+		for (; head < tail; ++head)
+		{
+			m_received.push_back(slots[head % m_ringCapacity]);
+		}
+		ring.head.store(head, std::memory_order_release);
+	}
+}
+
+bool ShardExchange::Wait(uint32_t shard, bool drain)
+{
+	const uint32_t generation = m_control->generation.load(std::memory_order_acquire);
+	if (m_control->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == m_shardCount)
+	{
+		// The last shard opens the barrier. Nobody arrives again before the generation changes.
+		m_control->arrived.store(0, std::memory_order_relaxed);
+		m_control->generation.fetch_add(1, std::memory_order_release);
+	}
+	else
+	{
+		while (m_control->generation.load(std::memory_order_acquire) == generation)
+		{
+			if (m_control->aborted.load(std::memory_order_relaxed))
+			{
+				return false;
+			}
+			if (drain)
+			{
+				Drain(shard);
+			}
+			sched_yield();
+		}
+	}
+	return !m_control->aborted.load(std::memory_order_relaxed);
+}
+
+bool ShardExchange::EndWindow(uint32_t shard, std::vector<TruckHandOff>& received)
+{
+	if (!Wait(shard, true))
+	{
+		return false;
+	}
+	// Every shard is past its window, so nothing more is sent to this one until the next window.
+	Drain(shard);
+	// Sorted, the run does not depend on the order the trucks were drained in.
+	std::sort(m_received.begin(), m_received.end(), [](const TruckHandOff& left, const TruckHandOff& right) {
+		return left.arrivalTime != right.arrivalTime ? left.arrivalTime < right.arrivalTime
+		                                             : left.truckIndex < right.truckIndex;
+	});
+	received.swap(m_received);
+	m_received.clear();
+	return true;
+}
+
+bool ShardExchange::Synchronize(uint32_t shard)
+{
+	return Wait(shard, false);
+}
+
+ShardStationState* ShardExchange::GetStationStates()
+{
+	return m_stationStates;
+}
+
+ShardSummary& ShardExchange::GetSummary(uint32_t shard)
+{
+	return m_summaries[shard];
+}
+
+uint64_t* ShardExchange::GetQueueWaitHistogram(uint32_t shard)
+{
+	return &m_histograms[(size_t)shard * EventSimulation::kQueueWaitBucketCount];
+}
+
+void ShardExchange::Abort()
+{
+	m_control->aborted.store(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,247 @@
+/**
+ * @file  ShardExchange.h
+ *
+ * This file contains ShardExchange class. It is the shared memory which
+ * the processes of a sharded run use to talk to each other:
+ *  - one single producer single consumer ring of truck hand-offs for
+ *    every ordered pair of shards,
+ *  - a barrier which closes each time window,
+ *  - the published state of every station, read by the other shards
+ *    to pick a station for their trucks,
+ *  - the summary and queue wait histogram of every shard.
+ * The memory is an anonymous shared mapping made before the shards are
+ * forked, so it needs no name and disappears with the last process.
+ */
+
+#ifndef SHARDEXCHANGE_H_
+#define SHARDEXCHANGE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EventSimulation.h"
+
+/**
+ * Truck which leaves its shard for a station of another shard
+ */
+struct TruckHandOff
+{
+	// Record of the truck, travelling to its station
+	TruckRecord truck;
+	// Time the truck arrives at the station
+	uint64_t arrivalTime;
+	// Index of the truck in the scenario
+	uint32_t truckIndex;
+};
+
+/**
+ * State of a station published by its shard at the end of a time window
+ */
+struct ShardStationState
+{
+	// Time the current unloading completes
+	uint64_t busyUntil;
+	// Number of trucks in the queue
+	uint32_t queueLength;
+	// Number of trucks travelling to the station
+	uint32_t enRoute;
+	// 1 if a truck is being unloaded
+	uint32_t busy;
+	// Reserved, 0
+	uint32_t reserved;
+};
+
+/**
+ * Results of one shard
+ */
+struct ShardSummary
+{
+	// Number of processed events
+	uint64_t processedEvents;
+	// Loads of the trucks the shard holds at the end
+	uint64_t loadCount;
+	// Unloadings of the stations of the shard
+	uint64_t unloadCount;
+	// Tonnes unloaded by the stations of the shard
+	uint64_t unloadedTonnes;
+	// Queue waiting time of the trucks the shard holds at the end in milliseconds
+	uint64_t totalQueueWaitTime;
+	// Unloading time of the stations of the shard in milliseconds
+	uint64_t busyTime;
+	// Trucks handed off to other shards
+	uint64_t handOffCount;
+	// Peak resident memory of the shard process in kilobytes
+	uint64_t peakMemory;
+	// Wall clock time of the shard in seconds
+	double elapsed;
+	// Trucks the shard holds at the end
+	uint32_t truckCount;
+	// 0 once the shard finished, otherwise not finished or failed
+	int32_t status;
+};
+
+/**
+ * ShardExchange class
+ */
+class ShardExchange
+{
+public:
+	/**
+	 * Constructor. Maps the shared memory. It must be made before the
+	 * shards are forked.
+	 *
+	 * @param[in] shardCount     Number of shards
+	 * @param[in] stationCount   Number of stations of the scenario
+	 * @param[in] ringCapacity   Hand-offs each ring holds
+	 */
+	ShardExchange(uint32_t shardCount, uint32_t stationCount, uint32_t ringCapacity);
+	/**
+	 * Destructor. Unmaps the shared memory of this process.
+	 */
+	~ShardExchange();
+	ShardExchange(const ShardExchange&) = delete;
+	ShardExchange& operator=(const ShardExchange&) = delete;
+	/**
+	 * Check that the shared memory is mapped
+	 *
+	 * @return    bool   True if mapped.
+	 */
+	bool IsMapped() const;
+	/**
+	 * Get the number of shards
+	 *
+	 * @return   Unsigned Integer  Number of shards
+	 */
+	uint32_t GetShardCount() const;
+	/**
+	 * Get the shard which owns a station. Shards own contiguous blocks of stations.
+	 *
+	 * @param[in] stationIndex   Zero based index of the station
+	 *
+	 * @return    Unsigned Integer  Index of the shard
+	 */
+	uint32_t GetStationShard(uint32_t stationIndex) const;
+	/**
+	 * Send a truck to another shard. While the ring is full the inbound
+	 * rings of the sender are drained, so two shards sending to each other
+	 * never wait for each other.
+	 *
+	 * @param[in] from      Index of the sending shard
+	 * @param[in] to        Index of the receiving shard
+	 * @param[in] handOff   Truck to send
+	 *
+	 * @return    bool      False if the run is aborted.
+	 */
+	bool Send(uint32_t from, uint32_t to, const TruckHandOff& handOff);
+	/**
+	 * Close the time window of a shard: wait for every shard to close it
+	 * and take every truck sent to this shard in the window.
+	 *
+	 * @param[in]  shard      Index of the shard
+	 * @param[out] received   Trucks sent to the shard, ordered by arrival time and truck
+	 *
+	 * @return     bool       False if the run is aborted.
+	 */
+	bool EndWindow(uint32_t shard, std::vector<TruckHandOff>& received);
+	/**
+	 * Wait for every shard, e.g. until every shard published its stations
+	 *
+	 * @param[in] shard   Index of the shard
+	 *
+	 * @return    bool    False if the run is aborted.
+	 */
+	bool Synchronize(uint32_t shard);
+	/**
+	 * Get the published station states
+	 *
+	 * @return    Array with the state of every station
+	 */
+	ShardStationState* GetStationStates();
+	/**
+	 * Get the summary of a shard
+	 *
+	 * @param[in] shard   Index of the shard
+	 *
+	 * @return    Summary in the shared memory
+	 */
+	ShardSummary& GetSummary(uint32_t shard);
+	/**
+	 * Get the queue wait histogram of a shard
+	 *
+	 * @param[in] shard   Index of the shard
+	 *
+	 * @return    EventSimulation::kQueueWaitBucketCount buckets in the shared memory
+	 */
+	uint64_t* GetQueueWaitHistogram(uint32_t shard);
+	/**
+	 * Abort the run. Every shard returns from its next wait.
+	 */
+	void Abort();
+
+private:
+	/**
+	 * Control block at the start of the shared memory
+	 */
+	struct ControlBlock
+	{
+		// Shards which reached the current barrier
+		alignas(64) std::atomic<uint32_t> arrived;
+		// Number of completed barriers
+		alignas(64) std::atomic<uint32_t> generation;
+		// Set once a shard fails
+		alignas(64) std::atomic<uint32_t> aborted;
+	};
+	/**
+	 * Positions of a ring. The slots follow the rings.
+	 */
+	struct RingPositions
+	{
+		// Next slot the consumer reads
+		alignas(64) std::atomic<uint64_t> head;
+		// Next slot the producer writes
+		alignas(64) std::atomic<uint64_t> tail;
+	};
+	/**
+	 * Move the trucks of the inbound rings of a shard to m_received
+	 *
+	 * @param[in] shard   Index of the shard
+	 */
+	void Drain(uint32_t shard);
+	/**
+	 * Wait at the barrier for every shard
+	 *
+	 * @param[in] shard   Index of the shard
+	 * @param[in] drain   Drain the inbound rings while waiting
+	 *
+	 * @return    bool    False if the run is aborted.
+	 */
+	bool Wait(uint32_t shard, bool drain);
+
+	// Number of shards
+	uint32_t m_shardCount;
+	// Number of stations
+	uint32_t m_stationCount;
+	// Hand-offs each ring holds
+	uint32_t m_ringCapacity;
+	// Shared mapping. NULL if mapping failed.
+	void* m_mapping;
+	// Size of the shared mapping
+	size_t m_mappingSize;
+	// Control block in the mapping
+	ControlBlock* m_control;
+	// Ring of every ordered pair of shards, indexed by from * shards + to
+	RingPositions* m_rings;
+	// Slots of the rings, m_ringCapacity per ring
+	TruckHandOff* m_slots;
+	// Published station states
+	ShardStationState* m_stationStates;
+	// Summary of every shard
+	ShardSummary* m_summaries;
+	// Queue wait histogram of every shard
+	uint64_t* m_histograms;
+	// Trucks received by this process in the current window. It is not shared.
+	std::vector<TruckHandOff> m_received;
+};
+
+#endif /* SHARDEXCHANGE_H_ */
@@ -0,0 +1,240 @@
+/**
+ * @file  ShardedSimulation.cpp
+ *
+ * ShardedSimulation class methods implementation
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ShardedSimulation.h"
+
+// Hand-offs each shared memory ring holds. A sender waits on a full ring.
+static const uint32_t kShardRingCapacity = 4096;
+
+/**
+ * Get the shortest travel time of the trucks of a scenario, which is
+ * how far a shard may run ahead of the trucks sent to it
+ *
+ * @param[in] scenario   Scenario of the run
+ *
+ * @return    Unsigned Integer  Travel time in milliseconds
+ */
+static uint64_t GetShortestTravelTime(const Scenario& scenario)
+{
+	uint64_t shortest = UINT64_MAX;
+	for (uint32_t i = 0; i < scenario.GetTruckCount(); ++i)
+	{
+		const ScenarioTruckClass& truckClass = scenario.GetTruckClass(scenario.GetTruck(i).truckClass);
+		shortest = std::min(shortest, scenario.GetDistribution(truckClass.travelDistribution).minimum);
+	}
+	return shortest;
+}
+
+ShardedSimulation::ShardedSimulation(const Scenario& scenario, uint32_t shardCount, uint64_t memoryLimit)
+	: m_scenario(scenario),
+	  m_shardCount(std::max(1u, std::min(shardCount, scenario.GetStationCount()))),
+	  m_memoryLimit(memoryLimit),
+	  m_window(GetShortestTravelTime(scenario)),
+	  m_exchange(m_shardCount, scenario.GetStationCount(), kShardRingCapacity)
+{
+}
+
+bool ShardedSimulation::Run(std::string& error)
+{
+	if (m_window == 0)
+	{
+		error = "sharding needs a shortest travel time above 0, which is how far the shards run ahead";
+		return false;
+	}
+	if (!m_exchange.IsMapped())
+	{
+		error = "cannot map the shared memory of the shards";
+		return false;
+	}
+
+	std::vector<pid_t> shards(m_shardCount, -1);
+	for (uint32_t shard = 0; shard < m_shardCount; ++shard)
+	{
+		shards[shard] = fork();
+		if (shards[shard] == 0)
+		{
+			// Shard process. It leaves with _exit, so nothing of the parent is destroyed twice.
+			bool finished = false;
+			try
+			{
+				if (m_memoryLimit)
+				{
+					struct rlimit limit = { (rlim_t)m_memoryLimit, (rlim_t)m_memoryLimit };
+					setrlimit(RLIMIT_AS, &limit);
+				}
+				finished = RunShard(shard);
+			}
+			catch (...)
+			{
+				finished = false;
+			}
+			if (!finished)
+			{
+				m_exchange.Abort();
+			}
+			_exit(finished ? 0 : 1);
+		}
+		if (shards[shard] < 0)
+		{
+			m_exchange.Abort();
+			error = "cannot fork shard " + std::to_string(shard);
+			break;
+		}
+	}
+
+	// A shard which dies, e.g. at its memory limit, aborts the others instead of leaving them at a barrier.
+	bool finished = error.empty();
+	for (uint32_t waited = 0; waited < m_shardCount; ++waited)
+	{
+		int status = 0;
+		const pid_t pid = wait(&status);
+		if (pid < 0)
+		{
+			break;
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			m_exchange.Abort();
+			if (finished)
+			{
+				const size_t shard = std::find(shards.begin(), shards.end(), pid) - shards.begin();
+				error = "shard " + std::to_string(shard) + (WIFSIGNALED(status) ? " was killed by signal " +
+				        std::to_string(WTERMSIG(status)) : " failed, possibly at its memory limit");
+			}
+			finished = false;
+		}
+	}
+	if (!finished)
+	{
+		return false;
+	}
+
+	m_summaries.resize(m_shardCount);
+	m_queueWaitHistogram.assign(EventSimulation::kQueueWaitBucketCount, 0);
+	for (uint32_t shard = 0; shard < m_shardCount; ++shard)
+	{
+		m_summaries[shard] = m_exchange.GetSummary(shard);
+		if (m_summaries[shard].status != 0)
+		{
+			error = "shard " + std::to_string(shard) + " left no summary";
+			return false;
+		}
+		const uint64_t* histogram = m_exchange.GetQueueWaitHistogram(shard);
+		for (uint32_t i = 0; i < EventSimulation::kQueueWaitBucketCount; ++i)
+		{
+			m_queueWaitHistogram[i] += histogram[i];
+		}
+	}
+	return true;
+}
+
+bool ShardedSimulation::RunShard(uint32_t shard)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EventSimulationConfig config;
+	config.scenario = &m_scenario;
+	config.seed = m_scenario.GetSeed();
+	// Draws are keyed by truck, so they do not depend on which shard holds the truck.
+	config.commonRandomNumbers = true;
+	config.shardExchange = &m_exchange;
+	config.shardIndex = shard;
+	EventSimulation simulation(config);
+
+	std::vector<TruckHandOff> received;
+	const uint64_t endTime = m_scenario.GetSimulationTime();
+	for (uint64_t windowStart = 0; windowStart < endTime; windowStart += m_window)
+	{
+		// Events at the end of the run are processed, as in a single process run.
+		simulation.RunUntil(endTime - windowStart <= m_window ? endTime : windowStart + m_window - 1);
+		if (!m_exchange.EndWindow(shard, received))
+		{
+			return false;
+		}
+		simulation.ReceiveTrucks(received);
+		simulation.PublishStationStates(m_exchange.GetStationStates());
+		if (!m_exchange.Synchronize(shard))
+		{
+			return false;
+		}
+		simulation.LoadStationStates(m_exchange.GetStationStates());
+	}
+
+	ShardSummary summary;
+	memset(&summary, 0, sizeof(summary));
+	summary.processedEvents = simulation.GetProcessedEventCount();
+	summary.handOffCount = simulation.GetHandOffCount();
+	for (uint32_t i = 0; i < simulation.GetTruckCount(); ++i)
+	{
+		if (simulation.HoldsTruck(i))
+		{
+			summary.truckCount++;
+			summary.loadCount += simulation.GetTruck(i).loadCount;
+			summary.totalQueueWaitTime += simulation.GetTruck(i).totalQueueWaitTime;
+		}
+	}
+	for (uint32_t i = 0; i < simulation.GetStationCount(); ++i)
+	{
+		if (m_exchange.GetStationShard(i) == shard)
+		{
+			summary.unloadCount += simulation.GetStation(i).unloadCount;
+			summary.unloadedTonnes += simulation.GetStation(i).unloadedTonnes;
+			summary.busyTime += simulation.GetStation(i).busyTime;
+		}
+	}
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		summary.peakMemory = usage.ru_maxrss;
+	}
+	summary.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	memcpy(m_exchange.GetQueueWaitHistogram(shard), simulation.GetQueueWaitHistogram(),
+	       sizeof(uint64_t) * EventSimulation::kQueueWaitBucketCount);
+	summary.status = 0;
+	m_exchange.GetSummary(shard) = summary;
+	return true;
+}
+
+uint32_t ShardedSimulation::GetShardCount() const
+{
+	return m_shardCount;
+}
+
+uint64_t ShardedSimulation::GetWindow() const
+{
+	return m_window;
+}
+
+const ShardSummary& ShardedSimulation::GetSummary(uint32_t shard) const
+{
+	return m_summaries[shard];
+}
+
+uint64_t ShardedSimulation::GetQueueWaitPercentile(double percentile) const
+{
+	uint64_t count = 0;
+	for (uint64_t bucket : m_queueWaitHistogram)
+	{
+		count += bucket;
+	}
+	const uint64_t rank = (uint64_t)std::ceil(count * percentile / 100);
+	uint64_t cumulative = 0;
+	for (uint32_t i = 0; i < m_queueWaitHistogram.size(); ++i)
+	{
+		cumulative += m_queueWaitHistogram[i];
+		if (cumulative >= rank && cumulative > 0)
+		{
+			return i * EventSimulation::kQueueWaitBucketWidth;
+		}
+	}
+	return 0;
+}
@@ -5,13 +5,37 @@
  * trucks and stations statistics report.
  */
 #include <iostream>
+#include <fstream>
 #include <thread>
 #include <unistd.h>
+#include <sys/wait.h>
 #include <chrono>
+#include <stop_token>
+#include <cmath>
+#include <memory>
 #include "MiningTruck.h"
 #include "UnloadingStation.h"
 #include "StateExecutor.h"
 #include "Constants.h"
+#include "SimOptions.h"
+#include "NumaPlacement.h"
+#include "Arena.h"
+#include "AllocationCounter.h"
+#include "EventSimulation.h"
+#include "TraceRecorder.h"
+#include "SimMetrics.h"
+#include "MetricsExporter.h"
+#include "Scenario.h"
+#include "WhatIfBranching.h"
+#include "ScenarioComparison.h"
+#include "AnalyticalEstimator.h"
+#include "StationOptimizer.h"
+#include "RoadNetwork.h"
+#include "StagingArea.h"
+#include "StatisticsReport.h"
+#include "TimeSeriesRecorder.h"
+#include "DigitalTwin.h"
+#include "ShardedSimulation.h"
 using namespace std;
 using namespace std::chrono;
 
@@ -19,20 +43,734 @@ using namespace std::chrono;
  * Print all trucks statistics report
  *
  * @param[in] trucks        List of MiningTruck object.
+ * @param[in] csv           Stream for the CSV rows with the column names. NULL for none.
  */
-void PrintMiningTruckStatisticsReport(std::vector<MiningTruck*>& trucks)
+void PrintMiningTruckStatisticsReport(std::vector<MiningTruck*>& trucks, std::ostream* csv)
 {
-	// loop through each item in trucks and use cout to print all reports.
+	// Read every truck once through its sequence lock, then gather each counter
+	// in a contiguous array, so the reductions run over plain integers.
+	std::vector<TruckSnapshot> snapshots;
+	MiningTruck::GetFleetSnapshot(trucks, snapshots);
+	StatisticsReport report("trucks");
+	std::vector<uint64_t> values(snapshots.size());
+	for(size_t i = 0; i < snapshots.size(); ++i)
+	{
+		values[i] = snapshots[i].travelCount;
+	}
+	report.AddCounter("travel_count", values);
+	for(size_t i = 0; i < snapshots.size(); ++i)
+	{
+		values[i] = snapshots[i].loadCount;
+	}
+	report.AddCounter("load_count", values);
+	for(size_t i = 0; i < snapshots.size(); ++i)
+	{
+		values[i] = snapshots[i].unloadCount;
+	}
+	report.AddCounter("unload_count", values);
+	for(size_t i = 0; i < snapshots.size(); ++i)
+	{
+		values[i] = snapshots[i].totalLoadingTime;
+	}
+	report.AddCounter("loading_time_ms", values);
+	for(size_t i = 0; i < snapshots.size(); ++i)
+	{
+		values[i] = (uint64_t)snapshots[i].unloadCount * trucks[i]->GetPayload();
+	}
+	report.AddCounter("unloaded_tonnes", values);
+	report.Print(cout);
+	if (csv)
+	{
+		report.WriteCsv(*csv, true);
+	}
 }
 
 /**
  * Print all unloading station statistics report
  *
- * @param[in] trucks        List of UnloadingStation object.
+ * @param[in] stations      List of UnloadingStation object.
+ * @param[in] csv           Stream for the CSV rows. NULL for none.
+ */
+void PrintUnloadingStationStatisticsReport(std::vector<UnloadingStation*>& stations, std::ostream* csv)
+{
+	StatisticsReport report("stations");
+	std::vector<uint64_t> values(stations.size());
+	for(size_t i = 0; i < stations.size(); ++i)
+	{
+		values[i] = stations[i]->GetUnloadCount();
+	}
+	report.AddCounter("unload_count", values);
+	for(size_t i = 0; i < stations.size(); ++i)
+	{
+		values[i] = stations[i]->GetUnloadedTonnes();
+	}
+	report.AddCounter("unloaded_tonnes", values);
+	for(size_t i = 0; i < stations.size(); ++i)
+	{
+		values[i] = stations[i]->GetRejectedCount();
+	}
+	report.AddCounter("rejected_arrivals", values);
+	for(size_t i = 0; i < stations.size(); ++i)
+	{
+		values[i] = stations[i]->GetDivertedCount();
+	}
+	report.AddCounter("diverted_arrivals", values);
+	report.Print(cout);
+	if (csv)
+	{
+		report.WriteCsv(*csv, false);
+	}
+}
+
+/**
+ * Print the trucks and stations statistics report of an event driven run
+ *
+ * @param[in] simulation    Finished event driven simulation
+ * @param[in] csv           Stream for the CSV rows with the column names. NULL for none.
+ */
+void PrintEventStatisticsReport(const EventSimulation& simulation, std::ostream* csv)
+{
+	const uint32_t truckCount = simulation.GetTruckCount();
+	StatisticsReport trucks("trucks");
+	std::vector<uint64_t> values(truckCount);
+	for(uint32_t i = 0; i < truckCount; ++i)
+	{
+		values[i] = simulation.GetTruck(i).travelCount;
+	}
+	trucks.AddCounter("travel_count", values);
+	for(uint32_t i = 0; i < truckCount; ++i)
+	{
+		values[i] = simulation.GetTruck(i).loadCount;
+	}
+	trucks.AddCounter("load_count", values);
+	for(uint32_t i = 0; i < truckCount; ++i)
+	{
+		values[i] = simulation.GetTruck(i).unloadCount;
+	}
+	trucks.AddCounter("unload_count", values);
+	for(uint32_t i = 0; i < truckCount; ++i)
+	{
+		values[i] = simulation.GetTruck(i).totalLoadingTime;
+	}
+	trucks.AddCounter("loading_time_ms", values);
+	for(uint32_t i = 0; i < truckCount; ++i)
+	{
+		values[i] = simulation.GetTruck(i).totalQueueWaitTime;
+	}
+	trucks.AddCounter("queue_wait_ms", values);
+	for(uint32_t i = 0; i < truckCount; ++i)
+	{
+		values[i] = (uint64_t)simulation.GetTruck(i).unloadCount * simulation.GetTruckClass(i).payload;
+	}
+	trucks.AddCounter("unloaded_tonnes", values);
+
+	const uint32_t stationCount = simulation.GetStationCount();
+	StatisticsReport stations("stations");
+	values.resize(stationCount);
+	for(uint32_t i = 0; i < stationCount; ++i)
+	{
+		values[i] = simulation.GetStation(i).unloadCount;
+	}
+	stations.AddCounter("unload_count", values);
+	for(uint32_t i = 0; i < stationCount; ++i)
+	{
+		values[i] = simulation.GetStation(i).unloadedTonnes;
+	}
+	stations.AddCounter("unloaded_tonnes", values);
+	for(uint32_t i = 0; i < stationCount; ++i)
+	{
+		values[i] = simulation.GetStation(i).busyTime;
+	}
+	stations.AddCounter("busy_time_ms", values);
+
+	trucks.Print(cout);
+	stations.Print(cout);
+	if (csv)
+	{
+		trucks.WriteCsv(*csv, true);
+		stations.WriteCsv(*csv, false);
+	}
+}
+
+/**
+ * Print how many queue pushes stayed on the NUMA node of the station
+ * and how many crossed to another node, as counted by the stations.
+ *
+ * @param[in] stations      List of UnloadingStation object.
+ * @param[in] nodeCount     Number of NUMA nodes used by the placement.
+ */
+void PrintNumaPlacementReport(std::vector<UnloadingStation*>& stations, uint32_t nodeCount)
+{
+	uint64_t localPushes = 0;
+	uint64_t remotePushes = 0;
+	for(UnloadingStation* station : stations)
+	{
+		localPushes += station->GetLocalPushCount();
+		remotePushes += station->GetRemotePushCount();
+	}
+	const uint64_t totalPushes = localPushes + remotePushes;
+	cout << "NUMA nodes                : " << nodeCount << "\n"
+	     << "Node local queue pushes   : " << localPushes << "\n"
+	     << "Cross-node queue pushes   : " << remotePushes << "\n"
+	     << "Node local share          : " << (totalPushes ? 100.0 * localPushes / totalPushes : 0) << " %\n";
+}
+
+/**
+ * Print lock contention, wakeup and depth counters of every station
+ * queue and the fleet-wide summary. Counters are only available when
+ * built with BLOCKING_QUEUE_STATS.
+ *
+ * @param[in] stations      List of UnloadingStation object.
+ */
+void PrintQueueContentionReport(std::vector<UnloadingStation*>& stations)
+{
+	BlockingQueueStats fleet;
+	cout << "Station  Acquired  Contended  LockWait(us)  Spurious  Timeouts  MaxDepth\n";
+	for(UnloadingStation* station : stations)
+	{
+		const BlockingQueueStats stats = station->GetQueueStats();
+		fleet.Merge(stats);
+		cout << *station << "  " << stats.acquisitions << "  " << stats.contendedAcquisitions << "  "
+		     << stats.lockWaitTime / 1000 << "  " << stats.spuriousWakeups << "  "
+		     << stats.timeoutWakeups << "  " << stats.highWaterMark << "\n";
+	}
+	cout << "Fleet    " << fleet.acquisitions << "  " << fleet.contendedAcquisitions << "  "
+	     << fleet.lockWaitTime / 1000 << "  " << fleet.spuriousWakeups << "  "
+	     << fleet.timeoutWakeups << "  " << fleet.highWaterMark << "\n";
+	if (fleet.acquisitions)
+	{
+		cout << "Contended acquisitions : " << 100.0 * fleet.contendedAcquisitions / fleet.acquisitions << " %\n";
+	}
+}
+
+/**
+ * Get the station queue priority class of a truck. Trucks are dealt
+ * to the classes by their Id modulo 100, in the configured percents.
+ *
+ * @param[in] truckId    Truck Id
+ * @param[in] percents   Percent of the trucks in each class above the normal one
+ *
+ * @return    Unsigned Integer  Priority class. The normal class is the last.
+ */
+uint32_t GetTruckPriorityClass(int truckId, const std::vector<uint32_t>& percents)
+{
+	const uint32_t slot = (truckId - 1) % 100;
+	uint32_t limit = 0;
+	for(uint32_t i = 0; i < percents.size(); ++i)
+	{
+		limit += percents[i];
+		if (slot < limit)
+		{
+			return i;
+		}
+	}
+	return percents.size();
+}
+
+/**
+ * Print the queue waits of every truck priority class over all the stations
+ *
+ * @param[in] stations      List of UnloadingStation object.
+ * @param[in] classCount    Number of priority classes
+ * @param[in] factor        Speed up factor, to turn waits into simulated time
+ */
+void PrintPriorityClassReport(std::vector<UnloadingStation*>& stations, uint32_t classCount, uint32_t factor)
+{
+	// Waits are recorded in real microseconds; the simulation runs factor times faster.
+	const double toMinutes = (double)factor / 60000000.0;
+	cout << "Class  Unloads  MeanWait(min)  P95Wait(min)  P99Wait(min)  MaxWait(min)\n";
+	for(uint32_t priorityClass = 0; priorityClass < classCount; ++priorityClass)
+	{
+		PriorityClassStats stats;
+		for(UnloadingStation* station : stations)
+		{
+			stats.Merge(station->GetPriorityClassStats(priorityClass));
+		}
+		cout << priorityClass << "  " << stats.count << "  "
+		     << (stats.count ? stats.totalWait * toMinutes / stats.count : 0) << "  "
+		     << stats.GetPercentile(95) * toMinutes << "  " << stats.GetPercentile(99) * toMinutes << "  "
+		     << stats.maxWait * toMinutes << "\n";
+	}
+}
+
+/**
+ * Print the arrivals refused by the full stations, the ones diverted
+ * to another station and the trucks held in the staging area
+ *
+ * @param[in] stations      List of UnloadingStation object.
+ * @param[in] factor        Speed up factor, to turn hold times into simulated time
+ */
+void PrintAdmissionReport(std::vector<UnloadingStation*>& stations, uint32_t factor)
+{
+	cout << "Station  Rejected  Diverted\n";
+	for(UnloadingStation* station : stations)
+	{
+		cout << *station << "  " << station->GetRejectedCount() << "  " << station->GetDivertedCount() << "\n";
+	}
+	const StagingArea* stagingArea = StagingArea::GetInstance();
+	const uint64_t holdCount = stagingArea->GetHoldCount();
+	cout << "Staging area holds: " << holdCount
+	     << ", mean hold: " << (holdCount ? (double)stagingArea->GetTotalHoldTime() * factor / holdCount / 60000 : 0)
+	     << " min, most trucks held: " << stagingArea->GetMaxOccupancy() << "\n";
+}
+
+/**
+ * Write the recorded time series and its downsampled view if requested
+ *
+ * @param[in] timeSeries   Recorded time series
+ * @param[in] options      Time series file and plot points
+ *
+ * @return    bool         True if the files are written, otherwise False.
+ */
+bool WriteTimeSeries(const TimeSeriesRecorder& timeSeries, const SimOptions& options)
+{
+	if (!timeSeries.Write(options.timeSeriesFile))
+	{
+		cout << "Cannot write time series " << options.timeSeriesFile << "\n";
+		return false;
+	}
+	cout << "Time series samples / bytes : " << timeSeries.GetSampleCount() << " / "
+	     << timeSeries.GetEncodedSize() << "\n";
+	if (options.timeSeriesPlotPoints &&
+	    !timeSeries.WriteDownsampledCsv(options.timeSeriesFile + ".csv", options.timeSeriesPlotPoints))
+	{
+		cout << "Cannot write time series view " << options.timeSeriesFile << ".csv\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Run the simulation with the event driven engine and print its report
+ *
+ * @param[in] scenario               Scenario to run
+ * @param[in] options                Checkpoint and restore options
+ * @param[in] publishMetrics         Publish live counters to SimMetrics
+ *
+ * @return    Integer success.
+ */
+int RunEventSimulation(const Scenario& scenario, const SimOptions& options, bool publishMetrics)
+{
+	EventSimulationConfig config;
+	config.scenario = &scenario;
+	config.seed = scenario.GetSeed();
+	config.publishMetrics = publishMetrics;
+	config.perturbationAnalysis = options.gradients;
+
+	RoadNetwork network;
+	if (!options.roadNetworkFile.empty())
+	{
+		std::string error;
+		high_resolution_clock::time_point loadTime = high_resolution_clock::now();
+		if (!network.Load(options.roadNetworkFile, error))
+		{
+			cout << "Cannot load road network: " << error << "\n";
+			return 1;
+		}
+		cout << "Road network                : " << network.GetPitCount() << " pits, " << network.GetDumpCount()
+		     << " dumps, " << network.GetNodeCount() << " nodes, travel matrix in "
+		     << duration_cast<duration<double, std::milli>>(high_resolution_clock::now() - loadTime).count() << " ms\n";
+		config.roadNetwork = &network;
+	}
+
+	high_resolution_clock::time_point startTime = high_resolution_clock::now();
+	EventSimulation simulation(config);
+	if (!options.restoreFile.empty())
+	{
+		std::string error;
+		if (!simulation.RestoreCheckpoint(options.restoreFile, error))
+		{
+			cout << "Cannot restore checkpoint: " << error << "\n";
+			return 1;
+		}
+		cout << "Resumed at simulated hour   : " << simulation.GetSimulatedTime() / 3600000.0 << "\n";
+	}
+	//Sample from the resume point on, at the interval boundaries of the whole run
+	std::unique_ptr<TimeSeriesRecorder> timeSeries;
+	if (!options.timeSeriesFile.empty())
+	{
+		const uint64_t interval = options.timeSeriesIntervalMinutes * 60000ULL;
+		const uint64_t firstSample = (simulation.GetSimulatedTime() + interval - 1) / interval * interval;
+		timeSeries.reset(new TimeSeriesRecorder(scenario.GetStationCount(), firstSample, interval,
+				(scenario.GetSimulationTime() - firstSample) / interval + 1));
+		simulation.SetTimeSeriesRecorder(timeSeries.get());
+	}
+	//Throughput is measured in batches for warm-up detection and early stop
+	SteadyStateDetector detector(kSteadyStateBatchMinutes * 60000ULL, options.earlyStopPercent / 100.0,
+	                             kSteadyStateMinimumBatches);
+	if (options.earlyStopPercent)
+	{
+		simulation.RunUntilSteadyState(detector);
+	}
+	else if (options.checkpointFile.empty())
+	{
+		simulation.Run();
+	}
+	else
+	{
+		//Run in checkpoint intervals, so a crash loses at most one interval
+		const uint64_t interval = options.checkpointIntervalHours * 3600000ULL;
+		while (simulation.GetSimulatedTime() < scenario.GetSimulationTime())
+		{
+			simulation.RunUntil((simulation.GetSimulatedTime() / interval + 1) * interval);
+			if (!simulation.SaveCheckpoint(options.checkpointFile))
+			{
+				cout << "Cannot write checkpoint " << options.checkpointFile << "\n";
+				return 1;
+			}
+		}
+	}
+	const double elapsed = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+
+	uint64_t unloadCount = 0;
+	uint64_t unloadedTonnes = 0;
+	for(uint32_t i = 0; i < simulation.GetStationCount(); ++i)
+	{
+		unloadCount += simulation.GetStation(i).unloadCount;
+		unloadedTonnes += simulation.GetStation(i).unloadedTonnes;
+	}
+	//The statistics leave out a discarded warm-up
+	const uint64_t measuredTime = simulation.GetSimulatedTime() - simulation.GetStatisticsStartTime();
+	cout << "Simulated hours             : " << scenario.GetSimulationTime() / 3600000.0 << "\n"
+	     << "Events processed            : " << simulation.GetProcessedEventCount() << "\n"
+	     << "Events per second           : " << (uint64_t)(simulation.GetProcessedEventCount() / elapsed) << "\n"
+	     << "Total unloadings            : " << unloadCount << "\n"
+	     << "Total tonnes unloaded       : " << unloadedTonnes << "\n"
+	     << "Tonnes per hour             : " << unloadedTonnes * 3600000.0 / std::max<uint64_t>(1, measuredTime) << "\n"
+	     << "Arena bytes / blocks        : " << simulation.GetArena().GetUsedBytes() << " / "
+	     << simulation.GetArena().GetBlockCount() << "\n";
+	if (kAllocationCountEnabled)
+	{
+		cout << "Event loop heap allocations : " << simulation.GetSteadyStateAllocationCount() << "\n";
+	}
+	if (options.gradients)
+	{
+		const char* parameterNames[kGradientParameterCount] = { "unloading time", "travel time" };
+		for(uint32_t i = 0; i < kGradientParameterCount; ++i)
+		{
+			const GradientEstimate estimate = simulation.GetPerturbationAnalysis().GetEstimate((GradientParameter)i);
+			cout << "Per minute of " << parameterNames[i] << " : throughput " << estimate.throughput << " +/- "
+			     << estimate.throughputHalfWidth << " unloads/hour, queue wait " << estimate.queueWait << " +/- "
+			     << estimate.queueWaitHalfWidth << " min\n";
+		}
+	}
+	if (timeSeries && !WriteTimeSeries(*timeSeries, options))
+	{
+		return 1;
+	}
+	if (!options.reportCsvFile.empty())
+	{
+		std::ofstream csv(options.reportCsvFile);
+		if (!csv)
+		{
+			cout << "Cannot write report file " << options.reportCsvFile << "\n";
+			return 1;
+		}
+		PrintEventStatisticsReport(simulation, &csv);
+	}
+	else
+	{
+		PrintEventStatisticsReport(simulation, NULL);
+	}
+	if (options.earlyStopPercent)
+	{
+		cout << "Warm-up discarded (hours)   : "
+		     << detector.GetWarmupBatches() * kSteadyStateBatchMinutes / 60.0 << "\n"
+		     << "Stopped at simulated hour   : " << simulation.GetSimulatedTime() / 3600000.0 << "\n"
+		     << "Steady-state unloads / hour : " << detector.GetSteadyStateMean()
+		     << " +/- " << detector.GetHalfWidth() << "\n";
+	}
+	return 0;
+}
+
+/**
+ * Run the scenario to the branch point once, fork the what-if variants
+ * from there and print their comparison
+ *
+ * @param[in] scenario   Scenario to run
+ * @param[in] options    Branch point and variants
+ *
+ * @return    Integer success.
+ */
+int RunWhatIfBranches(const Scenario& scenario, const SimOptions& options)
+{
+	std::vector<BranchVariant> variants(options.branches.size());
+	for(size_t i = 0; i < options.branches.size(); ++i)
+	{
+		if (!WhatIfBranching::ParseVariant(options.branches[i], variants[i]))
+		{
+			cout << "Invalid variant " << options.branches[i] << "\n";
+			return 1;
+		}
+	}
+
+	WhatIfBranching branching(scenario, options.branchHour * 3600000ULL);
+	std::vector<BranchResult> results;
+	std::string error;
+	const bool started = branching.Run(variants, results, error);
+	if (!started)
+	{
+		cout << "Cannot start all the variants: " << error << "\n";
+	}
+
+	cout << "Common prefix to hour " << options.branchHour << " : " << branching.GetPrefixSeconds() << " s\n";
+	bool completed = true;
+	for(size_t i = 0; i < variants.size(); ++i)
+	{
+		const BranchResult& result = results[i];
+		completed = completed && result.completed;
+		if (!result.started)
+		{
+			cout << variants[i].name << " : not started, " << error << "\n";
+			continue;
+		}
+		if (!result.completed)
+		{
+			cout << variants[i].name << " : failed, ";
+			if (WIFSIGNALED(result.waitStatus))
+			{
+				cout << "killed by signal " << WTERMSIG(result.waitStatus) << "\n";
+			}
+			else
+			{
+				cout << "exit status " << WEXITSTATUS(result.waitStatus) << "\n";
+			}
+			continue;
+		}
+		const double simulatedTime = scenario.GetSimulationTime();
+		cout << variants[i].name << "\n"
+		     << "  Stations / Trucks         : " << result.stationCount << " / " << result.truckCount << "\n"
+		     << "  Total unloadings          : " << result.unloadCount << "\n"
+		     << "  Mean queue wait (min)     : "
+		     << (result.unloadCount ? result.totalQueueWaitTime / 60000.0 / result.unloadCount : 0) << "\n"
+		     << "  Station utilization (%)   : " << 100.0 * result.totalBusyTime / (simulatedTime * result.stationCount) << "\n"
+		     << "  Branch run time (s)       : " << result.elapsedSeconds << "\n";
+	}
+	return started && completed ? 0 : 1;
+}
+
+/**
+ * Print one line of the comparison report
+ *
+ * @param[in] method     Name of the variance reduction method
+ * @param[in] estimate   Estimate of the method
+ * @param[in] baseline   Estimate with independent streams
  */
-void PrintUnloadingStationStatisticsReport(std::vector<UnloadingStation*>& stations)
+void PrintComparisonEstimate(const char* method, const ComparisonEstimate& estimate, const ComparisonEstimate& baseline)
 {
-	// loop through each item in stations and use cout to print all reports.
+	cout << method << " : " << estimate.meanDifference << " min, variance " << estimate.estimatorVariance
+	     << " (" << estimate.observations << " observations";
+	if (estimate.estimatorVariance > 0)
+	{
+		cout << ", " << baseline.estimatorVariance / estimate.estimatorVariance << "x reduction";
+	}
+	cout << ")\n";
+}
+
+/**
+ * Compare a what-if variant with the scenario over replications and
+ * print the variance reduction of common random numbers
+ *
+ * @param[in] scenario   Scenario to compare with
+ * @param[in] options    Variant and number of replications
+ *
+ * @return    Integer success.
+ */
+int RunScenarioComparison(const Scenario& scenario, const SimOptions& options)
+{
+	BranchVariant variant;
+	if (!WhatIfBranching::ParseVariant(options.compareVariant, variant))
+	{
+		cout << "Invalid variant " << options.compareVariant << "\n";
+		return 1;
+	}
+	ScenarioComparison comparison(scenario, variant, options.replications);
+	const ComparisonEstimate independent = comparison.RunIndependent();
+	cout << "Change of mean queue wait with " << variant.name << "\n";
+	PrintComparisonEstimate("Independent streams     ", independent, independent);
+	PrintComparisonEstimate("Common random numbers   ", comparison.RunCommonRandomNumbers(), independent);
+	PrintComparisonEstimate("Antithetic CRN pairs    ", comparison.RunAntitheticPairs(), independent);
+	return 0;
+}
+
+/**
+ * Sweep the number of stations. Each count is first estimated with
+ * mean value analysis. Counts which are saturated, or which add
+ * stations after the queue wait is already negligible, are skipped;
+ * the others are simulated and compared with their estimate.
+ *
+ * @param[in] scenario   Scenario to sweep
+ * @param[in] options    Largest station count
+ *
+ * @return    Integer success.
+ */
+int RunStationSweep(const Scenario& scenario, const SimOptions& options)
+{
+	AnalyticalEstimator estimator(scenario);
+	const double negligibleWait = estimator.GetMeanUnloadingTime() * kSweepNegligibleWaitPercent / 100.0;
+	const double simulatedHours = scenario.GetSimulationTime() / 3600000.0;
+	bool previousNegligible = false;
+	uint32_t simulatedCount = 0;
+	double utilizationError = 0;
+	double queueWaitError = 0;
+	cout << "Stations  Utilization est/sim (%)  Queue wait est/sim (min)  Estimate (us)\n";
+	for(uint32_t stationCount = scenario.GetStationCount(); stationCount <= options.sweepStations; ++stationCount)
+	{
+		high_resolution_clock::time_point startTime = high_resolution_clock::now();
+		const AnalyticalEstimate estimate = estimator.Estimate(stationCount, scenario.GetTruckCount());
+		const double estimateMicroSeconds =
+			duration_cast<duration<double, std::micro>>(high_resolution_clock::now() - startTime).count();
+		cout << stationCount << "  " << 100 * estimate.utilization;
+		const bool negligible = estimate.meanQueueWait < negligibleWait;
+		if (estimate.utilization * 100 >= kSweepSaturatedUtilizationPercent || (negligible && previousNegligible))
+		{
+			cout << " / skipped  " << estimate.meanQueueWait / 60000.0 << " / skipped  " << estimateMicroSeconds << "\n";
+			previousNegligible = negligible;
+			continue;
+		}
+		previousNegligible = negligible;
+
+		EventSimulationConfig config;
+		config.scenario = &scenario;
+		config.seed = scenario.GetSeed();
+		EventSimulation simulation(config);
+		simulation.AddStations(stationCount - scenario.GetStationCount());
+		simulation.Run();
+		uint64_t unloadCount = 0;
+		uint64_t busyTime = 0;
+		uint64_t queueWaitTime = 0;
+		for(uint32_t i = 0; i < simulation.GetStationCount(); ++i)
+		{
+			unloadCount += simulation.GetStation(i).unloadCount;
+			busyTime += simulation.GetStation(i).busyTime;
+		}
+		for(uint32_t i = 0; i < simulation.GetTruckCount(); ++i)
+		{
+			queueWaitTime += simulation.GetTruck(i).totalQueueWaitTime;
+		}
+		const double utilization = busyTime / (simulatedHours * 3600000.0 * stationCount);
+		const double queueWait = unloadCount ? (double)queueWaitTime / unloadCount : 0;
+		cout << " / " << 100 * utilization << "  " << estimate.meanQueueWait / 60000.0 << " / " << queueWait / 60000.0
+		     << "  " << estimateMicroSeconds << "\n";
+		simulatedCount++;
+		utilizationError += std::abs(estimate.utilization - utilization);
+		queueWaitError += std::abs(estimate.meanQueueWait - queueWait);
+	}
+	if (simulatedCount)
+	{
+		cout << "Mean absolute error of the estimate: utilization " << 100 * utilizationError / simulatedCount
+		     << " points, queue wait " << queueWaitError / simulatedCount / 60000.0 << " min\n";
+	}
+	return 0;
+}
+
+/**
+ * Search the fewest stations which keep the p95 queue wait of the
+ * fleet below the limit and print the verdicts of the search
+ *
+ * @param[in] scenario   Scenario with the fleet
+ * @param[in] options    Wait limit, largest station count and replications
+ *
+ * @return    Integer success.
+ */
+int RunStationOptimizer(const Scenario& scenario, const SimOptions& options)
+{
+	StationOptimizer optimizer(scenario, options.optimizeWaitMinutes * 60000ULL, options.maxStations,
+	                           options.replications);
+	const uint32_t stationCount = optimizer.Run();
+	for(const StationVerdict& verdict : optimizer.GetVerdicts())
+	{
+		cout << verdict.stationCount << " stations : p95 wait " << verdict.meanWait / 60000.0 << " +/- "
+		     << verdict.halfWidth / 60000.0 << " min over " << verdict.replications << " runs, "
+		     << (verdict.meetsLimit ? "meets" : "misses") << " the limit"
+		     << (verdict.settled ? "\n" : " (not settled)\n");
+	}
+	if (stationCount == 0)
+	{
+		cout << "No count up to " << options.maxStations << " stations meets the limit\n";
+	}
+	else
+	{
+		cout << "Fewest stations for " << scenario.GetTruckCount() << " trucks : " << stationCount << "\n";
+	}
+	cout << "Simulation runs : " << optimizer.GetRunCount() << "\n";
+	return 0;
+}
+
+/**
+ * Follow the truck state telemetry and print a forecast of the next hours
+ * after each update
+ *
+ * @param[in] scenario   Scenario with the fleet. Its simulation time is set to the forecast horizon.
+ * @param[in] options    Telemetry source, forecast horizon and replications
+ *
+ * @return    Integer success.
+ */
+int RunDigitalTwin(Scenario& scenario, const SimOptions& options)
+{
+	scenario.SetSimulationTime(options.forecastHours * 3600000ULL);
+	std::ifstream file;
+	if (options.twinFile != "-")
+	{
+		file.open(options.twinFile);
+		if (!file)
+		{
+			cout << "Cannot open telemetry " << options.twinFile << "\n";
+			return 1;
+		}
+	}
+	DigitalTwin twin(scenario, options.replications);
+	if (twin.Run(options.twinFile == "-" ? std::cin : file, cout) == 0)
+	{
+		cout << "No telemetry to forecast from\n";
+	}
+	return 0;
+}
+
+/**
+ * Run the scenario split across shard processes and print each shard and
+ * the totals
+ *
+ * @param[in] scenario   Scenario to run
+ * @param[in] options    Number of shards and their memory limit
+ *
+ * @return    Integer success.
+ */
+int RunShardedSimulation(const Scenario& scenario, const SimOptions& options)
+{
+	ShardedSimulation simulation(scenario, options.shards, options.shardMemoryMiB * 1024 * 1024);
+	std::string error;
+	if (!simulation.Run(error))
+	{
+		cout << "Sharded run failed : " << error << "\n";
+		return 1;
+	}
+	ShardSummary total = {};
+	for (uint32_t shard = 0; shard < simulation.GetShardCount(); ++shard)
+	{
+		const ShardSummary& summary = simulation.GetSummary(shard);
+		cout << "Shard " << shard << " : " << summary.processedEvents << " events, " << summary.truckCount
+		     << " trucks, " << summary.handOffCount << " hand-offs, peak memory " << summary.peakMemory / 1024.0
+		     << " MiB, " << summary.elapsed << " s\n";
+		total.processedEvents += summary.processedEvents;
+		total.loadCount += summary.loadCount;
+		total.unloadCount += summary.unloadCount;
+		total.unloadedTonnes += summary.unloadedTonnes;
+		total.totalQueueWaitTime += summary.totalQueueWaitTime;
+		total.handOffCount += summary.handOffCount;
+	}
+	const double hours = scenario.GetSimulationTime() / 3600000.0;
+	cout << "Window : " << simulation.GetWindow() / 60000.0 << " min\n"
+	     << "Events processed : " << total.processedEvents << "\n"
+	     << "Hand-offs : " << total.handOffCount << "\n"
+	     << "Total loadings : " << total.loadCount << "\n"
+	     << "Total unloadings : " << total.unloadCount << "\n"
+	     << "Total tonnes unloaded : " << total.unloadedTonnes << "\n"
+	     << "Tonnes per hour : " << total.unloadedTonnes / hours << "\n"
+	     << "Mean queue wait : " << (total.unloadCount ? (double)total.totalQueueWaitTime / total.unloadCount / 60000 : 0)
+	     << " min\n"
+	     << "P95 queue wait : " << simulation.GetQueueWaitPercentile(95) / 60000.0 << " min\n";
+	return 0;
 }
 
 /**
@@ -66,19 +804,54 @@ int GetUnloadingStationCountFromUser()
 
 /**
  * Wait until the simulation test completes
+ *
+ * @param[in] scenario     Scenario which gives the simulated time and speed up factor
+ * @param[in] timeSeries   Recorder sampled from SimMetrics at its interval. NULL for none.
  */
-void WaitForSimulationEnds()
+void WaitForSimulationEnds(const Scenario& scenario, TimeSeriesRecorder* timeSeries)
 {
-	int simulationTime = (kSimulationTimeInHour * kMinutePerHour * kSecondsPerMinute * kMilliSecondsPerSecond) / kFactorValue;
-	this_thread::sleep_for(std::chrono::milliseconds(simulationTime));
+	const high_resolution_clock::time_point start = high_resolution_clock::now();
+	uint64_t simulationTime = scenario.GetSimulationTime() / scenario.GetFactor();
+	if (!timeSeries)
+	{
+		this_thread::sleep_for(std::chrono::milliseconds(simulationTime));
+		return;
+	}
+	const uint32_t stationCount = timeSeries->GetStationCount();
+	std::vector<int64_t> queueDepths(stationCount);
+	int64_t truckCounts[kTruckStateCount];
+	while (timeSeries->GetNextSampleTime() <= scenario.GetSimulationTime())
+	{
+		this_thread::sleep_until(start + std::chrono::milliseconds(timeSeries->GetNextSampleTime() / scenario.GetFactor()));
+		for(uint32_t i = 0; i < stationCount; ++i)
+		{
+			queueDepths[i] = SimMetrics::GetInstance()->GetQueueDepth(i);
+		}
+		for(uint32_t state = 0; state < kTruckStateCount; ++state)
+		{
+			truckCounts[state] = SimMetrics::GetInstance()->GetTruckCount((TruckState)state);
+		}
+		//The sample is taken a little late; the recorder keeps the deviation.
+		timeSeries->AddSample(SimMetrics::GetInstance()->GetSimulatedTime(), queueDepths.data(), truckCounts);
+	}
+	this_thread::sleep_until(start + std::chrono::milliseconds(simulationTime));
 }
 
 /**
  * Main Function
  *
+ * @param[in] argc  Number of command line arguments
+ * @param[in] argv  Command line arguments. See SimOptions.h
+ *
  * @return Integer success.
  */
-int main() {
+int main(int argc, char* argv[]) {
+	SimOptions options;
+	if (!ParseSimOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
 	int trucksCount = 0;
 	int unloadingStationCount = 0;
 	std::vector<MiningTruck*> trucks;
@@ -86,73 +859,220 @@ int main() {
 	std::vector<UnloadingStation*> stations;
 	std::vector<std::thread> executorThreads;
 	std::vector<std::thread> stationThreads;
+	// Single stop source shared by every station, executor and truck of this run
+	std::stop_source stopSource;
 
-	//Get Truck counts from user. If user enters value equal or lesser than 0, it will prompt again to get valid value.
-	while(1)
+	//Load the scenario file, or get the counts from user and use the constants of Constants.h.
+	Scenario scenario;
+	if (!options.scenarioFile.empty())
 	{
-		trucksCount = GetTrucksCountFromUser();
-		if (trucksCount <= 0) {
-			cout <<"Invalid number of Trucks. Please enter valid number. 1 or more";
-		} else {
-			break;
+		std::string error;
+		if (!scenario.Load(options.scenarioFile, error))
+		{
+			cout << "Cannot load scenario " << options.scenarioFile << ": " << error << "\n";
+			return 1;
 		}
+		trucksCount = scenario.GetTruckCount();
+		unloadingStationCount = scenario.GetStationCount();
 	}
+	else
+	{
+		//Get Truck counts from user. If user enters value equal or lesser than 0, it will prompt again to get valid value.
+		while(1)
+		{
+			trucksCount = GetTrucksCountFromUser();
+			if (!cin) {
+				return 1;
+			}
+			if (trucksCount <= 0) {
+				cout <<"Invalid number of Trucks. Please enter valid number. 1 or more\n";
+			} else {
+				break;
+			}
+		}
 
-	//Get Unloading Station counts from user. If user enters value equal or lesser than 0, it will prompt again to get valid value.
-	while(1)
+		//Get Unloading Station counts from user. If user enters value equal or lesser than 0, it will prompt again to get valid value.
+		while(1)
+		{
+			unloadingStationCount = GetUnloadingStationCountFromUser();
+			if (!cin) {
+				return 1;
+			}
+			if (unloadingStationCount <= 0) {
+				cout <<"Invalid number of Unloading Stations. Please enter valid number. 1 or more\n";
+			} else {
+				break;
+			}
+		}
+
+		std::string error;
+		if (!scenario.CreateDefault(trucksCount, unloadingStationCount, error))
+		{
+			cout << "Cannot create scenario: " << error << "\n";
+			return 1;
+		}
+	}
+
+	if (!options.convertScenarioFile.empty())
 	{
-		unloadingStationCount = GetUnloadingStationCountFromUser();
-		if (trucksCount <= 0) {
-			cout <<"Invalid number of Unloading Stations. Please enter valid number. 1 or more";
-		} else {
-			break;
+		if (!scenario.WriteBinary(options.convertScenarioFile))
+		{
+			cout << "Cannot write scenario " << options.convertScenarioFile << "\n";
+			return 1;
 		}
+		return 0;
+	}
+
+	//Start the metrics endpoint if requested. It is served until stop is requested.
+	SimMetrics::GetInstance()->SetStationCount(unloadingStationCount);
+	MetricsExporter exporter(stopSource.get_token());
+	std::thread metricsThread;
+	if (options.metricsPort || !options.metricsSocket.empty())
+	{
+		bool listening = options.metricsPort ? exporter.ListenTcp(options.metricsPort)
+		                                     : exporter.ListenUnix(options.metricsSocket);
+		if (!listening)
+		{
+			cout << "Cannot open the metrics endpoint\n";
+			return 1;
+		}
+		metricsThread = std::thread(&MetricsExporter::run, &exporter);
+	}
+
+	if (options.eventDriven)
+	{
+		int result;
+		if (!options.twinFile.empty())
+		{
+			result = RunDigitalTwin(scenario, options);
+		}
+		else if (options.shards)
+		{
+			result = RunShardedSimulation(scenario, options);
+		}
+		else if (!options.compareVariant.empty())
+		{
+			result = RunScenarioComparison(scenario, options);
+		}
+		else if (options.optimizeWaitMinutes)
+		{
+			result = RunStationOptimizer(scenario, options);
+		}
+		else if (options.sweepStations)
+		{
+			result = RunStationSweep(scenario, options);
+		}
+		else if (!options.branches.empty())
+		{
+			result = RunWhatIfBranches(scenario, options);
+		}
+		else
+		{
+			result = RunEventSimulation(scenario, options, metricsThread.joinable());
+		}
+		stopSource.request_stop();
+		if (metricsThread.joinable())
+		{
+			metricsThread.join();
+		}
+		return result;
+	}
+
+	if (!options.traceFile.empty())
+	{
+		TraceRecorder::GetInstance()->Enable(options.traceSampleInterval, options.traceLimit);
 	}
 
     /**
-	 * Create instance of UnloadingStation for each station
+	 * Create instance of UnloadingStation for each station and instance of MiningTruck
+	 * and StateExecutor for each truck.
+	 * All of them are created in one arena, so setup is one bulk allocation.
+	 * With NUMA placement, objects of one node are created together while the main thread
+	 * is pinned to that node, so their memory is first touched on that node.
+	 */
+	Arena arena(unloadingStationCount * (sizeof(UnloadingStation) + alignof(UnloadingStation)) +
+			trucksCount * (sizeof(MiningTruck) + alignof(MiningTruck) + sizeof(StateExecutor) + alignof(StateExecutor)));
+	NumaPlacement placement;
+	const uint32_t nodeCount = options.numaPlacement ? placement.GetNodeCount() : 1;
+	stations.resize(unloadingStationCount);
+	trucks.resize(trucksCount);
+	executors.resize(trucksCount);
+	for(uint32_t node = 0; node < nodeCount; ++node) {
+		if (options.numaPlacement) {
+			placement.PinCurrentThread(node);
+		}
+		for(int i=1; i<=unloadingStationCount; ++i) {
+			if (options.numaPlacement && placement.GetStationNode(i - 1) != node) {
+				continue;
+			}
+			UnloadingStation* station = arena.New<UnloadingStation>(i, options.batchUnloading, stopSource.get_token(),
+					options.priorityClassPercents.size() + 1);
+			station->SetNumaNode(node);
+			// The option overrides the capacities of the scenario for every station.
+			station->SetCapacity(options.stationCapacity ? options.stationCapacity : scenario.GetStation(i - 1).capacity);
+			stations[i - 1] = station;
+		}
+		for(int i=1; i<=trucksCount; ++i) {
+			if (options.numaPlacement && placement.GetTruckNode(i - 1, unloadingStationCount) != node) {
+				continue;
+			}
+			MiningTruck* truck = arena.New<MiningTruck>(i, stopSource.get_token());
+			truck->SetNumaNode(node);
+			truck->SetPriorityClass(GetTruckPriorityClass(i, options.priorityClassPercents));
+			truck->SetPayload(scenario.GetTruckPayload(i - 1));
+			trucks[i - 1] = truck;
+			executors[i - 1] = arena.New<StateExecutor>(stopSource.get_token());
+		}
+	}
+	if (options.numaPlacement) {
+		placement.UnpinCurrentThread();
+	}
+
+	/**
 	 * Thread is created for each station which executes unloading process of the truck
 	 * from the waiting queue.
 	 */
-	for(int i=1; i<=unloadingStationCount; ++i) {
-		UnloadingStation* station = new UnloadingStation(i);
-	    stations.push_back(station);
-	    std::thread t = std::thread(&UnloadingStation::run, station);
-	    stationThreads.push_back(t);
+	for(UnloadingStation* station : stations) {
+	    std::thread t = std::thread([&options, &placement, station] {
+	    	if (options.numaPlacement) {
+	    		placement.PinCurrentThread(station->GetNumaNode());
+	    	}
+	    	station->run();
+	    });
+	    stationThreads.push_back(std::move(t));
 	}
 
 	/**
-	 * Create instance of MiningTruck and StateExecutor for each truck.
 	 * Thread is created for each StateExecutor which executes the task of the state for each truck
 	 */
-	for(int i=1; i<=trucksCount; ++i) {
-		MiningTruck* truck = new MiningTruck(i);
-		StateExecutor* executor = new StateExecutor();
-		trucks.push_back(truck);
-		executors.push_back(executor);
-	    std::thread t = std::thread(&StateExecutor::execute, executor, truck, stations);
-	    executorThreads.push_back(t);
+	for(int i=0; i<trucksCount; ++i) {
+		MiningTruck* truck = trucks[i];
+		StateExecutor* executor = executors[i];
+	    std::thread t = std::thread([&options, &placement, &stations, executor, truck] {
+	    	if (options.numaPlacement) {
+	    		placement.PinCurrentThread(truck->GetNumaNode());
+	    	}
+	    	executor->execute(truck, stations);
+	    });
+	    executorThreads.push_back(std::move(t));
 	}
 
 	//Wait until simulation test time completes
-	WaitForSimulationEnds();
-
-	//Stop all threads
-	for(UnloadingStation* station : stations)
-	{
-		station->StopSimulation();
-	}
-	for(StateExecutor* executor : executors)
-	{
-		executor->StopSimulation();
-	}
-	for(MiningTruck* truck : trucks)
-	{
-		truck->StopSimulation();
+	std::unique_ptr<TimeSeriesRecorder> timeSeries;
+	if (!options.timeSeriesFile.empty()) {
+		const uint64_t interval = options.timeSeriesIntervalMinutes * 60000ULL;
+		timeSeries.reset(new TimeSeriesRecorder(unloadingStationCount, 0, interval,
+				scenario.GetSimulationTime() / interval + 1));
 	}
+	SimMetrics::GetInstance()->StartRealTimeClock(scenario.GetFactor());
+	WaitForSimulationEnds(scenario, timeSeries.get());
+
+	//Stop all threads. Every blocking wait observes the stop token and returns immediately.
+	high_resolution_clock::time_point stopTime = high_resolution_clock::now();
+	stopSource.request_stop();
 
 	//Wait until all threads are terminated
-	for(std::thread t : stationThreads)
+	for(std::thread& t : stationThreads)
 	{
 		try
 		{
@@ -163,7 +1083,7 @@ int main() {
 	                     "[" << e.what() << "]\n";
 		}
 	}
-	for(std::thread t : executorThreads)
+	for(std::thread& t : executorThreads)
 	{
 		try
 		{
@@ -175,22 +1095,64 @@ int main() {
 		}
 	}
 
+	if (metricsThread.joinable())
+	{
+		metricsThread.join();
+	}
+
+	cout << "All threads stopped in "
+	     << duration_cast<microseconds>(high_resolution_clock::now() - stopTime).count() << " us\n";
+
 	//Print statistics report
-	PrintMiningTruckStatisticsReport(trucks);
-	PrintUnloadingStationStatisticsReport(stations);
+	std::ofstream csv;
+	if (!options.reportCsvFile.empty()) {
+		csv.open(options.reportCsvFile);
+		if (!csv) {
+			cout << "Cannot write report file " << options.reportCsvFile << "\n";
+		}
+	}
+	PrintMiningTruckStatisticsReport(trucks, csv.is_open() ? &csv : NULL);
+	PrintUnloadingStationStatisticsReport(stations, csv.is_open() ? &csv : NULL);
+	if (timeSeries) {
+		WriteTimeSeries(*timeSeries, options);
+	}
+	if (options.numaPlacement) {
+		PrintNumaPlacementReport(stations, nodeCount);
+	}
+	if (kBlockingQueueStatsEnabled) {
+		PrintQueueContentionReport(stations);
+	}
+	// Capacities come from the option or from the scenario, so the report follows the stations.
+	bool bounded = false;
+	for(UnloadingStation* station : stations) {
+		bounded = bounded || station->GetCapacity() != 0;
+	}
+	if (bounded) {
+		PrintAdmissionReport(stations, scenario.GetFactor());
+	}
+	if (!options.priorityClassPercents.empty()) {
+		PrintPriorityClassReport(stations, options.priorityClassPercents.size() + 1, scenario.GetFactor());
+	}
+	if (!options.traceFile.empty()) {
+		TraceRecorder::GetInstance()->PrintTimeAccountingReport(cout);
+		if (!TraceRecorder::GetInstance()->WriteChromeTrace(options.traceFile)) {
+			cout << "Cannot write trace file " << options.traceFile << "\n";
+		}
+	}
 
-	//Delete all allocated objects from heap.
+	//Destroy all the objects. Their condition variables own heap state, so destructors still run.
+	//The arena releases the memory of all of them at once when it goes out of scope.
 	for(UnloadingStation* station : stations)
 	{
-		delete station;
+		station->~UnloadingStation();
 	}
 	for(StateExecutor* executor : executors)
 	{
-		delete executor;
+		executor->~StateExecutor();
 	}
 	for(MiningTruck* truck : trucks)
 	{
-		delete truck;
+		truck->~MiningTruck();
 	}
 
 	return 0;
@@ -0,0 +1,99 @@
+/**
+ * @file  SimLibrary.cpp
+ *
+ * Library API implementation
+ */
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include "SimLibrary.h"
+#include "EventSimulation.h"
+
+SimRunResult RunScenario(const Scenario& scenario, uint64_t seed)
+{
+	EventSimulationConfig config;
+	config.scenario = &scenario;
+	config.seed = seed;
+	EventSimulation simulation(config);
+	simulation.Run();
+
+	SimRunResult result;
+	result.simulatedTime = simulation.GetSimulatedTime();
+	result.processedEvents = simulation.GetProcessedEventCount();
+	uint64_t totalQueueWaitTime = 0;
+	for (uint32_t i = 0; i < simulation.GetTruckCount(); ++i)
+	{
+		result.loadCount += simulation.GetTruck(i).loadCount;
+		totalQueueWaitTime += simulation.GetTruck(i).totalQueueWaitTime;
+	}
+	uint64_t totalBusyTime = 0;
+	for (uint32_t i = 0; i < simulation.GetStationCount(); ++i)
+	{
+		result.unloadCount += simulation.GetStation(i).unloadCount;
+		result.unloadedTonnes += simulation.GetStation(i).unloadedTonnes;
+		totalBusyTime += simulation.GetStation(i).busyTime;
+	}
+	if (result.simulatedTime)
+	{
+		result.unloadsPerHour = result.unloadCount * 3600000.0 / result.simulatedTime;
+		result.tonnesPerHour = result.unloadedTonnes * 3600000.0 / result.simulatedTime;
+		result.stationUtilization = (double)totalBusyTime / result.simulatedTime / simulation.GetStationCount();
+	}
+	if (result.unloadCount)
+	{
+		result.meanQueueWait = totalQueueWaitTime / 60000.0 / result.unloadCount;
+		result.p95QueueWait = simulation.GetQueueWaitPercentile(95) / 60000.0;
+	}
+	return result;
+}
+
+void RunScenarios(const std::vector<SimRunRequest>& requests, uint32_t threadCount,
+                  std::vector<SimRunResult>& results)
+{
+	results.assign(requests.size(), SimRunResult());
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::max<size_t>(1, std::min<size_t>(threadCount, requests.size()));
+	if (threadCount == 1)
+	{
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			results[i] = RunScenario(*requests[i].scenario, requests[i].seed);
+		}
+		return;
+	}
+
+	// A failure of a run is rethrown on the calling thread once every thread is joined.
+	std::vector<std::exception_ptr> failures(threadCount);
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&requests, &results, &failures, threadCount, t]() {
+			try
+			{
+				for (size_t i = t; i < requests.size(); i += threadCount)
+				{
+					results[i] = RunScenario(*requests[i].scenario, requests[i].seed);
+				}
+			}
+			catch (...)
+			{
+				failures[t] = std::current_exception();
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	for (const std::exception_ptr& failure : failures)
+	{
+		if (failure)
+		{
+			std::rethrow_exception(failure);
+		}
+	}
+}
@@ -0,0 +1,79 @@
+/**
+ * @file  SimLibrary.h
+ *
+ * This file contains the C++ API to run event driven simulations inside
+ * a calling process. Scenarios are built with Scenario::Create or
+ * Scenario::Load, and every run returns its results as a SimRunResult
+ * instead of printing them, so a pipeline runs batches of scenarios
+ * without spawning a process or parsing text per scenario.
+ * MiningSim.h wraps it in a C ABI.
+ */
+
+#ifndef SIMLIBRARY_H_
+#define SIMLIBRARY_H_
+
+#include <cstdint>
+#include <vector>
+#include "Scenario.h"
+
+/**
+ * One run of a batch
+ */
+struct SimRunRequest
+{
+	// Scenario to run. It must outlive the batch and may be shared by several requests.
+	const Scenario* scenario;
+	// Seed of the run
+	uint64_t seed;
+};
+
+/**
+ * Results of one run
+ */
+struct SimRunResult
+{
+	// Simulated time in milliseconds
+	uint64_t simulatedTime = 0;
+	// Number of events processed
+	uint64_t processedEvents = 0;
+	// Number of loads of all trucks
+	uint64_t loadCount = 0;
+	// Number of unloadings of all stations
+	uint64_t unloadCount = 0;
+	// Tonnes unloaded by all stations
+	uint64_t unloadedTonnes = 0;
+	// Unloadings per simulated hour
+	double unloadsPerHour = 0;
+	// Tonnes unloaded per simulated hour
+	double tonnesPerHour = 0;
+	// Mean station queue wait per unloading in minutes
+	double meanQueueWait = 0;
+	// 95th percentile of the station queue wait in minutes
+	double p95QueueWait = 0;
+	// Mean fraction of the simulated time the stations are unloading
+	double stationUtilization = 0;
+};
+
+/**
+ * Run a scenario with the event driven engine
+ *
+ * @param[in] scenario   Scenario to run
+ * @param[in] seed       Seed of the run
+ *
+ * @return    Results of the run
+ */
+SimRunResult RunScenario(const Scenario& scenario, uint64_t seed);
+
+/**
+ * Run a batch of scenarios on a number of threads. Runs are independent,
+ * so the results do not depend on the number of threads. A failure of a
+ * run, e.g. std::bad_alloc, is thrown once every thread is joined.
+ *
+ * @param[in]  requests      Runs of the batch
+ * @param[in]  threadCount   Most threads to use. 0 uses one per hardware thread.
+ * @param[out] results       Results in the order of the requests
+ */
+void RunScenarios(const std::vector<SimRunRequest>& requests, uint32_t threadCount,
+                  std::vector<SimRunResult>& results);
+
+#endif /* SIMLIBRARY_H_ */
@@ -0,0 +1,143 @@
+/**
+ * @file  SimMetrics.cpp
+ *
+ * SimMetrics class methods implementation
+ */
+
+#include <chrono>
+#include <cstdio>
+#include "SimMetrics.h"
+
+/**
+ * Get the steady clock time
+ *
+ * @return   Unsigned Integer  Nanoseconds of the steady clock
+ */
+static uint64_t GetSteadyNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SimMetrics* SimMetrics::GetInstance()
+{
+	static SimMetrics m_instance;
+	return &m_instance;
+}
+
+SimMetrics::SimMetrics()
+{
+	m_simulatedTime = 0;
+	m_clockStart = 0;
+	m_clockFactor = 1;
+	m_createTime = GetSteadyNanoseconds();
+	m_processedEvents = 0;
+	m_stationCount = 0;
+	m_rejectedArrivals = 0;
+	m_divertedArrivals = 0;
+	m_stagedTrucks = 0;
+	m_forecastCount = 0;
+	m_lastForecastLatency = 0;
+}
+
+void SimMetrics::SetStationCount(uint32_t stationCount)
+{
+	m_queueDepth.reset(new std::atomic<int64_t>[stationCount]);
+	for (uint32_t i = 0; i < stationCount; ++i)
+	{
+		m_queueDepth[i] = 0;
+	}
+	m_stationCount = stationCount;
+}
+
+void SimMetrics::StartRealTimeClock(uint32_t factor)
+{
+	m_clockFactor = factor;
+	m_clockStart = GetSteadyNanoseconds();
+}
+
+uint64_t SimMetrics::GetSimulatedTime() const
+{
+	const uint64_t clockStart = m_clockStart.load(std::memory_order_relaxed);
+	if (clockStart)
+	{
+		return (GetSteadyNanoseconds() - clockStart) / 1000000 * m_clockFactor;
+	}
+	return m_simulatedTime.load(std::memory_order_relaxed);
+}
+
+uint64_t SimMetrics::GetProcessedEvents() const
+{
+	return m_processedEvents.load(std::memory_order_relaxed);
+}
+
+void SimMetrics::WritePrometheus(std::string& out) const
+{
+	char line[256];
+	const double wallSeconds = (GetSteadyNanoseconds() - m_createTime) / 1e9;
+	const uint64_t events = GetProcessedEvents();
+
+	out += "# HELP mining_sim_simulated_seconds Simulated time since the start of the run.\n"
+	       "# TYPE mining_sim_simulated_seconds gauge\n";
+	snprintf(line, sizeof(line), "mining_sim_simulated_seconds %.3f\n", GetSimulatedTime() / 1000.0);
+	out += line;
+
+	out += "# HELP mining_sim_events_total Events processed by the simulation.\n"
+	       "# TYPE mining_sim_events_total counter\n";
+	snprintf(line, sizeof(line), "mining_sim_events_total %llu\n", (unsigned long long)events);
+	out += line;
+
+	out += "# HELP mining_sim_events_per_second Average event rate since the start of the process.\n"
+	       "# TYPE mining_sim_events_per_second gauge\n";
+	snprintf(line, sizeof(line), "mining_sim_events_per_second %.1f\n", wallSeconds > 0 ? events / wallSeconds : 0.0);
+	out += line;
+
+	out += "# HELP mining_sim_trucks Number of trucks per state.\n"
+	       "# TYPE mining_sim_trucks gauge\n";
+	for (uint32_t state = 0; state < kTruckStateCount; ++state)
+	{
+		snprintf(line, sizeof(line), "mining_sim_trucks{state=\"%s\"} %lld\n",
+				GetTruckStateName((TruckState)state),
+				(long long)m_truckStates[state].count.load(std::memory_order_relaxed));
+		out += line;
+	}
+
+	out += "# HELP mining_sim_station_queue_depth Number of trucks waiting in the station queue.\n"
+	       "# TYPE mining_sim_station_queue_depth gauge\n";
+	for (uint32_t i = 0; i < m_stationCount; ++i)
+	{
+		snprintf(line, sizeof(line), "mining_sim_station_queue_depth{station=\"%u\"} %lld\n",
+				i + 1, (long long)m_queueDepth[i].load(std::memory_order_relaxed));
+		out += line;
+	}
+
+	out += "# HELP mining_sim_rejected_arrivals_total Arrivals refused by a full station.\n"
+	       "# TYPE mining_sim_rejected_arrivals_total counter\n";
+	snprintf(line, sizeof(line), "mining_sim_rejected_arrivals_total %llu\n",
+			(unsigned long long)m_rejectedArrivals.load(std::memory_order_relaxed));
+	out += line;
+
+	out += "# HELP mining_sim_diverted_arrivals_total Trucks accepted after a better station refused them.\n"
+	       "# TYPE mining_sim_diverted_arrivals_total counter\n";
+	snprintf(line, sizeof(line), "mining_sim_diverted_arrivals_total %llu\n",
+			(unsigned long long)m_divertedArrivals.load(std::memory_order_relaxed));
+	out += line;
+
+	out += "# HELP mining_sim_staged_trucks Number of trucks held in the staging area.\n"
+	       "# TYPE mining_sim_staged_trucks gauge\n";
+	snprintf(line, sizeof(line), "mining_sim_staged_trucks %lld\n",
+			(long long)m_stagedTrucks.load(std::memory_order_relaxed));
+	out += line;
+
+	out += "# HELP mining_sim_forecasts_total Digital twin forecasts made.\n"
+	       "# TYPE mining_sim_forecasts_total counter\n";
+	snprintf(line, sizeof(line), "mining_sim_forecasts_total %llu\n",
+			(unsigned long long)m_forecastCount.load(std::memory_order_relaxed));
+	out += line;
+
+	out += "# HELP mining_sim_forecast_latency_seconds Time from telemetry arrival to the latest forecast.\n"
+	       "# TYPE mining_sim_forecast_latency_seconds gauge\n";
+	snprintf(line, sizeof(line), "mining_sim_forecast_latency_seconds %.6f\n",
+			m_lastForecastLatency.load(std::memory_order_relaxed) / 1e6);
+	out += line;
+}
@@ -0,0 +1,226 @@
+/**
+ * @file  SimMetrics.h
+ *
+ * This file contains SimMetrics class. It holds the live counters
+ * of the running simulation in atomics, so they can be read by the
+ * metrics exporter at any time without locking the simulation.
+ */
+
+#ifndef SIMMETRICS_H_
+#define SIMMETRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "MiningTruck.h"
+
+/**
+ * SimMetrics class
+ */
+class SimMetrics
+{
+public:
+	/**
+	 * Method to get the singleton instance of SimMetrics class.
+	 *
+	 * @return  Returns the singleton instance of SimMetrics class.
+	 */
+	static SimMetrics* GetInstance();
+	/**
+	 * Allocate the per-station counters. It must be called before
+	 * the stations are created.
+	 *
+	 * @param[in] stationCount   Number of unloading stations
+	 */
+	void SetStationCount(uint32_t stationCount);
+	/**
+	 * Derive the simulated time from the wall clock. It is used by the
+	 * threaded simulation, which runs kFactorValue times faster than real time.
+	 *
+	 * @param[in] factor   Speed up factor of the simulation
+	 */
+	void StartRealTimeClock(uint32_t factor);
+	/**
+	 * Set the simulated time. It is used by the event driven engine.
+	 *
+	 * @param[in] simulatedTime  Simulated time in milliseconds
+	 */
+	void SetSimulatedTime(uint64_t simulatedTime)
+	{
+		m_simulatedTime.store(simulatedTime, std::memory_order_relaxed);
+	}
+	/**
+	 * Count processed events. A state change of a threaded truck
+	 * counts as one event.
+	 *
+	 * @param[in] count  Number of events
+	 */
+	void AddProcessedEvents(uint64_t count)
+	{
+		m_processedEvents.fetch_add(count, std::memory_order_relaxed);
+	}
+	/**
+	 * Count a new truck in the given state
+	 *
+	 * @param[in] state  Initial state of the truck
+	 */
+	void AddTruck(TruckState state)
+	{
+		m_truckStates[state].count.fetch_add(1, std::memory_order_relaxed);
+	}
+	/**
+	 * Move a truck from one state to another
+	 *
+	 * @param[in] from   Previous state of the truck
+	 * @param[in] to     New state of the truck
+	 */
+	void MoveTruck(TruckState from, TruckState to)
+	{
+		m_truckStates[from].count.fetch_sub(1, std::memory_order_relaxed);
+		m_truckStates[to].count.fetch_add(1, std::memory_order_relaxed);
+	}
+	/**
+	 * Change the queue depth of a station
+	 *
+	 * @param[in] stationIndex  Zero based index of the station
+	 * @param[in] delta         Number of trucks added (positive) or removed (negative)
+	 */
+	void AddQueueDepth(uint32_t stationIndex, int64_t delta)
+	{
+		if (stationIndex < m_stationCount)
+		{
+			m_queueDepth[stationIndex].fetch_add(delta, std::memory_order_relaxed);
+		}
+	}
+	/**
+	 * Set the queue depth of a station
+	 *
+	 * @param[in] stationIndex  Zero based index of the station
+	 * @param[in] depth         Number of trucks in the queue
+	 */
+	void SetQueueDepth(uint32_t stationIndex, int64_t depth)
+	{
+		if (stationIndex < m_stationCount)
+		{
+			m_queueDepth[stationIndex].store(depth, std::memory_order_relaxed);
+		}
+	}
+	/**
+	 * Count an arrival refused by a full station
+	 */
+	void AddRejectedArrival()
+	{
+		m_rejectedArrivals.fetch_add(1, std::memory_order_relaxed);
+	}
+	/**
+	 * Count a truck accepted after a better station refused it
+	 */
+	void AddDivertedArrival()
+	{
+		m_divertedArrivals.fetch_add(1, std::memory_order_relaxed);
+	}
+	/**
+	 * Change the number of trucks held in the staging area
+	 *
+	 * @param[in] delta   Number of trucks added (positive) or removed (negative)
+	 */
+	void AddStagedTrucks(int64_t delta)
+	{
+		m_stagedTrucks.fetch_add(delta, std::memory_order_relaxed);
+	}
+	/**
+	 * Count a digital twin forecast
+	 *
+	 * @param[in] latency   Time from telemetry arrival to forecast in microseconds
+	 */
+	void AddForecast(uint64_t latency)
+	{
+		m_forecastCount.fetch_add(1, std::memory_order_relaxed);
+		m_lastForecastLatency.store(latency, std::memory_order_relaxed);
+	}
+	/**
+	 * Get the queue depth of a station
+	 *
+	 * @param[in] stationIndex  Zero based index of the station
+	 *
+	 * @return   Integer  Number of trucks in the queue
+	 */
+	int64_t GetQueueDepth(uint32_t stationIndex) const
+	{
+		return stationIndex < m_stationCount ? m_queueDepth[stationIndex].load(std::memory_order_relaxed) : 0;
+	}
+	/**
+	 * Get the number of trucks in a state
+	 *
+	 * @param[in] state  Truck state
+	 *
+	 * @return   Integer  Number of trucks
+	 */
+	int64_t GetTruckCount(TruckState state) const
+	{
+		return m_truckStates[state].count.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Get the simulated time
+	 *
+	 * @return   Unsigned Integer  Simulated time in milliseconds
+	 */
+	uint64_t GetSimulatedTime() const;
+	/**
+	 * Get the number of processed events
+	 *
+	 * @return   Unsigned Integer  Number of events
+	 */
+	uint64_t GetProcessedEvents() const;
+	/**
+	 * Write all the counters in Prometheus text exposition format
+	 *
+	 * @param[out] out   Text is appended to this string
+	 */
+	void WritePrometheus(std::string& out) const;
+
+private:
+	/**
+	 * Constructor
+	 */
+	SimMetrics();
+	/**
+	 * Counter on its own cache line, so truck threads updating
+	 * different states do not share a line.
+	 */
+	struct alignas(64) PaddedCounter
+	{
+		// Counter value
+		std::atomic<int64_t> count{0};
+	};
+
+	// Simulated time in milliseconds, when it is set explicitly
+	std::atomic<uint64_t> m_simulatedTime;
+	// Wall clock start in nanoseconds of steady clock. 0 if not started.
+	std::atomic<uint64_t> m_clockStart;
+	// Speed up factor of the wall clock
+	uint32_t m_clockFactor;
+	// Wall clock time in nanoseconds when the metrics are created
+	uint64_t m_createTime;
+	// Number of processed events
+	std::atomic<uint64_t> m_processedEvents;
+	// Number of trucks per state
+	PaddedCounter m_truckStates[kTruckStateCount];
+	// Number of stations
+	uint32_t m_stationCount;
+	// Queue depth per station
+	std::unique_ptr<std::atomic<int64_t>[]> m_queueDepth;
+	// Number of arrivals refused by a full station
+	std::atomic<uint64_t> m_rejectedArrivals;
+	// Number of trucks accepted after a better station refused them
+	std::atomic<uint64_t> m_divertedArrivals;
+	// Number of trucks held in the staging area
+	std::atomic<int64_t> m_stagedTrucks;
+	// Number of digital twin forecasts
+	std::atomic<uint64_t> m_forecastCount;
+	// Latency of the latest forecast in microseconds
+	std::atomic<uint64_t> m_lastForecastLatency;
+};
+
+#endif /* SIMMETRICS_H_ */
@@ -0,0 +1,557 @@
+/**
+ * @file  SimOptions.cpp
+ *
+ * This file contains the command line options parser implementation.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "SimOptions.h"
+#include "PriorityBlockingQueue.h"
+
+/**
+ * Print the usage of the simulation command line options
+ *
+ * @param[in] program   Name of the program
+ */
+static void PrintUsage(const char* program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+	          << "  --batch-unloading   Stations drain all queued trucks at once\n"
+	          << "  --priority-classes <p1,p2,..>  Put p1% of the trucks in the highest station\n"
+	          << "                      queue priority class, p2% in the next; the rest are normal\n"
+	          << "  --station-capacity <n>  A station holds at most <n> trucks; a full station diverts\n"
+	          << "                      arrivals to the next best one or to the staging area\n"
+	          << "  --numa-placement    Keep stations and their trucks on one NUMA node\n"
+	          << "  --event-driven      Run in simulated time on the event driven engine\n"
+	          << "  --gradients         Report d(throughput) and d(queue wait) with respect to the\n"
+	          << "                      unloading and travel times from the same event driven run\n"
+	          << "  --trace <file>      Write truck and station spans as Chrome trace JSON\n"
+	          << "  --trace-sample <n>  Trace every nth truck and station (default 1)\n"
+	          << "  --trace-limit <n>   Maximum spans kept per thread (default 1000000)\n"
+	          << "  --metrics-port <p>  Serve Prometheus metrics on 127.0.0.1:<p>\n"
+	          << "  --metrics-socket <path>  Serve Prometheus metrics on a Unix socket\n"
+	          << "  --report-csv <file> Write the truck and station statistics as CSV\n"
+	          << "  --timeseries <file> Record station queue depths and truck states as compressed\n"
+	          << "                      columns\n"
+	          << "  --timeseries-interval <minutes>  Simulated minutes between samples (default 5)\n"
+	          << "  --timeseries-plot <n>  Also write <file>.csv with n downsampled points per series\n"
+	          << "  --scenario <file>   Load trucks, stations and timings from a text or binary scenario\n"
+	          << "  --convert-scenario <file>  Write the scenario in binary format and exit\n"
+	          << "  --road-network <file>  Run trucks between the pits and dumps of a road network\n"
+	          << "  --checkpoint <file> Save the event driven engine state to <file> periodically\n"
+	          << "  --checkpoint-interval <hours>  Simulated hours between checkpoints (default 1)\n"
+	          << "  --restore <file>    Resume the event driven engine from a checkpoint\n"
+	          << "  --branch-at <hours> Simulated hour to fork the what-if variants at\n"
+	          << "  --branch <variant>  Run a variant from the branch point, e.g. base, stations+2,\n"
+	          << "                      trucks+5 or stations+1,trucks+3. Can be repeated.\n"
+	          << "  --compare <variant> Compare a variant with the scenario using common random numbers\n"
+	          << "  --replications <n>  Replications of each compared system (default 10)\n"
+	          << "  --early-stop <percent>  Discard the warm-up and stop once the steady-state\n"
+	          << "                      throughput is known within <percent>\n"
+	          << "  --sweep-stations <max>  Sweep station counts up to <max>, simulating only the\n"
+	          << "                      counts the analytical estimate cannot rule out\n"
+	          << "  --optimize-p95 <minutes>  Find the fewest stations whose p95 queue wait is\n"
+	          << "                      below <minutes>, using up to --replications runs per count\n"
+	          << "  --max-stations <n>  Largest station count the optimizer searches (default 32)\n"
+	          << "  --twin <file|->     Follow truck state telemetry and forecast after each update,\n"
+	          << "                      using --replications runs per forecast\n"
+	          << "  --forecast-hours <n>  Hours each digital twin forecast looks ahead (default 8)\n"
+	          << "  --shards <n>        Split the stations across <n> processes exchanging trucks\n"
+	          << "                      through shared memory\n"
+	          << "  --shard-memory <MiB>  Address space limit of each shard process\n";
+}
+
+/**
+ * Read the value which follows an option
+ *
+ * @param[in]     argc     Number of command line arguments
+ * @param[in]     argv     Command line arguments
+ * @param[in,out] index    Index of the option. It is moved to the value.
+ * @param[out]    value    Value of the option
+ *
+ * @return        bool     True if the value exists, otherwise False.
+ */
+static bool ReadOptionValue(int argc, char* argv[], int& index, std::string& value)
+{
+	if (index + 1 >= argc)
+	{
+		std::cout << "Missing value for option " << argv[index] << "\n";
+		return false;
+	}
+	value = argv[++index];
+	return true;
+}
+
+/**
+ * Read the positive integer value which follows an option
+ *
+ * @param[in]     argc     Number of command line arguments
+ * @param[in]     argv     Command line arguments
+ * @param[in,out] index    Index of the option. It is moved to the value.
+ * @param[out]    value    Value of the option
+ *
+ * @return        bool     True if the value is a positive integer, otherwise False.
+ */
+static bool ReadOptionValue(int argc, char* argv[], int& index, uint64_t& value)
+{
+	std::string text;
+	if (!ReadOptionValue(argc, argv, index, text))
+	{
+		return false;
+	}
+	char* end = NULL;
+	value = strtoull(text.c_str(), &end, 10);
+	if (text.empty() || *end != '\0' || value == 0)
+	{
+		std::cout << "Invalid value " << text << " for option " << argv[index - 1] << "\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Read the integer value which follows an option and check its range
+ *
+ * @param[in]     argc     Number of command line arguments
+ * @param[in]     argv     Command line arguments
+ * @param[in,out] index    Index of the option. It is moved to the value.
+ * @param[out]    value    Value of the option
+ * @param[in]     minimum  Smallest valid value
+ * @param[in]     maximum  Largest valid value
+ *
+ * @return        bool     True if the value is an integer in the range, otherwise False.
+ */
+static bool ReadOptionValue(int argc, char* argv[], int& index, uint64_t& value, uint64_t minimum, uint64_t maximum)
+{
+	if (!ReadOptionValue(argc, argv, index, value))
+	{
+		return false;
+	}
+	if (value < minimum || value > maximum)
+	{
+		std::cout << "Invalid value " << argv[index] << " for option " << argv[index - 1] << ", expected " << minimum
+		          << " to " << maximum << "\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Check that no given option is ignored by the engine or run mode the
+ * other options select
+ *
+ * @param[in] options   Parsed options
+ *
+ * @return    bool      True if all the options are used, otherwise False.
+ */
+static bool CheckOptionCombinations(const SimOptions& options)
+{
+	// Options only the threads of the default engine use
+	std::vector<const char*> threaded;
+	if (options.batchUnloading)
+	{
+		threaded.push_back("--batch-unloading");
+	}
+	if (!options.priorityClassPercents.empty())
+	{
+		threaded.push_back("--priority-classes");
+	}
+	if (options.stationCapacity)
+	{
+		threaded.push_back("--station-capacity");
+	}
+	if (options.numaPlacement)
+	{
+		threaded.push_back("--numa-placement");
+	}
+	if (!options.traceFile.empty())
+	{
+		threaded.push_back("--trace");
+	}
+	if (options.eventDriven && !threaded.empty())
+	{
+		std::cout << "Option " << threaded[0] << " is not supported by the event driven engine\n";
+		return false;
+	}
+
+	// Event driven run modes other than a single run, each of which ignores the options of a single run
+	std::vector<const char*> modes;
+	if (!options.twinFile.empty())
+	{
+		modes.push_back("--twin");
+	}
+	if (options.shards)
+	{
+		modes.push_back("--shards");
+	}
+	if (!options.compareVariant.empty())
+	{
+		modes.push_back("--compare");
+	}
+	if (options.optimizeWaitMinutes)
+	{
+		modes.push_back("--optimize-p95");
+	}
+	if (options.sweepStations)
+	{
+		modes.push_back("--sweep-stations");
+	}
+	if (!options.branches.empty())
+	{
+		modes.push_back("--branch");
+	}
+	if (modes.size() > 1)
+	{
+		std::cout << "Option " << modes[0] << " cannot be combined with " << modes[1] << "\n";
+		return false;
+	}
+
+	// Options only a single event driven run uses
+	std::vector<const char*> singleRun;
+	if (!options.checkpointFile.empty())
+	{
+		singleRun.push_back("--checkpoint");
+	}
+	if (!options.restoreFile.empty())
+	{
+		singleRun.push_back("--restore");
+	}
+	if (!options.timeSeriesFile.empty())
+	{
+		singleRun.push_back("--timeseries");
+	}
+	if (options.gradients)
+	{
+		singleRun.push_back("--gradients");
+	}
+	if (!options.reportCsvFile.empty())
+	{
+		singleRun.push_back("--report-csv");
+	}
+	if (options.earlyStopPercent)
+	{
+		singleRun.push_back("--early-stop");
+	}
+	if (!options.roadNetworkFile.empty())
+	{
+		singleRun.push_back("--road-network");
+	}
+	if (!modes.empty() && !singleRun.empty())
+	{
+		std::cout << "Option " << modes[0] << " cannot be combined with " << singleRun[0] << "\n";
+		return false;
+	}
+
+	// A run which stops early never reaches its checkpoints.
+	if (options.earlyStopPercent && !options.checkpointFile.empty())
+	{
+		std::cout << "Option --early-stop cannot be combined with --checkpoint\n";
+		return false;
+	}
+	// Checkpoints do not hold the perturbation analysis state.
+	if (options.gradients && (!options.checkpointFile.empty() || !options.restoreFile.empty()))
+	{
+		std::cout << "Option --gradients cannot be combined with "
+		          << (options.checkpointFile.empty() ? "--restore" : "--checkpoint") << "\n";
+		return false;
+	}
+	return true;
+}
+
+bool ParseSimOptions(int argc, char* argv[], SimOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string option = argv[i];
+		if (option == "--batch-unloading")
+		{
+			options.batchUnloading = true;
+		}
+		else if (option == "--priority-classes")
+		{
+			std::string value;
+			if (!ReadOptionValue(argc, argv, i, value))
+			{
+				return false;
+			}
+			options.priorityClassPercents.clear();
+			uint32_t total = 0;
+			std::istringstream percents(value);
+			std::string percent;
+			while (std::getline(percents, percent, ','))
+			{
+				char* end = NULL;
+				const unsigned long parsed = strtoul(percent.c_str(), &end, 10);
+				total += parsed;
+				if (percent.empty() || *end != '\0' || parsed == 0 || total > 100 ||
+				    options.priorityClassPercents.size() + 1 >= kMaxPriorityClasses)
+				{
+					std::cout << "Invalid value " << value << " for option " << option << "\n";
+					return false;
+				}
+				options.priorityClassPercents.push_back(parsed);
+			}
+		}
+		else if (option == "--station-capacity")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT32_MAX))
+			{
+				return false;
+			}
+			options.stationCapacity = value;
+		}
+		else if (option == "--report-csv")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.reportCsvFile))
+			{
+				return false;
+			}
+		}
+		else if (option == "--timeseries")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.timeSeriesFile))
+			{
+				return false;
+			}
+		}
+		else if (option == "--timeseries-interval")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT32_MAX))
+			{
+				return false;
+			}
+			options.timeSeriesIntervalMinutes = value;
+		}
+		else if (option == "--timeseries-plot")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 3, UINT32_MAX))
+			{
+				return false;
+			}
+			options.timeSeriesPlotPoints = value;
+		}
+		else if (option == "--numa-placement")
+		{
+			options.numaPlacement = true;
+		}
+		else if (option == "--event-driven")
+		{
+			options.eventDriven = true;
+		}
+		else if (option == "--gradients")
+		{
+			options.gradients = true;
+			options.eventDriven = true;
+		}
+		else if (option == "--trace")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.traceFile))
+			{
+				return false;
+			}
+		}
+		else if (option == "--trace-sample")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT32_MAX))
+			{
+				return false;
+			}
+			options.traceSampleInterval = value;
+		}
+		else if (option == "--trace-limit")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.traceLimit))
+			{
+				return false;
+			}
+		}
+		else if (option == "--metrics-port")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT16_MAX))
+			{
+				return false;
+			}
+			options.metricsPort = value;
+		}
+		else if (option == "--metrics-socket")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.metricsSocket))
+			{
+				return false;
+			}
+		}
+		else if (option == "--scenario")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.scenarioFile))
+			{
+				return false;
+			}
+		}
+		else if (option == "--convert-scenario")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.convertScenarioFile))
+			{
+				return false;
+			}
+		}
+		else if (option == "--road-network")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.roadNetworkFile))
+			{
+				return false;
+			}
+			options.eventDriven = true;
+		}
+		else if (option == "--checkpoint")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.checkpointFile))
+			{
+				return false;
+			}
+			options.eventDriven = true;
+		}
+		else if (option == "--checkpoint-interval")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT32_MAX))
+			{
+				return false;
+			}
+			options.checkpointIntervalHours = value;
+		}
+		else if (option == "--restore")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.restoreFile))
+			{
+				return false;
+			}
+			options.eventDriven = true;
+		}
+		else if (option == "--branch-at")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT32_MAX))
+			{
+				return false;
+			}
+			options.branchHour = value;
+		}
+		else if (option == "--branch")
+		{
+			std::string value;
+			if (!ReadOptionValue(argc, argv, i, value))
+			{
+				return false;
+			}
+			options.branches.push_back(value);
+			options.eventDriven = true;
+		}
+		else if (option == "--compare")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.compareVariant))
+			{
+				return false;
+			}
+			options.eventDriven = true;
+		}
+		else if (option == "--replications")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT32_MAX))
+			{
+				return false;
+			}
+			options.replications = value;
+		}
+		else if (option == "--early-stop")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, 100))
+			{
+				return false;
+			}
+			options.earlyStopPercent = value;
+			options.eventDriven = true;
+		}
+		else if (option == "--sweep-stations")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT16_MAX))
+			{
+				return false;
+			}
+			options.sweepStations = value;
+			options.eventDriven = true;
+		}
+		else if (option == "--optimize-p95")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT32_MAX))
+			{
+				return false;
+			}
+			options.optimizeWaitMinutes = value;
+			options.eventDriven = true;
+		}
+		else if (option == "--max-stations")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT16_MAX))
+			{
+				return false;
+			}
+			options.maxStations = value;
+		}
+		else if (option == "--twin")
+		{
+			if (!ReadOptionValue(argc, argv, i, options.twinFile))
+			{
+				return false;
+			}
+			options.eventDriven = true;
+		}
+		else if (option == "--forecast-hours")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT16_MAX))
+			{
+				return false;
+			}
+			options.forecastHours = value;
+		}
+		else if (option == "--shards")
+		{
+			uint64_t value;
+			if (!ReadOptionValue(argc, argv, i, value, 1, UINT16_MAX))
+			{
+				return false;
+			}
+			options.shards = value;
+			options.eventDriven = true;
+		}
+		else if (option == "--shard-memory")
+		{
+			// The limit is passed on in bytes, so it must fit 64 bits after the scaling.
+			if (!ReadOptionValue(argc, argv, i, options.shardMemoryMiB, 1, UINT64_MAX >> 20))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			std::cout << "Unknown option " << option << "\n";
+			PrintUsage(argv[0]);
+			return false;
+		}
+	}
+	return CheckOptionCombinations(options);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file  SimOptions.h
+ *
+ * This file contains SimOptions structure and the method
+ * to parse the command line options of the simulation.
+ */
+
+#ifndef SIMOPTIONS_H_
+#define SIMOPTIONS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Command line options of the simulation.
+ */
+struct SimOptions
+{
+	// Unloading stations drain all the queued trucks in one queue operation
+	bool batchUnloading = false;
+	// Percent of the trucks in each priority class above the normal class, highest first
+	std::vector<uint32_t> priorityClassPercents;
+	// Trucks a station holds in its queue and unloading bay. 0 is unbounded.
+	uint32_t stationCapacity = 0;
+	// Pin station and truck threads to NUMA nodes and allocate their data node locally
+	bool numaPlacement = false;
+	// Run the single threaded event driven engine instead of one thread per truck
+	bool eventDriven = false;
+	// Estimate throughput and queue wait sensitivities alongside the event driven run
+	bool gradients = false;
+	// Chrome trace output file. Tracing is disabled if it is empty.
+	std::string traceFile;
+	// Trace every Nth truck and station
+	uint32_t traceSampleInterval = 1;
+	// Maximum number of trace spans kept per thread
+	uint64_t traceLimit = 1000000;
+	// Local TCP port of the Prometheus metrics endpoint. 0 disables it.
+	uint16_t metricsPort = 0;
+	// Unix socket path of the Prometheus metrics endpoint. Empty disables it.
+	std::string metricsSocket;
+	// CSV file of the end-of-run truck and station statistics. Empty disables it.
+	std::string reportCsvFile;
+	// Compressed time series of the queue depths and truck states. Empty disables it.
+	std::string timeSeriesFile;
+	// Simulated minutes between two time series samples
+	uint32_t timeSeriesIntervalMinutes = 5;
+	// Points per series of the downsampled CSV view. 0 disables the view.
+	uint32_t timeSeriesPlotPoints = 0;
+	// Scenario file. Counts are asked from the user if it is empty.
+	std::string scenarioFile;
+	// Write the scenario in the binary format to this file and exit
+	std::string convertScenarioFile;
+	// Road network of pits and dumps for the event driven engine. Empty keeps a single site.
+	std::string roadNetworkFile;
+	// Checkpoint file of the event driven engine. Empty disables checkpoints.
+	std::string checkpointFile;
+	// Simulated hours between two checkpoints
+	uint32_t checkpointIntervalHours = 1;
+	// Checkpoint file to resume the event driven engine from
+	std::string restoreFile;
+	// Simulated hour to fork the what-if variants at
+	uint32_t branchHour = 0;
+	// What-if variants run from the branch point, e.g. "stations+2"
+	std::vector<std::string> branches;
+	// What-if variant compared with the scenario over replications
+	std::string compareVariant;
+	// Number of replications of each compared system, and the most
+	// replications the optimizer runs for one station count
+	uint32_t replications = 10;
+	// Stop once the steady-state throughput is known within this percent. 0 runs the full time.
+	uint32_t earlyStopPercent = 0;
+	// Sweep the station count from the scenario count up to this count. 0 disables the sweep.
+	uint32_t sweepStations = 0;
+	// Find the fewest stations whose p95 queue wait is below this many minutes. 0 disables it.
+	uint32_t optimizeWaitMinutes = 0;
+	// Largest station count the optimizer searches
+	uint32_t maxStations = 32;
+	// Telemetry of truck state changes the digital twin follows, "-" for stdin. Empty disables it.
+	std::string twinFile;
+	// Simulated hours each digital twin forecast looks ahead
+	uint32_t forecastHours = 8;
+	// Processes the stations are split across. 0 runs in this process.
+	uint32_t shards = 0;
+	// Address space limit of each shard process in MiB. 0 is unlimited.
+	uint64_t shardMemoryMiB = 0;
+};
+
+/**
+ * Parse the command line options of the simulation.
+ * Usage is printed if an unknown option is given.
+ *
+ * @param[in]  argc     Number of command line arguments
+ * @param[in]  argv     Command line arguments
+ * @param[out] options  Parsed options
+ *
+ * @return    bool      True if all the options are valid, otherwise False.
+ */
+bool ParseSimOptions(int argc, char* argv[], SimOptions& options);
+
+#endif /* SIMOPTIONS_H_ */
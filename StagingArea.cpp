@@ -0,0 +1,87 @@
+/**
+ * @file  StagingArea.cpp
+ *
+ * StagingArea class methods implementation
+ */
+
+#include <algorithm>
+#include <chrono>
+#include "StagingArea.h"
+#include "SimMetrics.h"
+
+StagingArea* StagingArea::GetInstance()
+{
+	static StagingArea m_instance;
+	return &m_instance;
+}
+
+StagingArea::StagingArea()
+{
+	m_generation = 0;
+	m_occupancy = 0;
+	m_maxOccupancy = 0;
+	m_holdCount = 0;
+	m_totalHoldTime = 0;
+}
+
+uint64_t StagingArea::GetGeneration() const
+{
+	return m_generation.load(std::memory_order_acquire);
+}
+
+bool StagingArea::Hold(uint64_t generation, std::stop_token stopToken)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		std::unique_lock<std::mutex> lock(m_guard);
+		m_occupancy++;
+		if (m_occupancy > m_maxOccupancy)
+		{
+			m_maxOccupancy = m_occupancy;
+		}
+		SimMetrics::GetInstance()->AddStagedTrucks(1);
+		m_signal.wait(lock, stopToken, [this, generation] { return m_generation != generation; });
+		m_occupancy--;
+		SimMetrics::GetInstance()->AddStagedTrucks(-1);
+	}
+	m_totalHoldTime.fetch_add(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+	return !stopToken.stop_requested();
+}
+
+void StagingArea::NotifySlotFreed(uint64_t count)
+{
+	uint64_t held;
+	{
+		// The generation is changed under the lock, so a truck cannot miss it
+		// between checking the predicate and going to sleep.
+		std::unique_lock<std::mutex> lock(m_guard);
+		m_generation.fetch_add(count, std::memory_order_release);
+		held = m_occupancy;
+	}
+	// Only as many trucks as there are free slots race for them. The others sleep on.
+	for (uint64_t i = 0; i < std::min(count, held); ++i)
+	{
+		m_signal.notify_one();
+	}
+}
+
+void StagingArea::CountHeldArrival()
+{
+	m_holdCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t StagingArea::GetHoldCount() const
+{
+	return m_holdCount.load(std::memory_order_relaxed);
+}
+
+uint64_t StagingArea::GetTotalHoldTime() const
+{
+	return m_totalHoldTime.load(std::memory_order_relaxed);
+}
+
+uint64_t StagingArea::GetMaxOccupancy() const
+{
+	return m_maxOccupancy.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,102 @@
+/**
+ * @file  StagingArea.h
+ *
+ * This file contains StagingArea class. Trucks which find every
+ * station queue full wait here until a station frees a slot.
+ */
+
+#ifndef STAGINGAREA_H_
+#define STAGINGAREA_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+#include <condition_variable>
+
+/**
+ * StagingArea class
+ */
+class StagingArea
+{
+public:
+	/**
+	 * Method to get the singleton instance of StagingArea class.
+	 *
+	 * @return  Returns the singleton instance of StagingArea class.
+	 */
+	static StagingArea* GetInstance();
+	/**
+	 * Get the number of slots freed so far. A truck reads it before
+	 * it tries the stations, so a slot freed between its last try and
+	 * Hold is not missed.
+	 *
+	 * @return   Unsigned Integer  Generation of the free slots
+	 */
+	uint64_t GetGeneration() const;
+	/**
+	 * Hold the truck until a station frees a slot after the given
+	 * generation or stop is requested. The time held is added to the
+	 * total hold time.
+	 *
+	 * @param[in] generation  Generation read before the stations were tried
+	 * @param[in] stopToken   Stop token of the simulation
+	 *
+	 * @return    bool        True if a slot is freed, otherwise
+	 *                        False if stop is requested
+	 */
+	bool Hold(uint64_t generation, std::stop_token stopToken);
+	/**
+	 * Wake up one held truck for every freed slot. It is called by a
+	 * bounded station whenever it takes trucks out of its queue.
+	 *
+	 * @param[in] count   Number of freed slots
+	 */
+	void NotifySlotFreed(uint64_t count);
+	/**
+	 * Count an arrival which is held. It is called once per arrival,
+	 * however many times the truck is held before a station takes it.
+	 */
+	void CountHeldArrival();
+	/**
+	 * Get the number of arrivals which are held
+	 *
+	 * @return   Unsigned Integer  Number of holds
+	 */
+	uint64_t GetHoldCount() const;
+	/**
+	 * Get the total time spent by the trucks in the staging area
+	 *
+	 * @return   Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t GetTotalHoldTime() const;
+	/**
+	 * Get the largest number of trucks held at the same time
+	 *
+	 * @return   Unsigned Integer  Number of trucks
+	 */
+	uint64_t GetMaxOccupancy() const;
+
+private:
+	/**
+	 * Constructor
+	 */
+	StagingArea();
+
+	//Mutex object used by conditional variable m_signal
+	std::mutex m_guard;
+	//Conditional variable which wakes up the held trucks
+	std::condition_variable_any m_signal;
+	//Number of slot freed notifications. It is changed while m_guard is held.
+	std::atomic<uint64_t> m_generation;
+	//Number of trucks held now. It is changed while m_guard is held.
+	uint64_t m_occupancy;
+	//Largest value of m_occupancy
+	std::atomic<uint64_t> m_maxOccupancy;
+	//Number of arrivals which are held
+	std::atomic<uint64_t> m_holdCount;
+	//Total hold time in milliseconds
+	std::atomic<uint64_t> m_totalHoldTime;
+};
+
+#endif /* STAGINGAREA_H_ */
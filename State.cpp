@@ -5,38 +5,55 @@
  */
 
 #include <limits.h>
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include "State.h"
+#include "Constants.h"
+#include "StagingArea.h"
+#include "TraceRecorder.h"
 
 
 void State::Handle(MiningTruck* const truck, std::vector<UnloadingStation*>& unloadingStations)
 {
+	TraceScope scope(TraceTrack::truck, truck->GetTruckId(), GetTruckStateName(truck->GetTruckState()));
 	DoTask(truck, unloadingStations);
 	truck->SetTruckState(NextTruckState());
 }
 
-virtual void State::DoTask(MiningTruck* const truck, std::vector<UnloadingStation*>& unloadingStations)
+void State::DoTask(MiningTruck* const truck, std::vector<UnloadingStation*>& unloadingStations)
 {
 	//Some state do nothing.
 }
 
-static Empty* Empty::GetInstance()
+State::~State()
+{
+}
+
+Empty* Empty::GetInstance()
 {
 	static Empty m_instance;
 	return &m_instance;
 }
+
+Empty::~Empty()
+{
+}
 TruckState Empty::NextTruckState()
 {
 	return TruckState::travel_to_mine_site;
 }
 
-static TravelToMineSite* TravelToMineSite::GetInstance()
+TravelToMineSite* TravelToMineSite::GetInstance()
 {
 	static TravelToMineSite m_instance;
 	return &m_instance;
 }
 
+TravelToMineSite::~TravelToMineSite()
+{
+}
+
 void TravelToMineSite::DoTask(MiningTruck* const truck, std::vector<UnloadingStation*>& unloadingStations)
 {
 	if (truck->Wait(MiningTruck::GetTravelTime()))
@@ -50,12 +67,16 @@ TruckState TravelToMineSite::NextTruckState()
 	return TruckState::approaching_to_mine_site;
 }
 
-static TravelToUnloadingStation* TravelToUnloadingStation::GetInstance()
+TravelToUnloadingStation* TravelToUnloadingStation::GetInstance()
 {
 	static TravelToUnloadingStation m_instance;
 	return &m_instance;
 }
 
+TravelToUnloadingStation::~TravelToUnloadingStation()
+{
+}
+
 void TravelToUnloadingStation::DoTask(MiningTruck* const truck, std::vector<UnloadingStation*>& unloadingStations)
 {
 	if (truck->Wait(MiningTruck::GetTravelTime()))
@@ -69,33 +90,45 @@ TruckState TravelToUnloadingStation::NextTruckState()
 	return TruckState::approaching_unloading_station;
 }
 
-static ApproachingToMineSite* ApproachingToMineSite::GetInstance()
+ApproachingToMineSite* ApproachingToMineSite::GetInstance()
 {
 	static ApproachingToMineSite m_instance;
 	return &m_instance;
 }
+
+ApproachingToMineSite::~ApproachingToMineSite()
+{
+}
 TruckState ApproachingToMineSite::NextTruckState()
 {
 	return TruckState::loading_mine;
 }
 
-static ApproachingToUnloadingStation* ApproachingToUnloadingStation::GetInstance()
+ApproachingToUnloadingStation* ApproachingToUnloadingStation::GetInstance()
 {
 	static ApproachingToUnloadingStation m_instance;
 	return &m_instance;
 }
 
+ApproachingToUnloadingStation::~ApproachingToUnloadingStation()
+{
+}
+
 TruckState ApproachingToUnloadingStation::NextTruckState()
 {
-	return TruckState::unloading;
+	return TruckState::waiting_in_queue;
 }
 
-static LoadingMine* LoadingMine::GetInstance()
+LoadingMine* LoadingMine::GetInstance()
 {
 	static LoadingMine m_instance;
 	return &m_instance;
 }
 
+LoadingMine::~LoadingMine()
+{
+}
+
 void LoadingMine::DoTask(MiningTruck* const truck, std::vector<UnloadingStation*>& unloadingStations)
 {
 	uint64_t loadingTime = MiningTruck::GetLoadingTime();
@@ -110,16 +143,22 @@ TruckState LoadingMine::NextTruckState()
 	return TruckState::travel_to_unloading_station;
 }
 
-static Unloading* Unloading::GetInstance()
+Unloading* Unloading::GetInstance()
 {
 	static Unloading m_instance;
 	return &m_instance;
 }
 
+Unloading::~Unloading()
+{
+}
+
 void Unloading::DoTask(MiningTruck* const truck, std::vector<UnloadingStation*>& unloadingStations)
 {
-	truck->WaitForUnloadingCompletion();
-	truck->IncrementUnloadCount();
+	if (truck->WaitForUnloadingCompletion())
+	{
+		truck->IncrementUnloadCount();
+	}
 }
 
 TruckState Unloading::NextTruckState()
@@ -127,30 +166,85 @@ TruckState Unloading::NextTruckState()
 	return TruckState::empty;
 }
 
-static WaitingInQueue* WaitingInQueue::GetInstance()
+WaitingInQueue* WaitingInQueue::GetInstance()
 {
 	static WaitingInQueue m_instance;
 	return &m_instance;
 }
 
+WaitingInQueue::~WaitingInQueue()
+{
+}
+
 void WaitingInQueue::DoTask(MiningTruck* const truck, std::vector<UnloadingStation*>& unloadingStations)
 {
-	uint64_t shortWaitTime = INT_MAX;
-	UnloadingStation* stationToUnload = NULL;
-	for(UnloadingStation* station : unloadingStations)
+	// Stations ordered by waiting time. It is reused by the trucks served on this thread.
+	static thread_local std::vector<std::pair<uint64_t, UnloadingStation*>> ranking;
+	StagingArea* const stagingArea = StagingArea::GetInstance();
+	// A station on another NUMA node is only taken if it saves more than this much waiting.
+	const uint64_t remotePenalty = (uint64_t)MiningTruck::GetUnloadingTime() * kNumaRemoteWaitPenaltyPercent / 100;
+	bool diverted = false;
+	// The arrival counts as rejected and held once, however many stations refuse it.
+	bool rejected = false;
+	bool held = false;
+	while (true)
 	{
-		uint64_t waitTime = station->GetWaitingTime();
-		if (waitTime < shortWaitTime) {
-			stationToUnload = station;
-			shortWaitTime = waitTime;
+		// Read before the stations are tried, so a slot freed meanwhile wakes up Hold at once.
+		const uint64_t generation = stagingArea->GetGeneration();
+		ranking.clear();
+		for(UnloadingStation* station : unloadingStations)
+		{
+			uint64_t waitTime = station->GetWaitingTime(truck->GetPriorityClass());
+			if (station->GetNumaNode() != truck->GetNumaNode())
+			{
+				waitTime += remotePenalty;
+			}
+			ranking.emplace_back(waitTime, station);
 		}
-	}
-	if (stationToUnload) {
-		stationToUnload->PushToQueue(truck);
+		// Remote stations carry the penalty. On equal waiting time, the own node still wins.
+		std::stable_sort(ranking.begin(), ranking.end(),
+				[truck](const std::pair<uint64_t, UnloadingStation*>& a, const std::pair<uint64_t, UnloadingStation*>& b)
+				{
+					if (a.first != b.first)
+					{
+						return a.first < b.first;
+					}
+					return a.second->GetNumaNode() == truck->GetNumaNode() &&
+						b.second->GetNumaNode() != truck->GetNumaNode();
+				});
+		// A full station refuses the truck, then it is diverted to the next best one.
+		for (const std::pair<uint64_t, UnloadingStation*>& candidate : ranking)
+		{
+			if (candidate.second->TryPushToQueue(truck, diverted))
+			{
+				return;
+			}
+			if (!rejected)
+			{
+				candidate.second->CountRejectedArrival();
+				rejected = true;
+			}
+			diverted = true;
+		}
+		// Every station is full. Hold the truck in the staging area until a slot is freed.
+		if (ranking.empty())
+		{
+			return;
+		}
+		if (!held)
+		{
+			stagingArea->CountHeldArrival();
+			held = true;
+		}
+		if (!stagingArea->Hold(generation, truck->GetStopToken()))
+		{
+			return;
+		}
+		diverted = false;
 	}
 }
 
 TruckState WaitingInQueue::NextTruckState()
 {
-	return TruckState::empty;
+	return TruckState::unloading;
 }
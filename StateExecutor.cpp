@@ -5,6 +5,11 @@
  */
 #include "StateExecutor.h"
 
+StateExecutor::StateExecutor(std::stop_token stopToken)
+{
+	m_stopToken = stopToken;
+}
+
 State* StateExecutor::GetStateInstance(TruckState truckState)
 {
 	State* stateInstance = NULL;
@@ -15,26 +20,42 @@ State* StateExecutor::GetStateInstance(TruckState truckState)
 		case TruckState::travel_to_mine_site:
 			stateInstance = TravelToMineSite::GetInstance();
 			break;
-		// add case for all enumeration values.
+		case TruckState::travel_to_unloading_station:
+			stateInstance = TravelToUnloadingStation::GetInstance();
+			break;
+		case TruckState::approaching_to_mine_site:
+			stateInstance = ApproachingToMineSite::GetInstance();
+			break;
+		case TruckState::loading_mine:
+			stateInstance = LoadingMine::GetInstance();
+			break;
+		case TruckState::approaching_unloading_station:
+			stateInstance = ApproachingToUnloadingStation::GetInstance();
+			break;
+		case TruckState::unloading:
+			stateInstance = Unloading::GetInstance();
+			break;
+		case TruckState::waiting_in_queue:
+			stateInstance = WaitingInQueue::GetInstance();
+			break;
 		default:
 			break;
 	}
 	return stateInstance;
 }
 
-void StateExecutor::StopSimulation()
-{
-	m_stopSim = true;
-}
-
 void StateExecutor::execute(MiningTruck* const truck, std::vector<UnloadingStation*> unloadingStations)
 {
-	while (!m_stopSim)
+	while (!m_stopToken.stop_requested())
 	{
 		State* const stateInstance = GetStateInstance(truck->GetTruckState());
-		if (stateInstance)
+		if (!stateInstance)
 		{
-			stateInstance->Handle(truck, unloadingStations);
+			// Nothing can move the truck out of a state without handler, so stop instead of spinning.
+			std::cout << "Truck " << *truck << " has no handler for state "
+			          << GetTruckStateName(truck->GetTruckState()) << "\n";
+			break;
 		}
+		stateInstance->Handle(truck, unloadingStations);
 	}
 }
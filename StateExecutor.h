@@ -9,12 +9,21 @@
 #include "MiningTruck.h"
 #include "UnloadingStation.h"
 #include "State.h"
+#include <stop_token>
 
 class StateExecutor
 {
 public:
     /**
-	* Executes the work for the given truck.
+     * Constructor
+     *
+     * @param[in] stopToken  Stop token of the simulation. execute returns
+     *                       once stop is requested.
+     */
+    StateExecutor(std::stop_token stopToken);
+    /**
+	* Executes the work for the given truck. It returns once stop is requested,
+	* or at once if the truck is in a state which has no handler.
 	*
 	* @param[in] truck               MiningTruck object which should be handled.
 	* @param[in] unloadingStations   List of UnloadingStation objects. It is used to get
@@ -22,10 +31,6 @@ public:
 	*                                queue of that station.
 	*/
     void execute(MiningTruck* const truck, std::vector<UnloadingStation*> unloadingStations);
-    /**
-     * Method to stop the simulation.
-     */
-    void StopSimulation();
 private:
 	/**
 	 * Get the instance of State's derived class based truck's current state
@@ -35,7 +40,7 @@ private:
 	 * @return    Instance of State object based on the current state
 	 */
     State* GetStateInstance(TruckState truckState);
-    // Variable to stop the thread
-    volatile bool m_stopSim;
+    // Stop token to stop the thread
+    std::stop_token m_stopToken;
 };
 #endif /* STATEEXECUTOR_H_ */
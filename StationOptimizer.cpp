@@ -0,0 +1,175 @@
+/**
+ * @file  StationOptimizer.cpp
+ *
+ * StationOptimizer class methods implementation
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+#include "StationOptimizer.h"
+#include "EventSimulation.h"
+
+// Replications of a count before its first verdict
+static const uint32_t kInitialReplications = 4;
+// Normal quantile of a two sided 95% confidence interval
+static const double kConfidenceQuantile = 1.96;
+// Percentile of the queue wait the limit applies to
+static const double kWaitPercentile = 95;
+
+/**
+ * Build a scenario which keeps only the first stations of another one
+ *
+ * @param[in]  scenario       Scenario to copy
+ * @param[in]  stationCount   Number of stations kept. It is at least 1.
+ * @param[out] reduced        Copy with the kept stations
+ */
+static void CreateReducedScenario(const Scenario& scenario, uint32_t stationCount, Scenario& reduced)
+{
+	std::vector<ScenarioDistribution> distributions;
+	for (uint32_t i = 0; i < scenario.GetDistributionCount(); ++i)
+	{
+		distributions.push_back(scenario.GetDistribution(i));
+	}
+	std::vector<ScenarioStation> stations;
+	for (uint32_t i = 0; i < stationCount; ++i)
+	{
+		stations.push_back(scenario.GetStation(i));
+	}
+	std::vector<ScenarioTruck> trucks;
+	for (uint32_t i = 0; i < scenario.GetTruckCount(); ++i)
+	{
+		trucks.push_back(scenario.GetTruck(i));
+	}
+	std::vector<ScenarioTruckClass> truckClasses;
+	for (uint32_t i = 0; i < scenario.GetTruckClassCount(); ++i)
+	{
+		truckClasses.push_back(scenario.GetTruckClass(i));
+	}
+	// The first stations of a valid scenario make a valid one, so the validation cannot fail.
+	std::string error;
+	reduced.Create(scenario.GetSimulationTime(), scenario.GetSeed(), distributions, stations, trucks, truckClasses, error);
+}
+
+StationOptimizer::StationOptimizer(const Scenario& scenario, uint64_t waitLimit, uint32_t maxStations, uint32_t maxReplications)
+	: m_scenario(scenario)
+{
+	m_waitLimit = waitLimit;
+	m_maxStations = std::max(maxStations, scenario.GetStationCount());
+	m_maxReplications = std::max(maxReplications, kInitialReplications);
+	m_runCount = 0;
+}
+
+uint32_t StationOptimizer::Run()
+{
+	// Invariant: counts below low fail, high meets the limit. The queue wait falls with
+	// every added station, so bisection needs only the log of the range in verdicts.
+	uint32_t low = 1;
+	uint32_t high = m_maxStations;
+	if (!Evaluate(high).meetsLimit)
+	{
+		return 0;
+	}
+	while (low < high)
+	{
+		const uint32_t middle = low + (high - low) / 2;
+		if (Evaluate(middle).meetsLimit)
+		{
+			high = middle;
+		}
+		else
+		{
+			low = middle + 1;
+		}
+	}
+	return high;
+}
+
+const std::vector<StationVerdict>& StationOptimizer::GetVerdicts() const
+{
+	return m_verdicts;
+}
+
+uint32_t StationOptimizer::GetRunCount() const
+{
+	return m_runCount;
+}
+
+StationVerdict StationOptimizer::Evaluate(uint32_t stationCount)
+{
+	StationVerdict verdict = {};
+	verdict.stationCount = stationCount;
+	std::vector<double>& waits = m_replicationWaits[stationCount];
+	if (waits.size() < kInitialReplications)
+	{
+		AddReplications(stationCount, kInitialReplications - waits.size());
+	}
+	while (true)
+	{
+		const double count = waits.size();
+		double sum = 0;
+		for (double wait : waits)
+		{
+			sum += wait;
+		}
+		verdict.meanWait = sum / count;
+		double sumOfSquares = 0;
+		for (double wait : waits)
+		{
+			sumOfSquares += (wait - verdict.meanWait) * (wait - verdict.meanWait);
+		}
+		verdict.halfWidth = kConfidenceQuantile * std::sqrt(sumOfSquares / (count - 1) / count);
+		verdict.replications = waits.size();
+		verdict.meetsLimit = verdict.meanWait < m_waitLimit;
+		verdict.settled = std::fabs(verdict.meanWait - m_waitLimit) > verdict.halfWidth;
+		if (verdict.settled || waits.size() >= m_maxReplications)
+		{
+			break;
+		}
+		// Double the replications, so an unsettled count costs a few rounds at most.
+		AddReplications(stationCount, std::min<uint32_t>(waits.size(), m_maxReplications - waits.size()));
+	}
+	m_verdicts.push_back(verdict);
+	return verdict;
+}
+
+void StationOptimizer::AddReplications(uint32_t stationCount, uint32_t count)
+{
+	// Replication r uses the same common random numbers for every station count,
+	// so the counts are compared on the same truck draws.
+	std::vector<double>& waits = m_replicationWaits[stationCount];
+	const uint32_t first = waits.size();
+	// Counts below the scenario count run on a copy with its first stations, larger counts add stations.
+	Scenario reduced;
+	const Scenario* scenario = &m_scenario;
+	if (stationCount < m_scenario.GetStationCount())
+	{
+		CreateReducedScenario(m_scenario, stationCount, reduced);
+		scenario = &reduced;
+	}
+	waits.resize(first + count);
+	std::vector<std::thread> threads;
+	const uint32_t threadCount = std::max(1u, std::min(count, std::thread::hardware_concurrency()));
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([this, &waits, scenario, stationCount, first, count, threadCount, t]() {
+			for (uint32_t i = t; i < count; i += threadCount)
+			{
+				EventSimulationConfig config;
+				config.scenario = scenario;
+				config.seed = m_scenario.GetSeed() + first + i;
+				config.commonRandomNumbers = true;
+				EventSimulation simulation(config);
+				simulation.AddStations(stationCount - scenario->GetStationCount());
+				simulation.Run();
+				waits[first + i] = simulation.GetQueueWaitPercentile(kWaitPercentile);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	m_runCount += count;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file  StationOptimizer.h
+ *
+ * This file contains StationOptimizer class. It finds the fewest
+ * unloading stations for which the 95th percentile of the station
+ * queue wait of the scenario fleet stays below a limit. Simulation
+ * runs are the objective: the station count is bisected from one
+ * station up, counts below the scenario's keep its first stations and
+ * larger counts add copies of its first station. Each count gets
+ * replications until a confidence interval of its mean p95 wait is on
+ * one side of the limit, and replications of a count are kept and
+ * reused whenever the search comes back to it.
+ */
+
+#ifndef STATIONOPTIMIZER_H_
+#define STATIONOPTIMIZER_H_
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Scenario.h"
+
+/**
+ * Verdict on one station count
+ */
+struct StationVerdict
+{
+	// Number of stations
+	uint32_t stationCount;
+	// Number of replications run for the count
+	uint32_t replications;
+	// Mean of the p95 queue waits of the replications in milliseconds
+	double meanWait;
+	// 95% confidence half-width of the mean in milliseconds
+	double halfWidth;
+	// True if the count meets the limit
+	bool meetsLimit;
+	// True if the confidence interval excludes the limit
+	bool settled;
+};
+
+/**
+ * StationOptimizer class
+ */
+class StationOptimizer
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] scenario         Scenario with the fleet. It must outlive the object.
+	 * @param[in] waitLimit        Limit of the p95 queue wait in milliseconds
+	 * @param[in] maxStations      Largest station count searched
+	 * @param[in] maxReplications  Largest number of replications of a count
+	 */
+	StationOptimizer(const Scenario& scenario, uint64_t waitLimit, uint32_t maxStations, uint32_t maxReplications);
+	/**
+	 * Search the fewest stations which meet the limit
+	 *
+	 * @return    Unsigned Integer  Station count. 0 if even the largest
+	 *                              count does not meet the limit.
+	 */
+	uint32_t Run();
+	/**
+	 * Get the verdicts of the evaluated station counts in search order
+	 *
+	 * @return    Verdicts
+	 */
+	const std::vector<StationVerdict>& GetVerdicts() const;
+	/**
+	 * Get the total number of simulation runs done by the search
+	 *
+	 * @return    Unsigned Integer  Number of runs
+	 */
+	uint32_t GetRunCount() const;
+
+private:
+	/**
+	 * Run replications of a station count until its verdict is settled
+	 * or the replication limit is reached
+	 *
+	 * @param[in] stationCount   Number of stations
+	 *
+	 * @return    Verdict of the count
+	 */
+	StationVerdict Evaluate(uint32_t stationCount);
+	/**
+	 * Run replications of a station count in parallel and keep their p95 waits
+	 *
+	 * @param[in] stationCount   Number of stations
+	 * @param[in] count          Number of replications to add
+	 */
+	void AddReplications(uint32_t stationCount, uint32_t count);
+
+	// Scenario with the fleet
+	const Scenario& m_scenario;
+	// Limit of the p95 queue wait in milliseconds
+	uint64_t m_waitLimit;
+	// Largest station count searched
+	uint32_t m_maxStations;
+	// Largest number of replications of a count
+	uint32_t m_maxReplications;
+	// p95 queue waits of the replications of every evaluated count
+	std::map<uint32_t, std::vector<double>> m_replicationWaits;
+	// Verdicts in search order
+	std::vector<StationVerdict> m_verdicts;
+	// Total number of simulation runs
+	uint32_t m_runCount;
+};
+
+#endif /* STATIONOPTIMIZER_H_ */
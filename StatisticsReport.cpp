@@ -0,0 +1,254 @@
+/**
+ * @file  StatisticsReport.cpp
+ *
+ * StatisticsReport class methods implementation
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+#include "StatisticsReport.h"
+
+// Independent accumulators of the reduction loops. They let the compiler keep
+// one vector register of partial results instead of a serial dependency chain.
+static const uint32_t kReductionLanes = 8;
+// Smallest number of values per thread worth splitting a reduction over threads
+static const size_t kParallelReductionSlice = 1 << 18;
+
+/**
+ * Count, mean and sum of squared deviations of a slice of a counter
+ * array. Slices are merged with the pairwise update of Chan et al.,
+ * which stays accurate where sums of squares would cancel.
+ */
+struct CounterMoments
+{
+	// Number of values
+	uint64_t count = 0;
+	// Sum of the values
+	uint64_t total = 0;
+	// Mean of the values
+	double mean = 0;
+	// Sum of the squared deviations from the mean
+	double squaredDeviations = 0;
+	// Smallest value
+	uint64_t min = UINT64_MAX;
+	// Largest value
+	uint64_t max = 0;
+
+	/**
+	 * Add the moments of another slice
+	 *
+	 * @param[in] other  Moments of another slice
+	 */
+	void Merge(const CounterMoments& other)
+	{
+		if (other.count == 0)
+		{
+			return;
+		}
+		const uint64_t merged = count + other.count;
+		const double delta = other.mean - mean;
+		squaredDeviations += other.squaredDeviations + delta * delta * count * other.count / merged;
+		mean += delta * other.count / merged;
+		count = merged;
+		total += other.total;
+		min = std::min(min, other.min);
+		max = std::max(max, other.max);
+	}
+};
+
+/**
+ * Reduce a slice of a counter array in two passes: sum, min and max
+ * first, then the squared deviations from the slice mean. Both loops
+ * run kReductionLanes accumulators side by side, so they vectorize.
+ *
+ * @param[in] values   First value of the slice
+ * @param[in] count    Number of values
+ *
+ * @return    CounterMoments  Moments of the slice
+ */
+static CounterMoments ReduceSlice(const uint64_t* values, size_t count)
+{
+	CounterMoments moments;
+	if (count == 0)
+	{
+		return moments;
+	}
+	uint64_t sums[kReductionLanes] = {};
+	uint64_t mins[kReductionLanes];
+	uint64_t maxs[kReductionLanes] = {};
+	std::fill(mins, mins + kReductionLanes, UINT64_MAX);
+	const size_t vectorCount = count - count % kReductionLanes;
+	for (size_t i = 0; i < vectorCount; i += kReductionLanes)
+	{
+		for (uint32_t lane = 0; lane < kReductionLanes; ++lane)
+		{
+			const uint64_t value = values[i + lane];
+			sums[lane] += value;
+			mins[lane] = value < mins[lane] ? value : mins[lane];
+			maxs[lane] = value > maxs[lane] ? value : maxs[lane];
+		}
+	}
+	for (size_t i = vectorCount; i < count; ++i)
+	{
+		sums[0] += values[i];
+		mins[0] = std::min(mins[0], values[i]);
+		maxs[0] = std::max(maxs[0], values[i]);
+	}
+	for (uint32_t lane = 0; lane < kReductionLanes; ++lane)
+	{
+		moments.total += sums[lane];
+		moments.min = std::min(moments.min, mins[lane]);
+		moments.max = std::max(moments.max, maxs[lane]);
+	}
+	moments.count = count;
+	moments.mean = (double)moments.total / count;
+
+	double deviations[kReductionLanes] = {};
+	for (size_t i = 0; i < vectorCount; i += kReductionLanes)
+	{
+		for (uint32_t lane = 0; lane < kReductionLanes; ++lane)
+		{
+			const double deviation = (double)values[i + lane] - moments.mean;
+			deviations[lane] += deviation * deviation;
+		}
+	}
+	for (size_t i = vectorCount; i < count; ++i)
+	{
+		const double deviation = (double)values[i] - moments.mean;
+		deviations[0] += deviation * deviation;
+	}
+	for (uint32_t lane = 0; lane < kReductionLanes; ++lane)
+	{
+		moments.squaredDeviations += deviations[lane];
+	}
+	return moments;
+}
+
+/**
+ * Reduce a counter array. Arrays of several kParallelReductionSlice
+ * values are split in one contiguous slice per thread and the partial
+ * moments are merged.
+ *
+ * @param[in] values   Counter array
+ *
+ * @return    CounterMoments  Moments of the array
+ */
+static CounterMoments ReduceCounter(const std::vector<uint64_t>& values)
+{
+	const size_t sliceLimit = std::max<size_t>(1, values.size() / kParallelReductionSlice);
+	const uint32_t threadCount = (uint32_t)std::min<size_t>(sliceLimit, std::max(1u, std::thread::hardware_concurrency()));
+	if (threadCount == 1)
+	{
+		return ReduceSlice(values.data(), values.size());
+	}
+	std::vector<CounterMoments> partials(threadCount);
+	std::vector<std::thread> threads;
+	const size_t sliceSize = (values.size() + threadCount - 1) / threadCount;
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&values, &partials, sliceSize, t]() {
+			const size_t first = std::min(values.size(), t * sliceSize);
+			const size_t last = std::min(values.size(), first + sliceSize);
+			partials[t] = ReduceSlice(values.data() + first, last - first);
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	CounterMoments moments;
+	for (const CounterMoments& partial : partials)
+	{
+		moments.Merge(partial);
+	}
+	return moments;
+}
+
+CounterSummary SummarizeCounter(const std::string& name, const std::vector<uint64_t>& values)
+{
+	CounterSummary summary;
+	summary.name = name;
+	if (values.empty())
+	{
+		return summary;
+	}
+	const CounterMoments moments = ReduceCounter(values);
+	summary.count = moments.count;
+	summary.total = moments.total;
+	summary.mean = moments.mean;
+	summary.standardDeviation = std::sqrt(moments.squaredDeviations / moments.count);
+	summary.min = moments.min;
+	summary.max = moments.max;
+
+	// Selection instead of a sort: each nth_element is linear and the next
+	// percentile only searches above the previous one.
+	std::vector<uint64_t> scratch(values);
+	const double percentiles[] = { 50, 95, 99 };
+	uint64_t* results[] = { &summary.p50, &summary.p95, &summary.p99 };
+	std::vector<uint64_t>::iterator first = scratch.begin();
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const size_t rank = (size_t)std::ceil(percentiles[i] / 100 * scratch.size());
+		const std::vector<uint64_t>::iterator nth = scratch.begin() + (rank ? rank - 1 : 0);
+		std::nth_element(first, nth, scratch.end());
+		*results[i] = *nth;
+		first = nth;
+	}
+	return summary;
+}
+
+StatisticsReport::StatisticsReport(const std::string& title)
+	: m_title(title)
+{
+}
+
+void StatisticsReport::AddCounter(const std::string& name, const std::vector<uint64_t>& values)
+{
+	m_summaries.push_back(SummarizeCounter(name, values));
+}
+
+const std::vector<CounterSummary>& StatisticsReport::GetSummaries() const
+{
+	return m_summaries;
+}
+
+void StatisticsReport::Print(std::ostream& out) const
+{
+	const std::ios::fmtflags flags = out.flags();
+	const std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(2);
+	out << "Statistics of " << m_title << "\n"
+	    << std::left << std::setw(24) << "Counter" << std::right
+	    << std::setw(10) << "Count" << std::setw(16) << "Total" << std::setw(14) << "Mean"
+	    << std::setw(14) << "StdDev" << std::setw(12) << "Min" << std::setw(12) << "P50"
+	    << std::setw(12) << "P95" << std::setw(12) << "P99" << std::setw(12) << "Max" << "\n";
+	for (const CounterSummary& summary : m_summaries)
+	{
+		out << std::left << std::setw(24) << summary.name << std::right
+		    << std::setw(10) << summary.count << std::setw(16) << summary.total << std::setw(14) << summary.mean
+		    << std::setw(14) << summary.standardDeviation << std::setw(12) << summary.min
+		    << std::setw(12) << summary.p50 << std::setw(12) << summary.p95 << std::setw(12) << summary.p99
+		    << std::setw(12) << summary.max << "\n";
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void StatisticsReport::WriteCsv(std::ostream& out, bool writeHeader) const
+{
+	if (writeHeader)
+	{
+		out << "report,counter,count,total,mean,stddev,min,p50,p95,p99,max\n";
+	}
+	const std::streamsize precision = out.precision();
+	out << std::setprecision(10);
+	for (const CounterSummary& summary : m_summaries)
+	{
+		out << m_title << "," << summary.name << "," << summary.count << "," << summary.total << ","
+		    << summary.mean << "," << summary.standardDeviation << "," << summary.min << ","
+		    << summary.p50 << "," << summary.p95 << "," << summary.p99 << "," << summary.max << "\n";
+	}
+	out.precision(precision);
+}
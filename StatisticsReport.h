@@ -0,0 +1,103 @@
+/**
+ * @file  StatisticsReport.h
+ *
+ * This file contains StatisticsReport class. It summarizes per-truck
+ * and per-station counters at the end of a run: total, mean, standard
+ * deviation, min, max and percentiles of every counter. The counters
+ * are kept in contiguous arrays, so the reductions vectorize and large
+ * arrays are split over threads. It prints the summaries for people
+ * and as CSV rows for tools.
+ */
+
+#ifndef STATISTICSREPORT_H_
+#define STATISTICSREPORT_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Summary of one counter over all the trucks or stations
+ */
+struct CounterSummary
+{
+	// Name of the counter
+	std::string name;
+	// Number of values
+	uint64_t count = 0;
+	// Sum of the values
+	uint64_t total = 0;
+	// Mean of the values
+	double mean = 0;
+	// Population standard deviation of the values
+	double standardDeviation = 0;
+	// Smallest value
+	uint64_t min = 0;
+	// Largest value
+	uint64_t max = 0;
+	// Median
+	uint64_t p50 = 0;
+	// 95th percentile
+	uint64_t p95 = 0;
+	// 99th percentile
+	uint64_t p99 = 0;
+};
+
+/**
+ * Summarize a counter array
+ *
+ * @param[in] name     Name of the counter
+ * @param[in] values   Counter of every truck or station
+ *
+ * @return    CounterSummary  Summary of the values. Percentiles use the nearest rank.
+ */
+CounterSummary SummarizeCounter(const std::string& name, const std::vector<uint64_t>& values);
+
+/**
+ * StatisticsReport class
+ */
+class StatisticsReport
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] title   Title of the report, e.g. "trucks"
+	 */
+	explicit StatisticsReport(const std::string& title);
+	/**
+	 * Add a counter to the report and summarize it
+	 *
+	 * @param[in] name     Name of the counter
+	 * @param[in] values   Counter of every truck or station
+	 */
+	void AddCounter(const std::string& name, const std::vector<uint64_t>& values);
+	/**
+	 * Get the summaries of the added counters
+	 *
+	 * @return   Summaries in the order the counters are added
+	 */
+	const std::vector<CounterSummary>& GetSummaries() const;
+	/**
+	 * Print the summaries as a table
+	 *
+	 * @param[out] out   Output stream
+	 */
+	void Print(std::ostream& out) const;
+	/**
+	 * Write a CSV row for every summary
+	 *
+	 * @param[out] out          Output stream
+	 * @param[in]  writeHeader  True to write the column names first
+	 */
+	void WriteCsv(std::ostream& out, bool writeHeader) const;
+
+private:
+	// Title of the report
+	std::string m_title;
+	// Summary of every counter
+	std::vector<CounterSummary> m_summaries;
+};
+
+#endif /* STATISTICSREPORT_H_ */
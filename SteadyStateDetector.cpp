@@ -0,0 +1,113 @@
+/**
+ * @file  SteadyStateDetector.cpp
+ *
+ * SteadyStateDetector class methods implementation
+ */
+
+#include <cmath>
+#include <limits>
+#include "SteadyStateDetector.h"
+
+// Normal quantile of a two sided 95% confidence interval
+static const double kConfidenceQuantile = 1.96;
+
+SteadyStateDetector::SteadyStateDetector(uint64_t batchLength, double relativeTolerance, uint32_t minimumBatches)
+{
+	m_batchLength = batchLength;
+	m_relativeTolerance = relativeTolerance;
+	m_minimumBatches = minimumBatches < 2 ? 2 : minimumBatches;
+	m_warmupStep = 1;
+}
+
+void SteadyStateDetector::AddBatch(double value)
+{
+	m_batches.push_back(value);
+}
+
+uint64_t SteadyStateDetector::GetBatchLength() const
+{
+	return m_batchLength;
+}
+
+uint32_t SteadyStateDetector::GetBatchCount() const
+{
+	return m_batches.size();
+}
+
+void SteadyStateDetector::SetWarmupStep(uint32_t step)
+{
+	m_warmupStep = step < 1 ? 1 : step;
+}
+
+uint32_t SteadyStateDetector::GetWarmupBatches() const
+{
+	// MSER(d) = sum of squared deviations of batches d..n-1 / (n - d)^2.
+	// Sums are built from the end, so every truncation point costs O(1).
+	const size_t count = m_batches.size();
+	if (count < 2)
+	{
+		return 0;
+	}
+	double sum = 0;
+	double sumOfSquares = 0;
+	double bestStatistic = std::numeric_limits<double>::infinity();
+	uint32_t warmupBatches = 0;
+	for (size_t d = count; d-- > 0;)
+	{
+		sum += m_batches[d];
+		sumOfSquares += m_batches[d] * m_batches[d];
+		const double kept = count - d;
+		if (d > count / 2 || kept < 2 || d % m_warmupStep != 0)
+		{
+			continue;
+		}
+		const double statistic = (sumOfSquares - sum * sum / kept) / (kept * kept);
+		if (statistic <= bestStatistic)
+		{
+			bestStatistic = statistic;
+			warmupBatches = d;
+		}
+	}
+	return warmupBatches;
+}
+
+double SteadyStateDetector::GetSteadyStateMean() const
+{
+	const uint32_t warmupBatches = GetWarmupBatches();
+	if (m_batches.size() <= warmupBatches)
+	{
+		return 0;
+	}
+	double sum = 0;
+	for (size_t i = warmupBatches; i < m_batches.size(); ++i)
+	{
+		sum += m_batches[i];
+	}
+	return sum / (m_batches.size() - warmupBatches);
+}
+
+double SteadyStateDetector::GetHalfWidth() const
+{
+	const uint32_t warmupBatches = GetWarmupBatches();
+	const double kept = m_batches.size() - warmupBatches;
+	if (kept < 2)
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+	const double mean = GetSteadyStateMean();
+	double sumOfSquares = 0;
+	for (size_t i = warmupBatches; i < m_batches.size(); ++i)
+	{
+		sumOfSquares += (m_batches[i] - mean) * (m_batches[i] - mean);
+	}
+	return kConfidenceQuantile * std::sqrt(sumOfSquares / (kept - 1) / kept);
+}
+
+bool SteadyStateDetector::IsConverged() const
+{
+	if (m_batches.size() - GetWarmupBatches() < m_minimumBatches)
+	{
+		return false;
+	}
+	return GetHalfWidth() <= m_relativeTolerance * std::fabs(GetSteadyStateMean());
+}
@@ -0,0 +1,97 @@
+/**
+ * @file  SteadyStateDetector.h
+ *
+ * This file contains SteadyStateDetector class. It collects batch means
+ * of a run, finds the end of the warm-up transient with the MSER rule
+ * and tells when the steady-state mean is known within a relative
+ * tolerance, so the run can stop early.
+ */
+
+#ifndef STEADYSTATEDETECTOR_H_
+#define STEADYSTATEDETECTOR_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * SteadyStateDetector class
+ */
+class SteadyStateDetector
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] batchLength         Simulated time of a batch in milliseconds
+	 * @param[in] relativeTolerance   Largest accepted 95% confidence half-width,
+	 *                                relative to the mean
+	 * @param[in] minimumBatches      Steady-state batches needed before the
+	 *                                estimate can be accepted
+	 */
+	SteadyStateDetector(uint64_t batchLength, double relativeTolerance, uint32_t minimumBatches);
+	/**
+	 * Add the mean of the next batch
+	 *
+	 * @param[in] value   Batch mean
+	 */
+	void AddBatch(double value);
+	/**
+	 * Get the simulated time of a batch
+	 *
+	 * @return   Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t GetBatchLength() const;
+	/**
+	 * Get the number of batches added
+	 *
+	 * @return   Unsigned Integer  Number of batches
+	 */
+	uint32_t GetBatchCount() const;
+	/**
+	 * Set the spacing of the truncation points the MSER search may pick
+	 *
+	 * @param[in] step   Number of batches between two truncation points. 1 allows every batch.
+	 */
+	void SetWarmupStep(uint32_t step);
+	/**
+	 * Get the number of leading batches which belong to the warm-up.
+	 * It is the truncation point which minimizes the MSER statistic,
+	 * searched over the multiples of the warm-up step in the first half
+	 * of the batches.
+	 *
+	 * @return   Unsigned Integer  Number of batches to discard
+	 */
+	uint32_t GetWarmupBatches() const;
+	/**
+	 * Get the mean of the batches after the warm-up
+	 *
+	 * @return   Double  Steady-state mean
+	 */
+	double GetSteadyStateMean() const;
+	/**
+	 * Get the 95% confidence half-width of the steady-state mean
+	 *
+	 * @return   Double  Half-width. Infinity if there are too few batches.
+	 */
+	double GetHalfWidth() const;
+	/**
+	 * Check if the steady-state mean is known within the tolerance
+	 *
+	 * @return   bool  True if the run can stop, otherwise False.
+	 */
+	bool IsConverged() const;
+
+private:
+	// Simulated time of a batch in milliseconds
+	uint64_t m_batchLength;
+	// Largest accepted half-width relative to the mean
+	double m_relativeTolerance;
+	// Steady-state batches needed before the estimate can be accepted
+	uint32_t m_minimumBatches;
+	// Batches between two truncation points
+	uint32_t m_warmupStep;
+	// Batch means in time order
+	std::vector<double> m_batches;
+};
+
+#endif /* STEADYSTATEDETECTOR_H_ */
@@ -0,0 +1,285 @@
+/**
+ * @file  TimeSeriesRecorder.cpp
+ *
+ * TimeSeriesRecorder class methods implementation
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include "TimeSeriesRecorder.h"
+#include "MiningTruck.h"
+
+// File identifier of the time series file
+static const char kTimeSeriesMagic[8] = { 'M', 'T', 'S', 'E', 'R', 'I', 'E', 'S' };
+// Version of the time series file format
+static const uint32_t kTimeSeriesVersion = 1;
+// Bytes reserved per station column and expected sample. Most samples of a
+// busy station change by a small delta, which takes one byte.
+static const uint64_t kReservedStationBytesPerSample = 1;
+// Bytes reserved per truck state column and expected sample. Fleet wide
+// counts move by hundreds between samples.
+static const uint64_t kReservedFleetBytesPerSample = 3;
+
+TimeSeriesRecorder::TimeSeriesRecorder(uint32_t stationCount, uint64_t startTime, uint64_t interval, uint64_t expectedSamples)
+{
+	m_stationCount = stationCount;
+	m_startTime = startTime;
+	m_interval = interval;
+	m_sampleCount = 0;
+	m_columns.resize(1 + stationCount + kTruckStateCount);
+	m_columns[0].name = "time_jitter_ms";
+	for (uint32_t i = 0; i < stationCount; ++i)
+	{
+		m_columns[1 + i].name = "station_" + std::to_string(i + 1) + "_queue_depth";
+	}
+	for (uint32_t state = 0; state < kTruckStateCount; ++state)
+	{
+		m_columns[1 + stationCount + state].name = std::string("trucks_") + GetTruckStateName((TruckState)state);
+	}
+	// Reserve up front, so sampling does not allocate in the event loop.
+	for (size_t i = 0; i < m_columns.size(); ++i)
+	{
+		const bool stationColumn = i >= 1 && i <= stationCount;
+		m_columns[i].bytes.reserve(expectedSamples *
+				(stationColumn ? kReservedStationBytesPerSample : kReservedFleetBytesPerSample));
+	}
+}
+
+uint64_t TimeSeriesRecorder::GetNextSampleTime() const
+{
+	return m_startTime + m_sampleCount * m_interval;
+}
+
+uint32_t TimeSeriesRecorder::GetStationCount() const
+{
+	return m_stationCount;
+}
+
+uint64_t TimeSeriesRecorder::GetInterval() const
+{
+	return m_interval;
+}
+
+uint64_t TimeSeriesRecorder::GetSampleCount() const
+{
+	return m_sampleCount;
+}
+
+void TimeSeriesRecorder::AddSample(uint64_t time, const int64_t* queueDepths, const int64_t* truckCounts)
+{
+	Append(m_columns[0], (int64_t)(time - GetNextSampleTime()));
+	for (uint32_t i = 0; i < m_stationCount; ++i)
+	{
+		Append(m_columns[1 + i], queueDepths[i]);
+	}
+	for (uint32_t state = 0; state < kTruckStateCount; ++state)
+	{
+		Append(m_columns[1 + m_stationCount + state], truckCounts[state]);
+	}
+	m_sampleCount++;
+}
+
+void TimeSeriesRecorder::Append(Column& column, int64_t value)
+{
+	value = std::clamp(value, -kTimeSeriesMaxValue, kTimeSeriesMaxValue);
+	if (value == column.lastValue && !column.bytes.empty())
+	{
+		column.pendingRun++;
+		return;
+	}
+	if (column.pendingRun)
+	{
+		AppendVarint(column.bytes, (column.pendingRun << 1) | 1);
+		column.pendingRun = 0;
+	}
+	const int64_t delta = value - column.lastValue;
+	const uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+	AppendVarint(column.bytes, zigzag << 1);
+	column.lastValue = value;
+}
+
+void TimeSeriesRecorder::AppendVarint(std::vector<uint8_t>& bytes, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		bytes.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((uint8_t)value);
+}
+
+void TimeSeriesRecorder::GetEncoded(const Column& column, std::vector<uint8_t>& bytes)
+{
+	bytes = column.bytes;
+	if (column.pendingRun)
+	{
+		AppendVarint(bytes, (column.pendingRun << 1) | 1);
+	}
+}
+
+uint64_t TimeSeriesRecorder::GetEncodedSize() const
+{
+	uint64_t size = 0;
+	for (const Column& column : m_columns)
+	{
+		// A pending run takes at most 10 bytes, nearly always 1 or 2.
+		size += column.bytes.size() + (column.pendingRun ? 2 : 0);
+	}
+	return size;
+}
+
+void TimeSeriesRecorder::DecodeColumn(uint32_t column, std::vector<int64_t>& values) const
+{
+	std::vector<uint8_t> bytes;
+	GetEncoded(m_columns[column], bytes);
+	values.clear();
+	values.reserve(m_sampleCount);
+	int64_t value = 0;
+	size_t position = 0;
+	while (position < bytes.size())
+	{
+		uint64_t token = 0;
+		for (uint32_t shift = 0; position < bytes.size(); shift += 7)
+		{
+			const uint8_t byte = bytes[position++];
+			token |= (uint64_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+			{
+				break;
+			}
+		}
+		if (token & 1)
+		{
+			values.insert(values.end(), token >> 1, value);
+		}
+		else
+		{
+			const uint64_t zigzag = token >> 1;
+			value += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+			values.push_back(value);
+		}
+	}
+}
+
+bool TimeSeriesRecorder::Write(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		return false;
+	}
+	TimeSeriesHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kTimeSeriesMagic, sizeof(kTimeSeriesMagic));
+	header.version = kTimeSeriesVersion;
+	header.columnCount = m_columns.size();
+	header.sampleCount = m_sampleCount;
+	header.startTime = m_startTime;
+	header.interval = m_interval;
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	std::vector<uint8_t> bytes;
+	for (size_t i = 0; written && i < m_columns.size(); ++i)
+	{
+		GetEncoded(m_columns[i], bytes);
+		const uint32_t nameLength = m_columns[i].name.size();
+		const uint64_t encodedLength = bytes.size();
+		written = fwrite(&nameLength, sizeof(nameLength), 1, file) == 1 &&
+		          fwrite(m_columns[i].name.data(), 1, nameLength, file) == nameLength &&
+		          fwrite(&encodedLength, sizeof(encodedLength), 1, file) == 1 &&
+		          fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	}
+	return (fclose(file) == 0) && written;
+}
+
+bool TimeSeriesRecorder::WriteDownsampledCsv(const std::string& path, uint32_t pointCount) const
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+	{
+		return false;
+	}
+	std::vector<int64_t> jitter;
+	DecodeColumn(0, jitter);
+	std::vector<uint64_t> times(m_sampleCount);
+	for (uint64_t i = 0; i < m_sampleCount; ++i)
+	{
+		times[i] = m_startTime + i * m_interval + jitter[i];
+	}
+	bool written = fprintf(file, "series,time_minutes,value\n") > 0;
+	std::vector<int64_t> values;
+	std::vector<uint32_t> selected;
+	for (uint32_t column = 1; written && column < m_columns.size(); ++column)
+	{
+		DecodeColumn(column, values);
+		DownsampleLttb(times, values, pointCount, selected);
+		for (uint32_t index : selected)
+		{
+			written = written && fprintf(file, "%s,%.3f,%lld\n", m_columns[column].name.c_str(),
+					times[index] / 60000.0, (long long)values[index]) > 0;
+		}
+	}
+	return (fclose(file) == 0) && written;
+}
+
+void TimeSeriesRecorder::DownsampleLttb(const std::vector<uint64_t>& times, const std::vector<int64_t>& values,
+		uint32_t pointCount, std::vector<uint32_t>& selected)
+{
+	selected.clear();
+	const uint32_t count = values.size();
+	if (pointCount < 3 || pointCount >= count)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			selected.push_back(i);
+		}
+		return;
+	}
+	// The first and the last point are always kept. The points between
+	// them are split in pointCount - 2 buckets of equal size.
+	const double bucketSize = (double)(count - 2) / (pointCount - 2);
+	uint32_t kept = 0;
+	selected.push_back(0);
+	for (uint32_t bucket = 0; bucket < pointCount - 2; ++bucket)
+	{
+		const uint32_t first = 1 + (uint32_t)(bucket * bucketSize);
+		const uint32_t last = 1 + (uint32_t)((bucket + 1) * bucketSize);
+		// The next bucket is represented by its mean point, or by the last point after the final bucket.
+		const uint32_t nextFirst = last;
+		const uint32_t nextLast = std::min(count, 1 + (uint32_t)((bucket + 2) * bucketSize));
+		double nextTime = 0;
+		double nextValue = 0;
+		if (bucket + 1 < pointCount - 2)
+		{
+			for (uint32_t i = nextFirst; i < nextLast; ++i)
+			{
+				nextTime += times[i];
+				nextValue += values[i];
+			}
+			nextTime /= nextLast - nextFirst;
+			nextValue /= nextLast - nextFirst;
+		}
+		else
+		{
+			nextTime = times[count - 1];
+			nextValue = values[count - 1];
+		}
+		double largestArea = -1;
+		uint32_t largest = first;
+		for (uint32_t i = first; i < last; ++i)
+		{
+			// Twice the triangle area, from the cross product of two of its sides.
+			const double area = std::fabs(((double)times[kept] - nextTime) * ((double)values[i] - values[kept]) -
+					((double)times[kept] - times[i]) * (nextValue - values[kept]));
+			if (area > largestArea)
+			{
+				largestArea = area;
+				largest = i;
+			}
+		}
+		selected.push_back(largest);
+		kept = largest;
+	}
+	selected.push_back(count - 1);
+}
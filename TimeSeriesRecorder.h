@@ -0,0 +1,193 @@
+/**
+ * @file  TimeSeriesRecorder.h
+ *
+ * This file contains TimeSeriesRecorder class. It samples the queue
+ * depth of every station and the number of trucks in every state at a
+ * fixed simulated interval and keeps each series as a compressed column.
+ *
+ * A column is a sequence of varint tokens over the deltas of the series:
+ *  - (zigzag(delta) << 1) for a changed value
+ *  - (run << 1) | 1 for run consecutive samples without change
+ * so an idle station costs a few bytes for the whole run. The tag bit
+ * leaves 63 bits for the zigzag delta, so values are clamped to
+ * +/- kTimeSeriesMaxValue.
+ *
+ * File layout: TimeSeriesHeader, then for every column a uint32_t name
+ * length, the name, a uint64_t encoded length and the encoded bytes.
+ * The first column is the deviation of the sample time from
+ * startTime + i * interval, which is 0 for the event driven engine.
+ */
+
+#ifndef TIMESERIESRECORDER_H_
+#define TIMESERIESRECORDER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Largest magnitude of a recorded value, so every delta fits in a token
+static const int64_t kTimeSeriesMaxValue = ((int64_t)1 << 61) - 1;
+
+/**
+ * Header of the time series file
+ */
+struct TimeSeriesHeader
+{
+	// File identifier, "MTSERIES"
+	char magic[8];
+	// Format version
+	uint32_t version;
+	// Number of columns, including the time column
+	uint32_t columnCount;
+	// Number of samples of every column
+	uint64_t sampleCount;
+	// Simulated time of the first sample in milliseconds
+	uint64_t startTime;
+	// Simulated time between two samples in milliseconds
+	uint64_t interval;
+};
+
+/**
+ * TimeSeriesRecorder class
+ */
+class TimeSeriesRecorder
+{
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in] stationCount      Number of stations
+	 * @param[in] startTime         Simulated time of the first sample in milliseconds
+	 * @param[in] interval          Simulated time between two samples in milliseconds
+	 * @param[in] expectedSamples   Number of samples to reserve the columns for
+	 */
+	TimeSeriesRecorder(uint32_t stationCount, uint64_t startTime, uint64_t interval, uint64_t expectedSamples);
+	/**
+	 * Get the simulated time of the next sample
+	 *
+	 * @return   Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t GetNextSampleTime() const;
+	/**
+	 * Get the number of stations sampled
+	 *
+	 * @return   Unsigned Integer  Number of stations
+	 */
+	uint32_t GetStationCount() const;
+	/**
+	 * Get the simulated time between two samples
+	 *
+	 * @return   Unsigned Integer  Time in milliseconds
+	 */
+	uint64_t GetInterval() const;
+	/**
+	 * Append a sample
+	 *
+	 * @param[in] time           Simulated time of the sample in milliseconds
+	 * @param[in] queueDepths    Queue depth of every station
+	 * @param[in] truckCounts    Number of trucks in every state, kTruckStateCount values
+	 */
+	void AddSample(uint64_t time, const int64_t* queueDepths, const int64_t* truckCounts);
+	/**
+	 * Get the number of samples
+	 *
+	 * @return   Unsigned Integer  Number of samples
+	 */
+	uint64_t GetSampleCount() const;
+	/**
+	 * Get the encoded size of all the columns
+	 *
+	 * @return   Unsigned Integer  Size in bytes
+	 */
+	uint64_t GetEncodedSize() const;
+	/**
+	 * Decode a column
+	 *
+	 * @param[in]  column   Column index. 0 is the time column.
+	 * @param[out] values   Value of every sample
+	 */
+	void DecodeColumn(uint32_t column, std::vector<int64_t>& values) const;
+	/**
+	 * Write the compressed columns
+	 *
+	 * @param[in] path   File path
+	 *
+	 * @return    bool   True if the file is written, otherwise False.
+	 */
+	bool Write(const std::string& path) const;
+	/**
+	 * Write a CSV view of every series, downsampled with
+	 * Largest-Triangle-Three-Buckets, for plotting
+	 *
+	 * @param[in] path         File path
+	 * @param[in] pointCount   Points kept per series
+	 *
+	 * @return    bool   True if the file is written, otherwise False.
+	 */
+	bool WriteDownsampledCsv(const std::string& path, uint32_t pointCount) const;
+	/**
+	 * Select the points of a series which keep its visual shape.
+	 * Largest-Triangle-Three-Buckets keeps the first and the last point
+	 * and from every bucket between them the point which forms the
+	 * largest triangle with the point kept before and the mean of the
+	 * next bucket.
+	 *
+	 * @param[in]  times       Time of every point
+	 * @param[in]  values      Value of every point
+	 * @param[in]  pointCount  Number of points to keep, at least 3
+	 * @param[out] selected    Indexes of the kept points, ascending
+	 */
+	static void DownsampleLttb(const std::vector<uint64_t>& times, const std::vector<int64_t>& values,
+			uint32_t pointCount, std::vector<uint32_t>& selected);
+
+private:
+	/**
+	 * Compressed column of a series
+	 */
+	struct Column
+	{
+		// Name of the series
+		std::string name;
+		// Encoded tokens
+		std::vector<uint8_t> bytes;
+		// Last appended value
+		int64_t lastValue = 0;
+		// Samples without change which are not encoded yet
+		uint64_t pendingRun = 0;
+	};
+
+	/**
+	 * Append a value to a column
+	 *
+	 * @param[in,out] column  Column
+	 * @param[in]     value   Value of the sample
+	 */
+	static void Append(Column& column, int64_t value);
+	/**
+	 * Append a varint to a byte array
+	 *
+	 * @param[in,out] bytes   Byte array
+	 * @param[in]     value   Value to encode
+	 */
+	static void AppendVarint(std::vector<uint8_t>& bytes, uint64_t value);
+	/**
+	 * Get the encoded bytes of a column with its pending run
+	 *
+	 * @param[in]  column  Column
+	 * @param[out] bytes   Encoded bytes
+	 */
+	static void GetEncoded(const Column& column, std::vector<uint8_t>& bytes);
+
+	// Number of stations
+	uint32_t m_stationCount;
+	// Simulated time between two samples in milliseconds
+	uint64_t m_interval;
+	// Simulated time of the first sample in milliseconds
+	uint64_t m_startTime;
+	// Number of samples
+	uint64_t m_sampleCount;
+	// Time column, then the queue depth of every station, then the truck count of every state
+	std::vector<Column> m_columns;
+};
+
+#endif /* TIMESERIESRECORDER_H_ */
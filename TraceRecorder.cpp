@@ -0,0 +1,165 @@
+/**
+ * @file  TraceRecorder.cpp
+ *
+ * TraceRecorder and TraceScope class methods implementation
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include "TraceRecorder.h"
+
+/**
+ * Get the steady clock time
+ *
+ * @return   Unsigned Integer  Nanoseconds of the steady clock
+ */
+static uint64_t GetSteadyNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TraceRecorder* TraceRecorder::GetInstance()
+{
+	static TraceRecorder m_instance;
+	return &m_instance;
+}
+
+TraceRecorder::TraceRecorder()
+{
+	m_enabled = false;
+	m_sampleInterval = 1;
+	m_maxSpansPerThread = 0;
+	m_origin = GetSteadyNanoseconds();
+}
+
+void TraceRecorder::Enable(uint32_t sampleInterval, uint64_t maxSpansPerThread)
+{
+	m_sampleInterval = sampleInterval ? sampleInterval : 1;
+	m_maxSpansPerThread = maxSpansPerThread;
+	m_origin = GetSteadyNanoseconds();
+	m_enabled = true;
+}
+
+uint64_t TraceRecorder::Now() const
+{
+	return GetSteadyNanoseconds() - m_origin;
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::GetThreadBuffer()
+{
+	// Each thread appends to its own buffer, so recording takes no lock.
+	thread_local ThreadBuffer* t_buffer = NULL;
+	if (!t_buffer)
+	{
+		std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+		buffer->spans.reserve(m_maxSpansPerThread < 1024 ? m_maxSpansPerThread : 1024);
+		t_buffer = buffer.get();
+		std::lock_guard<std::mutex> lock(m_guard);
+		m_buffers.push_back(std::move(buffer));
+	}
+	return t_buffer;
+}
+
+void TraceRecorder::RecordSpan(TraceTrack track, uint32_t id, const char* name, uint64_t begin, uint64_t end)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	if (buffer->spans.size() >= m_maxSpansPerThread)
+	{
+		buffer->droppedCount++;
+		return;
+	}
+	buffer->spans.push_back(TraceSpan{begin, end, name, id, track});
+}
+
+bool TraceRecorder::WriteChromeTrace(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_guard);
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+	fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Trucks\"}},\n", file);
+	fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"Unloading Stations\"}}", file);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : m_buffers)
+	{
+		for (const TraceSpan& span : buffer->spans)
+		{
+			// Complete events ("X") carry begin and duration in microseconds.
+			fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					span.name, span.track == TraceTrack::truck ? "truck" : "station",
+					(uint32_t)span.track, span.id, span.begin / 1000.0, (span.end - span.begin) / 1000.0);
+		}
+	}
+	fputs("\n]}\n", file);
+	return fclose(file) == 0;
+}
+
+void TraceRecorder::PrintTimeAccountingReport(std::ostream& out) const
+{
+	/**
+	 * Total time of one span name
+	 */
+	struct Total
+	{
+		// Number of spans
+		uint64_t count = 0;
+		// Total duration in nanoseconds
+		uint64_t duration = 0;
+	};
+	std::map<std::pair<TraceTrack, std::string>, Total> totals;
+	uint64_t trackDuration[3] = {0, 0, 0};
+	uint64_t droppedCount = 0;
+
+	std::lock_guard<std::mutex> lock(m_guard);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : m_buffers)
+	{
+		droppedCount += buffer->droppedCount;
+		for (const TraceSpan& span : buffer->spans)
+		{
+			Total& total = totals[std::make_pair(span.track, std::string(span.name))];
+			total.count++;
+			total.duration += span.end - span.begin;
+			trackDuration[(uint32_t)span.track] += span.end - span.begin;
+		}
+	}
+
+	out << "Time accounting (sampled every " << m_sampleInterval << ")\n";
+	for (const auto& entry : totals)
+	{
+		const uint64_t trackTotal = trackDuration[(uint32_t)entry.first.first];
+		char line[160];
+		snprintf(line, sizeof(line), "  %-8s %-30s %10lu spans %12.3f s %6.2f %%\n",
+				entry.first.first == TraceTrack::truck ? "truck" : "station",
+				entry.first.second.c_str(), (unsigned long)entry.second.count,
+				entry.second.duration / 1e9, trackTotal ? 100.0 * entry.second.duration / trackTotal : 0.0);
+		out << line;
+	}
+	if (droppedCount)
+	{
+		out << "  " << droppedCount << " spans dropped. Raise the trace limit to keep them.\n";
+	}
+}
+
+TraceScope::TraceScope(TraceTrack track, uint32_t id, const char* name)
+{
+	m_track = track;
+	m_id = id;
+	m_name = name;
+	m_sampled = TraceRecorder::GetInstance()->IsSampled(id);
+	m_begin = m_sampled ? TraceRecorder::GetInstance()->Now() : 0;
+}
+
+TraceScope::~TraceScope()
+{
+	if (m_sampled)
+	{
+		TraceRecorder* recorder = TraceRecorder::GetInstance();
+		recorder->RecordSpan(m_track, m_id, m_name, m_begin, recorder->Now());
+	}
+}
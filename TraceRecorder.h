@@ -0,0 +1,185 @@
+/**
+ * @file  TraceRecorder.h
+ *
+ * This file contains TraceRecorder class and TraceScope helper.
+ * They record begin/end spans of truck states and station activity
+ * into per-thread buffers and export them as Chrome Trace Event JSON,
+ * which can be opened in chrome://tracing or ui.perfetto.dev.
+ */
+
+#ifndef TRACERECORDER_H_
+#define TRACERECORDER_H_
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Track of a span. It is exported as the process id of the trace,
+ * so trucks and stations are grouped separately.
+ */
+enum class TraceTrack : uint8_t
+{
+	truck = 1,
+	station = 2
+};
+
+/**
+ * Recorded span
+ */
+struct TraceSpan
+{
+	// Begin time in nanoseconds since the recorder is enabled
+	uint64_t begin;
+	// End time in nanoseconds since the recorder is enabled
+	uint64_t end;
+	// Name of the span. It must be a string literal.
+	const char* name;
+	// Truck Id or Station Id
+	uint32_t id;
+	// Track of the span
+	TraceTrack track;
+};
+
+/**
+ * TraceRecorder class
+ */
+class TraceRecorder
+{
+public:
+	/**
+	 * Method to get the singleton instance of TraceRecorder class.
+	 *
+	 * @return  Returns the singleton instance of TraceRecorder class.
+	 */
+	static TraceRecorder* GetInstance();
+	/**
+	 * Enable recording. It must be called before the threads start.
+	 *
+	 * @param[in] sampleInterval     Only trucks and stations whose id is a
+	 *                               multiple of this value are recorded.
+	 *                               1 records all of them.
+	 * @param[in] maxSpansPerThread  Recording of a thread stops when its
+	 *                               buffer reaches this number of spans.
+	 */
+	void Enable(uint32_t sampleInterval, uint64_t maxSpansPerThread);
+	/**
+	 * Check whether the given truck or station is recorded
+	 *
+	 * @param[in] id   Truck Id or Station Id
+	 *
+	 * @return    bool True if recording is enabled and id is sampled.
+	 */
+	bool IsSampled(uint32_t id) const
+	{
+		return m_enabled && id % m_sampleInterval == 0;
+	}
+	/**
+	 * Get the current trace time
+	 *
+	 * @return   Unsigned Integer  Nanoseconds since the recorder is enabled
+	 */
+	uint64_t Now() const;
+	/**
+	 * Record a span into the buffer of the calling thread
+	 *
+	 * @param[in] track   Track of the span
+	 * @param[in] id      Truck Id or Station Id
+	 * @param[in] name    Name of the span. It must be a string literal.
+	 * @param[in] begin   Begin time returned by Now
+	 * @param[in] end     End time returned by Now
+	 */
+	void RecordSpan(TraceTrack track, uint32_t id, const char* name, uint64_t begin, uint64_t end);
+	/**
+	 * Write all the recorded spans as Chrome Trace Event JSON.
+	 * It must be called after the recording threads are joined.
+	 *
+	 * @param[in] path   Output file path
+	 *
+	 * @return    bool   True if the file is written.
+	 */
+	bool WriteChromeTrace(const std::string& path) const;
+	/**
+	 * Print total time and share per span name for trucks and stations.
+	 * It must be called after the recording threads are joined.
+	 *
+	 * @param[in] out   Output stream
+	 */
+	void PrintTimeAccountingReport(std::ostream& out) const;
+
+private:
+	/**
+	 * Constructor
+	 */
+	TraceRecorder();
+	/**
+	 * Buffer owned by one recording thread
+	 */
+	struct ThreadBuffer
+	{
+		// Recorded spans
+		std::vector<TraceSpan> spans;
+		// Spans dropped because the buffer is full
+		uint64_t droppedCount = 0;
+	};
+	/**
+	 * Get the buffer of the calling thread. The buffer is
+	 * created and registered on the first call of the thread.
+	 *
+	 * @return   Buffer of the calling thread
+	 */
+	ThreadBuffer* GetThreadBuffer();
+
+	// True if recording is enabled
+	bool m_enabled;
+	// Sample every Nth truck and station
+	uint32_t m_sampleInterval;
+	// Maximum number of spans per thread
+	uint64_t m_maxSpansPerThread;
+	// Time origin in nanoseconds of steady clock
+	uint64_t m_origin;
+	// Mutex used only to register a new thread buffer
+	mutable std::mutex m_guard;
+	// Buffers of all the threads which recorded a span
+	std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+/**
+ * TraceScope class
+ * Records a span from construction to destruction if the id is sampled.
+ */
+class TraceScope
+{
+public:
+	/**
+	 * Constructor. Takes the begin time.
+	 *
+	 * @param[in] track   Track of the span
+	 * @param[in] id      Truck Id or Station Id
+	 * @param[in] name    Name of the span. It must be a string literal.
+	 */
+	TraceScope(TraceTrack track, uint32_t id, const char* name);
+	/**
+	 * Destructor. Takes the end time and records the span.
+	 */
+	~TraceScope();
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	// Track of the span
+	TraceTrack m_track;
+	// Truck Id or Station Id
+	uint32_t m_id;
+	// Name of the span
+	const char* m_name;
+	// Begin time. Only valid if m_sampled is true.
+	uint64_t m_begin;
+	// True if the span is recorded
+	bool m_sampled;
+};
+
+#endif /* TRACERECORDER_H_ */
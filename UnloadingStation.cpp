@@ -7,51 +7,270 @@
 #include <chrono>
 #include <thread>
 #include "UnloadingStation.h"
+#include "TraceRecorder.h"
+#include "SimMetrics.h"
+#include "StagingArea.h"
 
 
-UnloadingStation::UnloadingStation(uint16_t stationId)
+UnloadingStation::UnloadingStation(uint16_t stationId, bool batchUnloading, std::stop_token stopToken,
+		uint32_t priorityClassCount)
+	: m_queue(priorityClassCount)
 {
 	m_stationId = stationId;
 	m_unloadCount = 0;
-	m_stopSim = false;
+	m_unloadedTonnes = 0;
+	m_stopToken = stopToken;
 	m_unloadingTruck = NULL;
 	m_startTime = high_resolution_clock::now();
+	m_batchUnloading = batchUnloading;
+	m_pendingInBatch = 0;
+	m_numaNode = 0;
+	m_localPushCount = 0;
+	m_remotePushCount = 0;
+	m_capacity = 0;
+	m_occupancy = 0;
+	m_rejectedCount = 0;
+	m_divertedCount = 0;
 }
 
-void UnloadingStation::IncrementUnloadCount()
+void UnloadingStation::IncrementUnloadCount(uint32_t payload)
 {
 	m_unloadCount++;
+	m_unloadedTonnes += payload;
 }
 
-void UnloadingStation::StopSimulation()
+uint32_t UnloadingStation::GetUnloadCount() const
 {
-	m_stopSim = true;
+	return m_unloadCount;
+}
+
+uint64_t UnloadingStation::GetUnloadedTonnes() const
+{
+	return m_unloadedTonnes;
+}
+
+void UnloadingStation::SetNumaNode(uint32_t node)
+{
+	m_numaNode = node;
+}
+
+uint32_t UnloadingStation::GetNumaNode() const
+{
+	return m_numaNode;
+}
+
+uint64_t UnloadingStation::GetLocalPushCount() const
+{
+	return m_localPushCount;
+}
+
+uint64_t UnloadingStation::GetRemotePushCount() const
+{
+	return m_remotePushCount;
+}
+
+BlockingQueueStats UnloadingStation::GetQueueStats() const
+{
+	return m_queue.stats();
+}
+
+PriorityClassStats UnloadingStation::GetPriorityClassStats(uint32_t priorityClass) const
+{
+	return m_queue.classStats(priorityClass);
+}
+
+void UnloadingStation::SetCapacity(uint32_t capacity)
+{
+	m_capacity = capacity;
+}
+
+uint32_t UnloadingStation::GetCapacity() const
+{
+	return m_capacity;
+}
+
+uint64_t UnloadingStation::GetRejectedCount() const
+{
+	return m_rejectedCount;
+}
+
+uint64_t UnloadingStation::GetDivertedCount() const
+{
+	return m_divertedCount;
 }
 
 void UnloadingStation::PushToQueue(MiningTruck* truck)
 {
-	m_queue.push(truck);
+	m_occupancy.fetch_add(1, std::memory_order_relaxed);
+	Enqueue(truck);
+}
+
+bool UnloadingStation::TryPushToQueue(MiningTruck* truck, bool diverted)
+{
+	// Take a slot first, so concurrent trucks cannot overfill the station.
+	uint64_t occupancy = m_occupancy.load(std::memory_order_relaxed);
+	do
+	{
+		if (m_capacity && occupancy >= m_capacity)
+		{
+			return false;
+		}
+	} while (!m_occupancy.compare_exchange_weak(occupancy, occupancy + 1, std::memory_order_relaxed));
+
+	if (diverted)
+	{
+		m_divertedCount.fetch_add(1, std::memory_order_relaxed);
+		SimMetrics::GetInstance()->AddDivertedArrival();
+	}
+	Enqueue(truck);
+	return true;
 }
 
-uint64_t UnloadingStation::GetWaitingTime()
+void UnloadingStation::CountRejectedArrival()
 {
-	uint64_t totalTime = 0;
-	// Calculate total waiting time by multiplying queue size and unloading time in seconds (5*60).
-	// then add the remaining time of currently unloading truck (5*60 - elapsed time)
-	// Elapsed time is calculated by std::chrono::duration_cast< std::chrono::seconds>(high_resolution_clock::now() - m_startTime)
+	m_rejectedCount.fetch_add(1, std::memory_order_relaxed);
+	SimMetrics::GetInstance()->AddRejectedArrival();
+}
+
+void UnloadingStation::Enqueue(MiningTruck* truck)
+{
+	if (truck->GetNumaNode() == m_numaNode)
+	{
+		m_localPushCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		m_remotePushCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	SimMetrics::GetInstance()->AddQueueDepth(m_stationId - 1, 1);
+	m_queue.push(truck, truck->GetPriorityClass());
+}
+
+uint64_t UnloadingStation::GetWaitingTime(uint32_t priorityClass)
+{
+	const uint64_t unloadingTime = MiningTruck::GetUnloadingTime();
+	// Every truck queued ahead of this class, or drained in the current batch, takes the full unloading time.
+	uint64_t totalTime = (m_queue.size(priorityClass) + m_pendingInBatch) * unloadingTime;
+	// Then add the remaining time of currently unloading truck.
+	if (m_unloadingTruck.load(std::memory_order_acquire))
+	{
+		uint64_t elapsed = duration_cast<milliseconds>(high_resolution_clock::now() -
+				m_startTime.load(std::memory_order_relaxed)).count();
+		if (elapsed < unloadingTime)
+		{
+			totalTime += unloadingTime - elapsed;
+		}
+	}
 	return totalTime;
 }
 
 void UnloadingStation::run()
 {
-	while(!m_stopSim)
+	if (m_batchUnloading)
+	{
+		RunBatch();
+	}
+	else
+	{
+		RunSingle();
+	}
+}
+
+void UnloadingStation::RunSingle()
+{
+	while(!m_stopToken.stop_requested())
 	{
-		if(m_queue.pop(m_unloadingTruck, 1000))
+		bool popped;
+		MiningTruck* truck;
 		{
-			m_startTime = high_resolution_clock::now();
-			this_thread::sleep_for(std::chrono::milliseconds(MiningTruck::GetUnloadingTime()));
-			m_unloadingTruck->NotifyUnloadingCompletion();
+			TraceScope idle(TraceTrack::station, m_stationId, "idle");
+			popped = m_queue.pop(truck, 1000, m_stopToken);
 		}
+		if(popped)
+		{
+			SimMetrics::GetInstance()->AddQueueDepth(m_stationId - 1, -1);
+			TraceScope unloading(TraceTrack::station, m_stationId, "unloading");
+			const high_resolution_clock::time_point startTime = high_resolution_clock::now();
+			// The start time is published before the truck, so a reader which sees the truck sees its start.
+			m_startTime.store(startTime, std::memory_order_relaxed);
+			m_unloadingTruck.store(truck, std::memory_order_release);
+			if (!SleepUntil(startTime + std::chrono::milliseconds(MiningTruck::GetUnloadingTime())))
+			{
+				break;
+			}
+			const uint32_t payload = truck->GetPayload();
+			truck->NotifyUnloadingCompletion();
+			m_unloadingTruck.store(NULL, std::memory_order_release);
+			IncrementUnloadCount(payload);
+			ReleaseSlots(1);
+		}
+	}
+}
+
+void UnloadingStation::RunBatch()
+{
+	const milliseconds unloadingTime(MiningTruck::GetUnloadingTime());
+	// popAll blocks without timeout. The stop token wakes it up.
+	while(!m_stopToken.stop_requested())
+	{
+		{
+			TraceScope idle(TraceTrack::station, m_stationId, "idle");
+			if (!m_queue.popAll(m_batch, m_stopToken))
+			{
+				break;
+			}
+		}
+		SimMetrics::GetInstance()->AddQueueDepth(m_stationId - 1, -(int64_t)m_batch.size());
+		TraceScope unloading(TraceTrack::station, m_stationId, "unloading_batch");
+		const high_resolution_clock::time_point batchStart = high_resolution_clock::now();
+		size_t completedCount = 0;
+		while (completedCount < m_batch.size())
+		{
+			m_pendingInBatch = m_batch.size() - completedCount - 1;
+			const high_resolution_clock::time_point startTime = batchStart + unloadingTime * completedCount;
+			m_startTime.store(startTime, std::memory_order_relaxed);
+			m_unloadingTruck.store(m_batch[completedCount], std::memory_order_release);
+			if (!SleepUntil(startTime + unloadingTime))
+			{
+				break;
+			}
+
+			// Complete every truck whose deadline has already passed in this wakeup,
+			// so an oversleep does not cost one more sleep per truck.
+			const high_resolution_clock::time_point now = high_resolution_clock::now();
+			size_t doneCount = completedCount + 1;
+			while (doneCount < m_batch.size() && batchStart + unloadingTime * (doneCount + 1) <= now)
+			{
+				doneCount++;
+			}
+			for (size_t i = completedCount; i < doneCount; ++i)
+			{
+				const uint32_t payload = m_batch[i]->GetPayload();
+				m_batch[i]->NotifyUnloadingCompletion();
+				IncrementUnloadCount(payload);
+			}
+			ReleaseSlots(doneCount - completedCount);
+			completedCount = doneCount;
+		}
+		m_pendingInBatch = 0;
+		m_unloadingTruck.store(NULL, std::memory_order_release);
+	}
+}
+
+bool UnloadingStation::SleepUntil(high_resolution_clock::time_point deadline)
+{
+	// Nothing notifies m_sleepSignal, so only the deadline or a stop request ends the sleep.
+	std::unique_lock<std::mutex> lock(m_sleepMutex);
+	m_sleepSignal.wait_until(lock, m_stopToken, deadline, [] { return false; });
+	return !m_stopToken.stop_requested();
+}
+
+void UnloadingStation::ReleaseSlots(uint64_t count)
+{
+	m_occupancy.fetch_sub(count, std::memory_order_relaxed);
+	if (m_capacity)
+	{
+		StagingArea::GetInstance()->NotifySlotFreed(count);
 	}
 }
 
@@ -10,7 +10,11 @@
 #include <iostream>
 #include <unistd.h>
 #include <chrono>
-#include "BlockingQueue.h"
+#include <atomic>
+#include <vector>
+#include <stop_token>
+#include <condition_variable>
+#include "PriorityBlockingQueue.h"
 #include "MiningTruck.h"
 
 using namespace std::chrono;
@@ -20,29 +24,133 @@ class UnloadingStation
 public:
 	/**
 	 * Constructor
-	 * @param[in] stationId Identifier of the station
+	 * @param[in] stationId       Identifier of the station
+	 * @param[in] batchUnloading  True to drain all the queued trucks in one
+	 *                            queue operation and unload them back to back.
+	 *                            False to pop one truck at a time.
+	 * @param[in] stopToken       Stop token of the simulation. run returns
+	 *                            as soon as stop is requested.
+	 * @param[in] priorityClassCount  Number of truck priority classes of the
+	 *                            queue. With 1 the queue is FIFO.
 	 */
-	UnloadingStation(uint16_t stationId);
+	UnloadingStation(uint16_t stationId, bool batchUnloading = false,
+			std::stop_token stopToken = std::stop_token(), uint32_t priorityClassCount = 1);
 	/**
-	* Increment the unloading count of the station
-	* It is used to generate statistics report.
+	* Increment the unloading count of the station and add the payload
+	* of the unloaded truck. It is used to generate statistics report.
+	*
+	* @param[in] payload   Payload of the unloaded truck in tonnes
 	*/
-	void IncrementUnloadCount();
-    /**
-     * Method to stop the simulation.
-     */
-	void StopSimulation();
+	void IncrementUnloadCount(uint32_t payload);
+	/**
+	 * Get the number of unloadings done by the station
+	 *
+	 * @return   Unsigned Integer  Unload count
+	 */
+	uint32_t GetUnloadCount() const;
+	/**
+	 * Get the tonnes unloaded by the station
+	 *
+	 * @return   Unsigned Integer  Unloaded tonnes
+	 */
+	uint64_t GetUnloadedTonnes() const;
 	/**
 	 * Get current wait time in the queue to unload the mine
+	 * for a truck of the given priority class
+	 *
+	 * @param[in] priorityClass  Priority class of the truck
 	 *
 	 * @return Time in milliseconds
 	 */
-	uint64_t GetWaitingTime();
+	uint64_t GetWaitingTime(uint32_t priorityClass = 0);
 	/**
 	 * Add the truck in the waiting queue of the station to unload the mine
 	 * @param[in] truck   Truck to unload
 	 */
 	void PushToQueue(MiningTruck* truck);
+	/**
+	 * Add the truck in the waiting queue of the station if the station
+	 * has a free slot.
+	 *
+	 * @param[in] truck     Truck to unload
+	 * @param[in] diverted  True if a better station refused the truck
+	 *                      before. An accepted truck is counted as diverted.
+	 *
+	 * @return    bool      True if the truck is queued, False if the station is full
+	 */
+	bool TryPushToQueue(MiningTruck* truck, bool diverted);
+	/**
+	 * Count an arrival refused because the station was full. An arrival
+	 * is counted once, by the first station which refuses it, however
+	 * many stations and retries it takes.
+	 */
+	void CountRejectedArrival();
+	/**
+	 * Set the capacity of the station. The trucks in the queue and the
+	 * one being unloaded take a slot each.
+	 *
+	 * @param[in] capacity  Number of slots. 0 is unbounded.
+	 */
+	void SetCapacity(uint32_t capacity);
+	/**
+	 * Get the capacity of the station
+	 *
+	 * @return   Unsigned Integer  Number of slots. 0 is unbounded.
+	 */
+	uint32_t GetCapacity() const;
+	/**
+	 * Get the number of arrivals refused because the station was full
+	 *
+	 * @return   Unsigned Integer  Number of rejected arrivals
+	 */
+	uint64_t GetRejectedCount() const;
+	/**
+	 * Get the number of trucks accepted after a better station refused them
+	 *
+	 * @return   Unsigned Integer  Number of diverted arrivals
+	 */
+	uint64_t GetDivertedCount() const;
+	/**
+	 * Set the NUMA node of the station thread
+	 *
+	 * @param[in] node  Node index
+	 */
+	void SetNumaNode(uint32_t node);
+	/**
+	 * Get the NUMA node of the station thread
+	 *
+	 * @return   Unsigned Integer  Node index
+	 */
+	uint32_t GetNumaNode() const;
+	/**
+	 * Get the number of trucks pushed to the queue by a thread of
+	 * the same NUMA node
+	 *
+	 * @return   Unsigned Integer  Number of node local pushes
+	 */
+	uint64_t GetLocalPushCount() const;
+	/**
+	 * Get the number of trucks pushed to the queue by a thread of
+	 * another NUMA node
+	 *
+	 * @return   Unsigned Integer  Number of cross-node pushes
+	 */
+	uint64_t GetRemotePushCount() const;
+	/**
+	 * Get the instrumentation counters of the waiting queue
+	 *
+	 * @return   Counters of the queue. All 0 unless built with
+	 *           BLOCKING_QUEUE_STATS.
+	 */
+	BlockingQueueStats GetQueueStats() const;
+	/**
+	 * Get the queue wait statistics of a truck priority class
+	 *
+	 * @param[in] priorityClass  Priority class
+	 *
+	 * @return    Wait statistics of the class
+	 */
+	PriorityClassStats GetPriorityClassStats(uint32_t priorityClass) const;
 	/**
 	 * Runnable method to start by thread to initiate station's work
 	 */
@@ -56,18 +164,77 @@ public:
 	friend ostream & operator << (ostream &out, const UnloadingStation &station);
 
 private:
+	/**
+	 * Station loop which pops and unloads one truck at a time.
+	 */
+	void RunSingle();
+	/**
+	 * Station loop which drains every queued truck at once, unloads them
+	 * against one deadline sequence and notifies all the trucks whose
+	 * deadline has passed in a single wakeup.
+	 */
+	void RunBatch();
+	/**
+	 * Sleep until the given time point or until stop is requested.
+	 *
+	 * @param[in] deadline  Time point to wake up
+	 *
+	 * @return    bool      True if it sleeps until deadline, otherwise
+	 *                      False if stop is requested
+	 */
+	bool SleepUntil(high_resolution_clock::time_point deadline);
+	/**
+	 * Put the truck in the queue. Its slot must be taken already.
+	 *
+	 * @param[in] truck   Truck to unload
+	 */
+	void Enqueue(MiningTruck* truck);
+	/**
+	 * Free the slots of the unloaded trucks and wake up the trucks held
+	 * in the staging area if the station is bounded.
+	 *
+	 * @param[in] count   Number of unloaded trucks
+	 */
+	void ReleaseSlots(uint64_t count);
+
 	// Station Identifier
 	uint16_t m_stationId;
 	// Stores the number of times unloading happens in the station
-	uint8_t m_unloadCount;
+	uint32_t m_unloadCount;
+	// Stores the tonnes unloaded by the station
+	uint64_t m_unloadedTonnes;
 	// Queue to put the truck to unload
-	BlockingQueue<MiningTruck*> m_queue;
+	PriorityBlockingQueue<MiningTruck*> m_queue;
 	//Stops the simulation
-	volatile bool m_stopSim;
-	//Current unloading truck object.
-	MiningTruck* m_unloadingTruck;
-	//Stores the time when truck starts to unload activity
-	high_resolution_clock::time_point m_startTime;
+	std::stop_token m_stopToken;
+	//Mutex object used by conditional variable m_sleepSignal
+	std::mutex m_sleepMutex;
+	//Conditional variable used to sleep for the unloading time
+	std::condition_variable_any m_sleepSignal;
+	//Current unloading truck object. Truck threads read it in GetWaitingTime.
+	std::atomic<MiningTruck*> m_unloadingTruck;
+	//Stores the time when truck starts to unload activity. Truck threads read it in GetWaitingTime.
+	std::atomic<high_resolution_clock::time_point> m_startTime;
+	//True if station runs in batch draining mode
+	bool m_batchUnloading;
+	//Trucks drained from the queue which are waiting behind the current one
+	std::atomic<uint64_t> m_pendingInBatch;
+	//Trucks drained from the queue in batch mode
+	std::vector<MiningTruck*> m_batch;
+	//NUMA node of the station thread
+	uint32_t m_numaNode;
+	//Number of pushes from trucks served on the same NUMA node
+	std::atomic<uint64_t> m_localPushCount;
+	//Number of pushes from trucks served on another NUMA node
+	std::atomic<uint64_t> m_remotePushCount;
+	//Number of slots of the station. 0 is unbounded.
+	uint32_t m_capacity;
+	//Trucks queued or being unloaded at the station
+	std::atomic<uint64_t> m_occupancy;
+	//Number of arrivals refused because the station was full
+	std::atomic<uint64_t> m_rejectedCount;
+	//Number of trucks accepted after a better station refused them
+	std::atomic<uint64_t> m_divertedCount;
 };
 
 #endif /* UNLOADINGSTATION_H_ */
@@ -0,0 +1,180 @@
+/**
+ * @file  WhatIfBranching.cpp
+ *
+ * WhatIfBranching class methods implementation
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "WhatIfBranching.h"
+#include "EventSimulation.h"
+
+using namespace std::chrono;
+
+bool WhatIfBranching::ParseVariant(const std::string& text, BranchVariant& variant)
+{
+	variant = BranchVariant();
+	variant.name = text;
+	if (text == "base")
+	{
+		return true;
+	}
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		size_t end = text.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = text.size();
+		}
+		const std::string change = text.substr(start, end - start);
+		const size_t plus = change.find('+');
+		if (plus == std::string::npos)
+		{
+			return false;
+		}
+		const std::string target = change.substr(0, plus);
+		const std::string amount = change.substr(plus + 1);
+		char* last = NULL;
+		const unsigned long count = strtoul(amount.c_str(), &last, 10);
+		if (amount.empty() || *last != '\0' || count == 0 || count > UINT16_MAX)
+		{
+			return false;
+		}
+		if (target == "stations")
+		{
+			variant.addedStations += count;
+		}
+		else if (target == "trucks")
+		{
+			variant.addedTrucks += count;
+		}
+		else
+		{
+			return false;
+		}
+		start = end + 1;
+	}
+	return true;
+}
+
+WhatIfBranching::WhatIfBranching(const Scenario& scenario, uint64_t branchTime)
+	: m_scenario(scenario)
+{
+	m_branchTime = branchTime;
+	m_prefixSeconds = 0;
+}
+
+/**
+ * Collect the result of a finished run
+ *
+ * @param[in] simulation   Simulation which ran to the end
+ * @param[in] startTime    Wall clock time the variant started
+ *
+ * @return    Result of the run
+ */
+static BranchResult CollectResult(const EventSimulation& simulation, steady_clock::time_point startTime)
+{
+	BranchResult result;
+	memset(&result, 0, sizeof(result));
+	result.completed = true;
+	result.stationCount = simulation.GetStationCount();
+	result.truckCount = simulation.GetTruckCount();
+	result.processedEvents = simulation.GetProcessedEventCount();
+	for (uint32_t i = 0; i < simulation.GetStationCount(); ++i)
+	{
+		result.unloadCount += simulation.GetStation(i).unloadCount;
+		result.totalBusyTime += simulation.GetStation(i).busyTime;
+	}
+	for (uint32_t i = 0; i < simulation.GetTruckCount(); ++i)
+	{
+		result.totalQueueWaitTime += simulation.GetTruck(i).totalQueueWaitTime;
+	}
+	result.elapsedSeconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+	return result;
+}
+
+bool WhatIfBranching::Run(const std::vector<BranchVariant>& variants, std::vector<BranchResult>& results, std::string& error)
+{
+	// Live metrics are not published, the children would report on top of each other.
+	EventSimulationConfig config;
+	config.scenario = &m_scenario;
+	config.seed = m_scenario.GetSeed();
+
+	steady_clock::time_point startTime = steady_clock::now();
+	EventSimulation simulation(config);
+	simulation.RunUntil(m_branchTime);
+	m_prefixSeconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+
+	// Buffered output would be written again by every child.
+	std::cout.flush();
+
+	bool started = true;
+	std::vector<pid_t> children(variants.size(), -1);
+	std::vector<int> pipes(variants.size(), -1);
+	for (size_t i = 0; i < variants.size(); ++i)
+	{
+		int descriptors[2];
+		if (pipe(descriptors) != 0)
+		{
+			error = std::string("cannot create a pipe: ") + strerror(errno);
+			started = false;
+			break;
+		}
+		pid_t child = fork();
+		if (child < 0)
+		{
+			error = std::string("cannot fork: ") + strerror(errno);
+			close(descriptors[0]);
+			close(descriptors[1]);
+			started = false;
+			break;
+		}
+		if (child == 0)
+		{
+			// The child owns a copy-on-write view of the warm state. Pages are
+			// copied only when the variant writes to them.
+			close(descriptors[0]);
+			steady_clock::time_point variantStartTime = steady_clock::now();
+			simulation.AddStations(variants[i].addedStations);
+			simulation.AddTrucks(variants[i].addedTrucks);
+			simulation.Run();
+			const BranchResult result = CollectResult(simulation, variantStartTime);
+			const bool written = write(descriptors[1], &result, sizeof(result)) == sizeof(result);
+			// Skip the destructors and exit handlers of the parent's objects.
+			_exit(written ? 0 : 1);
+		}
+		close(descriptors[1]);
+		children[i] = child;
+		pipes[i] = descriptors[0];
+	}
+
+	results.assign(variants.size(), BranchResult());
+	for (size_t i = 0; i < variants.size(); ++i)
+	{
+		memset(&results[i], 0, sizeof(BranchResult));
+		if (pipes[i] < 0)
+		{
+			continue;
+		}
+		BranchResult result;
+		if (read(pipes[i], &result, sizeof(result)) == sizeof(result))
+		{
+			results[i] = result;
+		}
+		close(pipes[i]);
+		results[i].started = true;
+		waitpid(children[i], &results[i].waitStatus, 0);
+	}
+	return started;
+}
+
+double WhatIfBranching::GetPrefixSeconds() const
+{
+	return m_prefixSeconds;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file  WhatIfBranching.h
+ *
+ * This file contains WhatIfBranching class. It runs the event driven
+ * simulation of a scenario once up to a branch point, then forks one
+ * process per what-if variant. The children share the warm state of
+ * the parent copy-on-write, change it (e.g. add stations or trucks)
+ * and run the rest of the scenario in parallel.
+ */
+
+#ifndef WHATIFBRANCHING_H_
+#define WHATIFBRANCHING_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Scenario.h"
+
+/**
+ * A change applied to the simulation at the branch point
+ */
+struct BranchVariant
+{
+	// Text the variant is parsed from. It names the variant in reports.
+	std::string name;
+	// Number of stations opened at the branch point
+	uint32_t addedStations = 0;
+	// Number of trucks put into service at the branch point
+	uint32_t addedTrucks = 0;
+};
+
+/**
+ * Result of one variant. It is sent from the child process to the
+ * parent through a pipe, so it holds plain values only.
+ */
+struct BranchResult
+{
+	// True if the child process of the variant is started. It is set by the parent.
+	bool started;
+	// True if the child process ran to the end of the scenario
+	bool completed;
+	// Wait status of the child process. It is set by the parent.
+	int waitStatus;
+	// Number of stations at the end of the run
+	uint32_t stationCount;
+	// Number of trucks at the end of the run
+	uint32_t truckCount;
+	// Number of events processed, the common prefix included
+	uint64_t processedEvents;
+	// Number of unloadings of all the stations
+	uint64_t unloadCount;
+	// Sum of the queue waiting times of all the trucks in milliseconds
+	uint64_t totalQueueWaitTime;
+	// Sum of the busy times of all the stations in milliseconds
+	uint64_t totalBusyTime;
+	// Wall clock time of the child run in seconds
+	double elapsedSeconds;
+};
+
+/**
+ * WhatIfBranching class
+ */
+class WhatIfBranching
+{
+public:
+	/**
+	 * Parse a variant. Changes are separated by commas, e.g.
+	 * "stations+2", "trucks+5" or "stations+1,trucks+3".
+	 * "base" runs the scenario unchanged.
+	 *
+	 * @param[in]  text     Variant text
+	 * @param[out] variant  Parsed variant
+	 *
+	 * @return     bool     True if the text is a valid variant, otherwise False.
+	 */
+	static bool ParseVariant(const std::string& text, BranchVariant& variant);
+	/**
+	 * Constructor
+	 *
+	 * @param[in] scenario    Scenario to run. It must outlive the object.
+	 * @param[in] branchTime  Simulated time of the branch point in milliseconds
+	 */
+	WhatIfBranching(const Scenario& scenario, uint64_t branchTime);
+	/**
+	 * Run the common prefix once, then every variant in its own child
+	 * process. No more children are started once one cannot be, and
+	 * the call returns after the started ones exit.
+	 *
+	 * @param[in]  variants  Variants to run
+	 * @param[out] results   One result per variant, in the same order
+	 * @param[out] error     Why a child process could not be started
+	 *
+	 * @return     bool      True if all the child processes are started.
+	 */
+	bool Run(const std::vector<BranchVariant>& variants, std::vector<BranchResult>& results, std::string& error);
+	/**
+	 * Get the wall clock time of the common prefix
+	 *
+	 * @return   Double  Time in seconds
+	 */
+	double GetPrefixSeconds() const;
+
+private:
+	// Scenario to run
+	const Scenario& m_scenario;
+	// Simulated time of the branch point in milliseconds
+	uint64_t m_branchTime;
+	// Wall clock time of the common prefix in seconds
+	double m_prefixSeconds;
+};
+
+#endif /* WHATIFBRANCHING_H_ */
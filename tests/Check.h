@@ -0,0 +1,40 @@
+/**
+ * @file  Check.h
+ *
+ * This file contains the CHECK macro of the tests. A failed check
+ * prints its location and the test exits with a failure status.
+ */
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <iostream>
+
+// Number of failed checks of the test
+inline int g_failedChecks = 0;
+
+/**
+ * Check a condition and report it if it does not hold. The test goes on,
+ * so one run lists every failed check.
+ */
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+			g_failedChecks++; \
+		} \
+	} while (0)
+
+/**
+ * Get the exit status of the test
+ *
+ * @return    Integer  0 if every check held, otherwise 1
+ */
+inline int TestResult()
+{
+	return g_failedChecks == 0 ? 0 : 1;
+}
+
+#endif /* CHECK_H_ */
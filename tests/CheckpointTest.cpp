@@ -0,0 +1,150 @@
+/**
+ * @file  CheckpointTest.cpp
+ *
+ * Checks that a run restored from a checkpoint continues exactly as
+ * the uninterrupted run, and that truncated or corrupt checkpoints
+ * are refused without touching the simulation.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "EventSimulation.h"
+
+/**
+ * Results which must match between an uninterrupted and a restored run
+ */
+struct RunResult
+{
+	// Number of processed events
+	uint64_t processedEvents;
+	// Unloadings of every station
+	std::vector<uint64_t> unloadCounts;
+	// Queue waiting time of every truck
+	std::vector<uint64_t> queueWaitTimes;
+	// P95 of the queue wait
+	uint64_t p95QueueWait;
+
+	bool operator==(const RunResult& other) const
+	{
+		return processedEvents == other.processedEvents && unloadCounts == other.unloadCounts &&
+		       queueWaitTimes == other.queueWaitTimes && p95QueueWait == other.p95QueueWait;
+	}
+};
+
+/**
+ * Run the simulation to the end of the scenario and collect its results
+ *
+ * @param[in] simulation   Simulation to run
+ * @param[in] scenario     Scenario of the simulation
+ *
+ * @return    Results of the run
+ */
+static RunResult Finish(EventSimulation& simulation, const Scenario& scenario)
+{
+	simulation.RunUntil(scenario.GetSimulationTime());
+	RunResult result;
+	result.processedEvents = simulation.GetProcessedEventCount();
+	for (uint32_t i = 0; i < simulation.GetStationCount(); ++i)
+	{
+		result.unloadCounts.push_back(simulation.GetStation(i).unloadCount);
+	}
+	for (uint32_t i = 0; i < simulation.GetTruckCount(); ++i)
+	{
+		result.queueWaitTimes.push_back(simulation.GetTruck(i).totalQueueWaitTime);
+	}
+	result.p95QueueWait = simulation.GetQueueWaitPercentile(95);
+	return result;
+}
+
+/**
+ * Write a copy of a file with its content changed
+ *
+ * @param[in] from      File to copy
+ * @param[in] to        Path of the copy
+ * @param[in] offset    Offset of the changed bytes. Bytes from here on are dropped if truncate is set.
+ * @param[in] value     Value written at the offset
+ * @param[in] truncate  True to cut the copy at the offset instead
+ */
+static void WriteChangedCopy(const std::string& from, const std::string& to, size_t offset, uint32_t value, bool truncate)
+{
+	std::ifstream input(from, std::ios::binary);
+	std::vector<char> content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	if (truncate)
+	{
+		content.resize(offset);
+	}
+	else
+	{
+		memcpy(&content[offset], &value, sizeof(value));
+	}
+	std::ofstream output(to, std::ios::binary);
+	output.write(content.data(), content.size());
+}
+
+int main()
+{
+	Scenario scenario;
+	std::string error;
+	CHECK(scenario.CreateDefault(300, 4, error));
+	EventSimulationConfig config;
+	config.scenario = &scenario;
+	config.seed = 11;
+
+	EventSimulation uninterrupted(config);
+	const RunResult expected = Finish(uninterrupted, scenario);
+	CHECK(expected.processedEvents > 0);
+
+	const std::string path = "checkpoint_test.ckpt";
+	{
+		EventSimulation first(config);
+		first.RunUntil(scenario.GetSimulationTime() / 2);
+		CHECK(first.SaveCheckpoint(path));
+	}
+	{
+		// A fresh simulation restored at half time finishes like the uninterrupted one.
+		EventSimulation restored(config);
+		CHECK(restored.RestoreCheckpoint(path, error));
+		CHECK(Finish(restored, scenario) == expected);
+	}
+
+	// The truck records follow the 64 byte header and the random state text, whose size is at offset 56.
+	uint64_t randomStateSize = 0;
+	{
+		std::ifstream input(path, std::ios::binary);
+		input.seekg(56);
+		input.read((char*)&randomStateSize, sizeof(randomStateSize));
+	}
+	const size_t firstTruck = 64 + randomStateSize;
+	struct Corruption
+	{
+		size_t offset;
+		uint32_t value;
+		bool truncate;
+	};
+	const Corruption corruptions[] = {
+		// A random state size far beyond the file, set in its high half
+		{ 60, 0x7fffffff, false },
+		{ firstTruck + offsetof(TruckRecord, state), 99, false },
+		{ firstTruck + offsetof(TruckRecord, stationIndex), 1000, false },
+		{ firstTruck + offsetof(TruckRecord, nextInQueue), 5000, false },
+		{ firstTruck + sizeof(TruckRecord) * 300 + offsetof(StationRecord, queueHead), 5000, false },
+		{ firstTruck + sizeof(TruckRecord) * 10, 0, true },
+	};
+	const std::string corruptPath = "checkpoint_test_corrupt.ckpt";
+	for (const Corruption& corruption : corruptions)
+	{
+		WriteChangedCopy(path, corruptPath, corruption.offset, corruption.value, corruption.truncate);
+		// A refused checkpoint leaves the simulation as it was, so it still finishes like the uninterrupted one.
+		EventSimulation simulation(config);
+		CHECK(!simulation.RestoreCheckpoint(corruptPath, error));
+		CHECK(Finish(simulation, scenario) == expected);
+	}
+	remove(path.c_str());
+	remove(corruptPath.c_str());
+	return TestResult();
+}
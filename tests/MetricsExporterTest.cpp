@@ -0,0 +1,167 @@
+/**
+ * @file  MetricsExporterTest.cpp
+ *
+ * Scrapes the metrics endpoint with a local client over a Unix socket
+ * and TCP, and checks that a path which is not a socket is left alone.
+ */
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Check.h"
+#include "MetricsExporter.h"
+#include "SimMetrics.h"
+
+/**
+ * Send a request on a connected socket and read the whole response
+ *
+ * @param[in] client  Connected socket. It is closed.
+ *
+ * @return    Response, empty on error
+ */
+static std::string Scrape(int client)
+{
+	const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+	std::string response;
+	if (send(client, request, sizeof(request) - 1, MSG_NOSIGNAL) == (ssize_t)sizeof(request) - 1)
+	{
+		char buffer[4096];
+		ssize_t count;
+		while ((count = read(client, buffer, sizeof(buffer))) > 0)
+		{
+			response.append(buffer, count);
+		}
+	}
+	close(client);
+	return response;
+}
+
+/**
+ * Get the number of open file descriptors of the process
+ *
+ * @return    Integer  Number of descriptors
+ */
+static int CountOpenDescriptors()
+{
+	int count = 0;
+	DIR* directory = opendir("/proc/self/fd");
+	if (!directory)
+	{
+		return -1;
+	}
+	while (readdir(directory))
+	{
+		count++;
+	}
+	closedir(directory);
+	return count;
+}
+
+/**
+ * Check that the response is the metrics in Prometheus text format
+ *
+ * @param[in] response   HTTP response
+ */
+static void CheckMetricsResponse(const std::string& response)
+{
+	CHECK(response.compare(0, 15, "HTTP/1.0 200 OK") == 0);
+	CHECK(response.find("mining_sim_events_total") != std::string::npos);
+}
+
+/**
+ * Scrape over a Unix socket, then check that a regular file at the path
+ * is neither replaced nor deleted
+ */
+static void TestUnixSocket()
+{
+	const std::string path = "metrics_test.sock";
+	unlink(path.c_str());
+	{
+		std::stop_source stopSource;
+		MetricsExporter exporter(stopSource.get_token());
+		CHECK(exporter.ListenUnix(path));
+		std::thread server(&MetricsExporter::run, &exporter);
+
+		int client = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+		CHECK(connect(client, (sockaddr*)&address, sizeof(address)) == 0);
+		CheckMetricsResponse(Scrape(client));
+
+		stopSource.request_stop();
+		server.join();
+	}
+	struct stat status;
+	CHECK(lstat(path.c_str(), &status) != 0);
+
+	const std::string regularFile = "metrics_test.txt";
+	{
+		std::ofstream file(regularFile);
+		file << "keep";
+	}
+	{
+		MetricsExporter exporter{std::stop_token()};
+		CHECK(!exporter.ListenUnix(regularFile));
+	}
+	std::ifstream file(regularFile);
+	std::string content;
+	file >> content;
+	CHECK(content == "keep");
+	unlink(regularFile.c_str());
+}
+
+/**
+ * Scrape over TCP, then check that a port which is taken fails without
+ * leaking the socket
+ */
+static void TestTcp()
+{
+	// Find a free loopback port.
+	int probe = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t length = sizeof(address);
+	CHECK(bind(probe, (sockaddr*)&address, sizeof(address)) == 0);
+	CHECK(getsockname(probe, (sockaddr*)&address, &length) == 0);
+	close(probe);
+	const uint16_t port = ntohs(address.sin_port);
+
+	std::stop_source stopSource;
+	MetricsExporter exporter(stopSource.get_token());
+	CHECK(exporter.ListenTcp(port));
+	std::thread server(&MetricsExporter::run, &exporter);
+
+	int client = socket(AF_INET, SOCK_STREAM, 0);
+	CHECK(connect(client, (sockaddr*)&address, sizeof(address)) == 0);
+	CheckMetricsResponse(Scrape(client));
+
+	const int openBefore = CountOpenDescriptors();
+	{
+		MetricsExporter second{std::stop_token()};
+		CHECK(!second.ListenTcp(port));
+		CHECK(CountOpenDescriptors() == openBefore);
+	}
+
+	stopSource.request_stop();
+	server.join();
+}
+
+int main()
+{
+	SimMetrics::GetInstance()->SetStationCount(2);
+	TestUnixSocket();
+	TestTcp();
+	return TestResult();
+}
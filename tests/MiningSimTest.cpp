@@ -0,0 +1,100 @@
+/**
+ * @file  MiningSimTest.cpp
+ *
+ * Calls the C ABI the way a caller built against version 1 does, with
+ * the smaller result structure of that version, and checks that runs
+ * and batches write only the caller's structures.
+ */
+
+#include <cstring>
+#include "Check.h"
+#include "MiningSim.h"
+
+/**
+ * Result structure of version 1 of the C ABI
+ */
+struct ResultV1
+{
+	uint32_t size;
+	int32_t status;
+	uint64_t simulated_time;
+	uint64_t processed_events;
+	uint64_t load_count;
+	uint64_t unload_count;
+	double unloads_per_hour;
+	double mean_queue_wait;
+	double p95_queue_wait;
+	double station_utilization;
+};
+
+// Filler of the bytes the library must not write
+static const uint8_t kGuardByte = 0xa5;
+
+int main()
+{
+	const mining_sim_distribution distributions[] = { { 1800000, 1800000 }, { 3600000, 18000000 }, { 300000, 300000 } };
+	const uint32_t stationDistributions[] = { 2, 2 };
+	mining_sim_truck trucks[40];
+	for (mining_sim_truck& truck : trucks)
+	{
+		truck = mining_sim_truck{ 0, 1 };
+	}
+	mining_sim_scenario* scenario = NULL;
+	CHECK(mining_sim_scenario_create(24 * 3600000ULL, 7, distributions, 3, stationDistributions, 2, trucks, 40,
+	                                 &scenario) == MINING_SIM_OK);
+
+	// Reference results with the structure of this version
+	const uint32_t runCount = 3;
+	mining_sim_result expected[runCount];
+	for (uint32_t i = 0; i < runCount; ++i)
+	{
+		expected[i].size = sizeof(mining_sim_result);
+		CHECK(mining_sim_run(scenario, 100 + i, &expected[i]) == MINING_SIM_OK);
+		CHECK(expected[i].unload_count > 0);
+	}
+
+	// A version 1 array followed by guard bytes
+	struct
+	{
+		ResultV1 results[runCount];
+		uint8_t guard[64];
+	} batch;
+	memset(&batch, kGuardByte, sizeof(batch));
+	for (ResultV1& result : batch.results)
+	{
+		result.size = sizeof(ResultV1);
+	}
+	const mining_sim_scenario* scenarios[runCount] = { scenario, scenario, scenario };
+	const uint64_t seeds[runCount] = { 100, 101, 102 };
+	CHECK(mining_sim_run_batch(scenarios, seeds, runCount, 2, (mining_sim_result*)batch.results) == MINING_SIM_OK);
+	for (uint32_t i = 0; i < runCount; ++i)
+	{
+		const ResultV1& result = batch.results[i];
+		CHECK(result.size == sizeof(ResultV1));
+		CHECK(result.status == MINING_SIM_OK);
+		CHECK(result.processed_events == expected[i].processed_events);
+		CHECK(result.unload_count == expected[i].unload_count);
+		CHECK(result.p95_queue_wait == expected[i].p95_queue_wait);
+	}
+	bool guardKept = true;
+	for (uint8_t byte : batch.guard)
+	{
+		guardKept = guardKept && byte == kGuardByte;
+	}
+	CHECK(guardKept);
+
+	// A single version 1 run
+	ResultV1 single;
+	memset(&single, 0, sizeof(single));
+	single.size = sizeof(single);
+	CHECK(mining_sim_run(scenario, 101, (mining_sim_result*)&single) == MINING_SIM_OK);
+	CHECK(single.unload_count == expected[1].unload_count);
+
+	// Results of different sizes in one batch are refused.
+	batch.results[1].size = sizeof(mining_sim_result);
+	CHECK(mining_sim_run_batch(scenarios, seeds, runCount, 2, (mining_sim_result*)batch.results) ==
+	      MINING_SIM_INVALID_ARGUMENT);
+
+	mining_sim_scenario_destroy(scenario);
+	return TestResult();
+}
@@ -0,0 +1,72 @@
+/**
+ * @file  ShardedSimulationTest.cpp
+ *
+ * Compares the totals of sharded runs with the single process run with
+ * common random numbers: one shard gives the same totals, two and four
+ * shards keep every truck and stay close to them.
+ */
+
+#include <cmath>
+#include <string>
+#include "Check.h"
+#include "EventSimulation.h"
+#include "ShardedSimulation.h"
+
+// Largest relative difference of the unloadings of a run on several shards
+static const double kShardTolerance = 0.03;
+
+/**
+ * Run the scenario on shards and add up the shard summaries
+ *
+ * @param[in]  scenario     Scenario to run
+ * @param[in]  shardCount   Number of shards
+ * @param[out] truckCount   Trucks held by the shards at the end
+ *
+ * @return     Unsigned Integer  Unloadings of all the shards
+ */
+static uint64_t RunShards(const Scenario& scenario, uint32_t shardCount, uint64_t& truckCount)
+{
+	ShardedSimulation simulation(scenario, shardCount, 0);
+	std::string error;
+	CHECK(simulation.Run(error));
+	CHECK(simulation.GetShardCount() == shardCount);
+	uint64_t unloadCount = 0;
+	truckCount = 0;
+	for (uint32_t shard = 0; shard < simulation.GetShardCount(); ++shard)
+	{
+		unloadCount += simulation.GetSummary(shard).unloadCount;
+		truckCount += simulation.GetSummary(shard).truckCount;
+	}
+	return unloadCount;
+}
+
+int main()
+{
+	Scenario scenario;
+	std::string error;
+	CHECK(scenario.CreateDefault(1000, 50, error));
+
+	EventSimulationConfig config;
+	config.scenario = &scenario;
+	config.seed = scenario.GetSeed();
+	config.commonRandomNumbers = true;
+	EventSimulation single(config);
+	single.Run();
+	uint64_t expected = 0;
+	for (uint32_t i = 0; i < single.GetStationCount(); ++i)
+	{
+		expected += single.GetStation(i).unloadCount;
+	}
+	CHECK(expected > 0);
+
+	uint64_t truckCount = 0;
+	CHECK(RunShards(scenario, 1, truckCount) == expected);
+	CHECK(truckCount == scenario.GetTruckCount());
+	for (uint32_t shardCount : { 2, 4 })
+	{
+		const uint64_t unloadCount = RunShards(scenario, shardCount, truckCount);
+		CHECK(truckCount == scenario.GetTruckCount());
+		CHECK(std::fabs((double)unloadCount - expected) <= kShardTolerance * expected);
+	}
+	return TestResult();
+}
@@ -0,0 +1,83 @@
+/**
+ * @file  SimOptionsTest.cpp
+ *
+ * Checks that the parser refuses option combinations in which an option
+ * would be ignored and values out of their range, and accepts the
+ * combinations a run uses.
+ */
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "SimOptions.h"
+
+/**
+ * Parse a command line
+ *
+ * @param[in] arguments   Arguments after the program name
+ *
+ * @return    bool        Result of the parser
+ */
+static bool Parse(std::initializer_list<const char*> arguments)
+{
+	std::vector<std::string> storage = { "sim" };
+	storage.insert(storage.end(), arguments.begin(), arguments.end());
+	std::vector<char*> argv;
+	for (std::string& argument : storage)
+	{
+		argv.push_back(argument.data());
+	}
+	SimOptions options;
+	return ParseSimOptions(argv.size(), argv.data(), options);
+}
+
+int main()
+{
+	CHECK(Parse({ "--checkpoint", "run.ckpt", "--timeseries", "run.ts", "--report-csv", "run.csv" }));
+	CHECK(Parse({ "--early-stop", "5", "--report-csv", "run.csv" }));
+	CHECK(Parse({ "--batch-unloading", "--trace", "run.json", "--numa-placement", "--station-capacity", "4" }));
+	CHECK(Parse({ "--compare", "stations+1", "--replications", "5" }));
+	CHECK(Parse({ "--branch", "base", "--branch", "stations+2", "--branch-at", "4" }));
+
+	// Threaded engine options under the event driven engine
+	CHECK(!Parse({ "--event-driven", "--trace", "run.json" }));
+	CHECK(!Parse({ "--batch-unloading", "--gradients" }));
+	CHECK(!Parse({ "--compare", "stations+1", "--priority-classes", "20" }));
+	CHECK(!Parse({ "--shards", "2", "--numa-placement" }));
+	CHECK(!Parse({ "--station-capacity", "3", "--checkpoint", "run.ckpt" }));
+
+	// Single run options under another run mode
+	for (const char* option : { "--checkpoint", "--restore", "--timeseries", "--report-csv", "--road-network" })
+	{
+		CHECK(!Parse({ "--branch", "base", option, "file" }));
+		CHECK(!Parse({ "--compare", "trucks+2", option, "file" }));
+		CHECK(!Parse({ "--optimize-p95", "10", option, "file" }));
+		CHECK(!Parse({ "--sweep-stations", "6", option, "file" }));
+		CHECK(!Parse({ "--twin", "-", option, "file" }));
+		CHECK(!Parse({ "--shards", "2", option, "file" }));
+	}
+	CHECK(!Parse({ "--branch", "base", "--gradients" }));
+	CHECK(!Parse({ "--sweep-stations", "6", "--early-stop", "5" }));
+
+	// Two run modes
+	CHECK(!Parse({ "--compare", "stations+1", "--branch", "base" }));
+	CHECK(!Parse({ "--shards", "2", "--twin", "-" }));
+
+	CHECK(!Parse({ "--early-stop", "5", "--checkpoint", "run.ckpt" }));
+	CHECK(!Parse({ "--gradients", "--checkpoint", "run.ckpt" }));
+	CHECK(!Parse({ "--restore", "run.ckpt", "--gradients" }));
+	CHECK(Parse({ "--gradients", "--report-csv", "run.csv" }));
+
+	CHECK(Parse({ "--early-stop", "100" }));
+	CHECK(!Parse({ "--early-stop", "101" }));
+	CHECK(Parse({ "--station-capacity", "4294967295" }));
+	CHECK(!Parse({ "--station-capacity", "5000000000" }));
+	CHECK(!Parse({ "--trace-sample", "5000000000" }));
+	CHECK(!Parse({ "--timeseries-plot", "2" }));
+	CHECK(!Parse({ "--metrics-port", "65536" }));
+	CHECK(!Parse({ "--shards", "0" }));
+	CHECK(Parse({ "--shards", "2", "--shard-memory", "17592186044415" }));
+	CHECK(!Parse({ "--shards", "2", "--shard-memory", "17592186044416" }));
+	return TestResult();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file  StatisticsReportTest.cpp
+ *
+ * Checks the summary of a counter against a sorted copy: nearest rank
+ * percentiles, total, extremes and moments, on small arrays and on an
+ * array large enough to be reduced over threads.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "Check.h"
+#include "StatisticsReport.h"
+
+/**
+ * Get a nearest rank percentile from sorted values
+ *
+ * @param[in] sorted       Values in ascending order
+ * @param[in] percentile   Percentile in (0, 100]
+ *
+ * @return    Unsigned Integer  Smallest value with at least that percent of the values at or below it
+ */
+static uint64_t GetNearestRank(const std::vector<uint64_t>& sorted, double percentile)
+{
+	const size_t rank = (size_t)std::ceil(percentile / 100 * sorted.size());
+	return sorted[rank ? rank - 1 : 0];
+}
+
+/**
+ * Check the summary of values against a sorted copy
+ *
+ * @param[in] values   Counter values
+ */
+static void CheckSummary(const std::vector<uint64_t>& values)
+{
+	const CounterSummary summary = SummarizeCounter("counter", values);
+	std::vector<uint64_t> sorted(values);
+	std::sort(sorted.begin(), sorted.end());
+	uint64_t total = 0;
+	for (uint64_t value : values)
+	{
+		total += value;
+	}
+	const double mean = (double)total / values.size();
+	double squaredDeviations = 0;
+	for (uint64_t value : values)
+	{
+		squaredDeviations += (value - mean) * (value - mean);
+	}
+	CHECK(summary.count == values.size());
+	CHECK(summary.total == total);
+	CHECK(summary.min == sorted.front());
+	CHECK(summary.max == sorted.back());
+	CHECK(std::fabs(summary.mean - mean) <= 1e-9 * std::max(1.0, mean));
+	const double standardDeviation = std::sqrt(squaredDeviations / values.size());
+	CHECK(std::fabs(summary.standardDeviation - standardDeviation) <= 1e-6 * std::max(1.0, standardDeviation));
+	CHECK(summary.p50 == GetNearestRank(sorted, 50));
+	CHECK(summary.p95 == GetNearestRank(sorted, 95));
+	CHECK(summary.p99 == GetNearestRank(sorted, 99));
+}
+
+int main()
+{
+	// 1..100 in reverse: the percentiles are the ranks themselves.
+	std::vector<uint64_t> values;
+	for (uint64_t i = 100; i >= 1; --i)
+	{
+		values.push_back(i);
+	}
+	const CounterSummary hundred = SummarizeCounter("hundred", values);
+	CHECK(hundred.p50 == 50 && hundred.p95 == 95 && hundred.p99 == 99);
+	CHECK(hundred.min == 1 && hundred.max == 100 && hundred.total == 5050);
+
+	const CounterSummary single = SummarizeCounter("single", { 7 });
+	CHECK(single.p50 == 7 && single.p95 == 7 && single.p99 == 7 && single.standardDeviation == 0);
+	CHECK(SummarizeCounter("empty", {}).count == 0);
+
+	std::mt19937_64 random(3);
+	for (size_t size : { 2, 3, 10, 19, 20, 21, 101, 1000 })
+	{
+		values.resize(size);
+		for (uint64_t& value : values)
+		{
+			// Few distinct values, so the ranks fall inside runs of duplicates.
+			value = random() % 7;
+		}
+		CheckSummary(values);
+	}
+	// Large enough to be split over threads
+	values.resize(3000000);
+	for (uint64_t& value : values)
+	{
+		value = random() % 1000000;
+	}
+	CheckSummary(values);
+	return TestResult();
+}
@@ -0,0 +1,83 @@
+/**
+ * @file  SteadyStateTest.cpp
+ *
+ * Checks that a run stopped at the steady state reports only the
+ * statistics gathered after the warm-up it discards, also when the run
+ * is long enough to thin out the copies of the statistics.
+ */
+
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "Constants.h"
+#include "EventSimulation.h"
+
+/**
+ * Run until the steady state and check the statistics against the same
+ * run without the warm-up taken out
+ *
+ * @param[in] config      Configuration of both runs
+ * @param[in] tolerance   Relative tolerance of the detector
+ *
+ * @return    Unsigned Integer  Number of batches of the run
+ */
+static uint32_t CheckWarmupTakenOut(const EventSimulationConfig& config, double tolerance)
+{
+	EventSimulation stopped(config);
+	SteadyStateDetector detector(kSteadyStateBatchMinutes * 60000ULL, tolerance, kSteadyStateMinimumBatches);
+	stopped.RunUntilSteadyState(detector);
+	const uint64_t warmupEnd = stopped.GetStatisticsStartTime();
+	CHECK(detector.GetWarmupBatches() > 0);
+	CHECK(warmupEnd == detector.GetWarmupBatches() * detector.GetBatchLength());
+
+	// The same run taken to the end of the warm-up gives the counters which must be left out.
+	EventSimulation full(config);
+	full.RunUntil(warmupEnd);
+	std::vector<uint64_t> stationUnloads;
+	std::vector<uint64_t> truckQueueWaits;
+	for (uint32_t i = 0; i < full.GetStationCount(); ++i)
+	{
+		stationUnloads.push_back(full.GetStation(i).unloadCount);
+	}
+	for (uint32_t i = 0; i < full.GetTruckCount(); ++i)
+	{
+		truckQueueWaits.push_back(full.GetTruck(i).totalQueueWaitTime);
+	}
+	full.RunUntil(stopped.GetSimulatedTime());
+
+	uint64_t unloadCount = 0;
+	for (uint32_t i = 0; i < full.GetStationCount(); ++i)
+	{
+		CHECK(stopped.GetStation(i).unloadCount == full.GetStation(i).unloadCount - stationUnloads[i]);
+		unloadCount += stopped.GetStation(i).unloadCount;
+	}
+	for (uint32_t i = 0; i < full.GetTruckCount(); ++i)
+	{
+		CHECK(stopped.GetTruck(i).totalQueueWaitTime == full.GetTruck(i).totalQueueWaitTime - truckQueueWaits[i]);
+	}
+	// The throughput of the statistics is the steady-state mean of the detector.
+	const double hours = (stopped.GetSimulatedTime() - warmupEnd) / 3600000.0;
+	CHECK(unloadCount / hours > detector.GetSteadyStateMean() * 0.999 &&
+	      unloadCount / hours < detector.GetSteadyStateMean() * 1.001);
+	return detector.GetBatchCount();
+}
+
+int main()
+{
+	Scenario scenario;
+	std::string error;
+	CHECK(scenario.CreateDefault(200, 3, error));
+	EventSimulationConfig config;
+	config.scenario = &scenario;
+	config.seed = 5;
+
+	CheckWarmupTakenOut(config, 0.05);
+
+	// With stations to spare the throughput varies, so a tolerance which is never met runs the
+	// whole scenario and the copies of the statistics are thinned out.
+	Scenario spare;
+	CHECK(spare.CreateDefault(200, 20, error));
+	config.scenario = &spare;
+	CHECK(CheckWarmupTakenOut(config, 1e-9) > 2 * 32);
+	return TestResult();
+}
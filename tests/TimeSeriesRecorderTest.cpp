@@ -0,0 +1,120 @@
+/**
+ * @file  TimeSeriesRecorderTest.cpp
+ *
+ * Checks that every column decodes to the recorded values, including
+ * long runs and deltas which take the longest varints, and that the
+ * Largest-Triangle-Three-Buckets selection keeps both endpoints.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "Check.h"
+#include "MiningTruck.h"
+#include "TimeSeriesRecorder.h"
+
+/**
+ * Record series with runs, small and extreme deltas and decode them
+ */
+static void TestRoundTrip()
+{
+	const uint32_t stationCount = 3;
+	const uint64_t interval = 60000;
+	const uint32_t sampleCount = 5000;
+	TimeSeriesRecorder recorder(stationCount, 1000, interval, 16);
+	std::mt19937_64 random(9);
+	// Expected value of every column by sample
+	std::vector<std::vector<int64_t>> expected(1 + stationCount + kTruckStateCount);
+	for (uint32_t sample = 0; sample < sampleCount; ++sample)
+	{
+		// Sample times off the grid give a non-zero time column.
+		const int64_t deviation = sample % 100 == 0 ? (int64_t)(random() % 5000) : 0;
+		expected[0].push_back(deviation);
+		int64_t queueDepths[stationCount];
+		// An idle station, a station which changes in long runs and one which changes every sample
+		queueDepths[0] = 0;
+		queueDepths[1] = (sample / 700) % 2 ? 40 : 3;
+		queueDepths[2] = (int64_t)(random() % 200) - 100;
+		int64_t truckCounts[kTruckStateCount];
+		for (uint32_t state = 0; state < kTruckStateCount; ++state)
+		{
+			truckCounts[state] = (int64_t)(random() % 1000);
+		}
+		// The largest deltas a column holds need ten byte varints.
+		truckCounts[0] = sample % 2 ? kTimeSeriesMaxValue : -kTimeSeriesMaxValue;
+		truckCounts[1] = sample < sampleCount / 2 ? 0 : (int64_t)1 << 40;
+		// Values beyond the limit are clamped.
+		truckCounts[2] = sample == 10 ? INT64_MIN : truckCounts[2];
+		for (uint32_t i = 0; i < stationCount; ++i)
+		{
+			expected[1 + i].push_back(queueDepths[i]);
+		}
+		for (uint32_t state = 0; state < kTruckStateCount; ++state)
+		{
+			expected[1 + stationCount + state].push_back(std::max(truckCounts[state], -kTimeSeriesMaxValue));
+		}
+		recorder.AddSample(1000 + sample * interval + deviation, queueDepths, truckCounts);
+	}
+	CHECK(recorder.GetSampleCount() == sampleCount);
+	std::vector<int64_t> values;
+	for (uint32_t column = 0; column < expected.size(); ++column)
+	{
+		recorder.DecodeColumn(column, values);
+		CHECK(values == expected[column]);
+	}
+}
+
+/**
+ * Check that LTTB keeps the endpoints, the requested number of points
+ * in ascending order and a lone spike
+ */
+static void TestDownsample()
+{
+	std::mt19937_64 random(4);
+	for (uint32_t count : { 3, 4, 10, 101, 1000, 4097 })
+	{
+		std::vector<uint64_t> times(count);
+		std::vector<int64_t> values(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			times[i] = i * 300000ULL;
+			values[i] = (int64_t)(random() % 50);
+		}
+		for (uint32_t pointCount : { 3, 4, 7, 50, 999, 5000 })
+		{
+			std::vector<uint32_t> selected;
+			TimeSeriesRecorder::DownsampleLttb(times, values, pointCount, selected);
+			CHECK(selected.size() == std::min(pointCount, count));
+			CHECK(selected.front() == 0);
+			CHECK(selected.back() == count - 1);
+			for (size_t i = 1; i < selected.size(); ++i)
+			{
+				CHECK(selected[i - 1] < selected[i]);
+			}
+		}
+	}
+
+	std::vector<uint64_t> times(1000);
+	std::vector<int64_t> values(1000, 5);
+	for (uint32_t i = 0; i < times.size(); ++i)
+	{
+		times[i] = i;
+	}
+	values[517] = 90;
+	std::vector<uint32_t> selected;
+	TimeSeriesRecorder::DownsampleLttb(times, values, 10, selected);
+	bool spikeKept = false;
+	for (uint32_t index : selected)
+	{
+		spikeKept = spikeKept || index == 517;
+	}
+	CHECK(spikeKept);
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestDownsample();
+	return TestResult();
+}
@@ -0,0 +1,40 @@
+#!/bin/sh
+#
+# Build the library sources once, link every tests/*Test.cpp against them
+# and run the tests. Extra compiler flags can be given in CXXFLAGS.
+#
+#   tests/run_tests.sh [test name ...]
+
+set -e
+cd "$(dirname "$0")/.."
+CXX=${CXX:-g++}
+CXXFLAGS="-std=c++20 -O2 -pthread ${CXXFLAGS}"
+BUILD=${BUILD:-${TMPDIR:-/tmp}/mining_sim_tests}
+mkdir -p "$BUILD"
+
+# The library is every source except the command line tool in Sim.cpp.
+objects=""
+for source in *.cpp; do
+	[ "$source" = "Sim.cpp" ] && continue
+	object="$BUILD/${source%.cpp}.o"
+	if [ ! -f "$object" ] || [ "$source" -nt "$object" ] || [ -n "$(find . -maxdepth 1 -name '*.h' -newer "$object")" ]; then
+		$CXX $CXXFLAGS -c "$source" -o "$object"
+	fi
+	objects="$objects $object"
+done
+
+if [ $# -eq 0 ]; then
+	set -- $(cd tests && ls *Test.cpp | sed 's/\.cpp$//')
+fi
+
+failed=0
+for test in "$@"; do
+	$CXX $CXXFLAGS -I. "tests/$test.cpp" $objects -o "$BUILD/$test"
+	if (cd "$BUILD" && "./$test"); then
+		echo "PASS $test"
+	else
+		echo "FAIL $test"
+		failed=1
+	fi
+done
+exit $failed